@@ -0,0 +1,70 @@
+/// @brief Pool of reusable byte buffers.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Common
+{
+
+  /// @brief Buffers which keep their memory between uses.
+  /// Acquired buffer is shared and returns to the pool when its last owner releases it,
+  /// so it can be referenced from many places without copying. Buffers can outlive the pool.
+  /// Acquire and release take no lock: free buffers are kept in a lock free stack of
+  /// maxFreeBuffers slots allocated with the pool.
+  class BufferPool
+  {
+  public:
+    DEFINE_CLASS_POINTERS(BufferPool);
+
+    typedef std::vector<char> Buffer;
+
+  public:
+    /// @param maxFreeBuffers released buffers above this number are deleted.
+    /// @param maxBufferCapacity released buffers which grew above this capacity are deleted.
+    explicit BufferPool(std::size_t maxFreeBuffers = 1024, std::size_t maxBufferCapacity = 64 * 1024);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /// @brief Empty buffer, with capacity left from its previous use if it was taken from the pool.
+    std::shared_ptr<Buffer> Acquire();
+
+    /// @brief Number of buffers ready for reuse.
+    std::size_t GetFreeCount() const;
+
+  private:
+    struct Storage
+    {
+      Storage(std::size_t maxFreeBuffers, std::size_t maxBufferCapacity);
+      ~Storage();
+
+      // Stacks of slot indexes, one of slots with free buffers and one of empty slots.
+      // Head is the top index in the low half and a counter of changes against ABA in the high half.
+      std::atomic<uint64_t> FreeSlots;
+      std::atomic<uint64_t> EmptySlots;
+      std::unique_ptr<std::atomic<uint32_t>[]> Next;
+      std::unique_ptr<Buffer*[]> Buffers;
+      std::atomic<std::size_t> FreeCount;
+      const std::size_t MaxBufferCapacity;
+    };
+
+  private:
+    static void Release(const std::shared_ptr<Storage>& storage, Buffer* buffer);
+
+  private:
+    const std::shared_ptr<Storage> FreeBuffers;
+  };
+
+} // namespace Common
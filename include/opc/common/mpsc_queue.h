@@ -0,0 +1,111 @@
+/// @brief Lock free multiple producers single consumer queue.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Common
+{
+
+  /// @brief Unbounded queue where Push never blocks and never takes a lock.
+  /// Any number of threads can push, only one thread at a time can pop.
+  /// Push is one atomic exchange. An element whose producer was preempted in the middle
+  /// of Push delays the elements pushed after it until that Push completes.
+  template <typename T>
+  class MpscQueue
+  {
+  public:
+    MpscQueue()
+      : Head(new Node)
+      , Tail(Head.load())
+    {
+    }
+
+    ~MpscQueue()
+    {
+      T value;
+      while (Pop(value))
+      {
+      }
+      delete Tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(T value)
+    {
+      Node* node = new Node(std::move(value));
+      Node* previous = Head.exchange(node, std::memory_order_acq_rel);
+      previous->Next.store(node, std::memory_order_release);
+    }
+
+    /// @brief Called by consumer only.
+    bool Pop(T& value)
+    {
+      Node* next = Tail->Next.load(std::memory_order_acquire);
+      if (!next)
+      {
+        return false;
+      }
+      // Next becomes the new stub node, its value is moved out.
+      value = std::move(next->Value);
+      delete Tail;
+      Tail = next;
+      return true;
+    }
+
+    /// @brief Move up to maxCount elements to values, 0 - all available. Called by consumer only.
+    /// @return Number of moved elements.
+    std::size_t Pop(std::vector<T>& values, std::size_t maxCount = 0)
+    {
+      std::size_t count = 0;
+      T value;
+      while ((!maxCount || count < maxCount) && Pop(value))
+      {
+        values.push_back(std::move(value));
+        ++count;
+      }
+      return count;
+    }
+
+    /// @brief Called by consumer only.
+    bool Empty() const
+    {
+      return !Tail->Next.load(std::memory_order_acquire);
+    }
+
+  private:
+    struct Node
+    {
+      T Value;
+      std::atomic<Node*> Next;
+
+      Node()
+        : Next(nullptr)
+      {
+      }
+
+      explicit Node(T&& value)
+        : Value(std::move(value))
+        , Next(nullptr)
+      {
+      }
+    };
+
+  private:
+    // Producers and consumer work with different cache lines, which are not shared with neighbour members either.
+    alignas(64) std::atomic<Node*> Head;
+    alignas(64) Node* Tail;
+  };
+
+} // namespace Common
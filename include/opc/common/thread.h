@@ -13,6 +13,7 @@
 #include <opc/common/interface.h>
 #include <opc/common/class_pointers.h>
 
+#include <functional>
 #include <thread>
 #include <stdexcept>
 
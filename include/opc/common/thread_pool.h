@@ -0,0 +1,93 @@
+/// @brief Pool of worker threads with work stealing.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+#include <opc/common/thread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Common
+{
+
+  /// @brief Fixed number of threads shared by many users instead of a thread per task.
+  /// Every worker has own queue of tasks. Tasks posted by a worker go to its own queue
+  /// and are taken in LIFO order while data is still in cache, idle workers steal
+  /// the oldest tasks from queues of others.
+  class ThreadPool
+  {
+  public:
+    DEFINE_CLASS_POINTERS(ThreadPool);
+
+  public:
+    /// @param threads number of workers, 0 - number of CPU cores.
+    /// @param observer gets OnError for every exception thrown by a posted task.
+    explicit ThreadPool(unsigned threads = 0, ThreadObserver* observer = 0);
+    /// @brief Executes all queued tasks and joins workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Queue task for execution. Can be called from any thread including workers.
+    void Post(ThreadProc task);
+
+    /// @brief Queue function and get its result or exception through future.
+    template <typename Function>
+    std::future<typename std::result_of<Function()>::type> Submit(Function function)
+    {
+      typedef typename std::result_of<Function()>::type Result;
+      std::shared_ptr<std::packaged_task<Result()>> task(new std::packaged_task<Result()>(function));
+      std::future<Result> result = task->get_future();
+      Post([task]()
+      {
+        (*task)();
+      });
+      return result;
+    }
+
+    /// @brief Call body for every index in [begin, end) and wait for completion.
+    /// Range is split into chunks of at least grain indexes. Calling thread executes chunks too,
+    /// so the call does not deadlock when made from a worker.
+    /// @throws first exception thrown by body.
+    void ParallelFor(std::size_t begin, std::size_t end, std::function<void(std::size_t)> body, std::size_t grain = 1);
+
+    /// @brief Number of workers.
+    unsigned Size() const;
+
+  private:
+    struct Worker
+    {
+      std::mutex Mutex;
+      std::deque<ThreadProc> Tasks;
+    };
+
+  private:
+    void Run(unsigned index);
+    bool Pop(unsigned index, ThreadProc& task);
+    void Execute(ThreadProc& task);
+
+  private:
+    ThreadObserver* Observer;
+    std::vector<std::unique_ptr<Worker>> Workers;
+    std::vector<Thread::UniquePtr> Threads;
+    std::atomic<std::size_t> Pending;
+    std::atomic<unsigned> NextWorker;
+    std::mutex Mutex;
+    std::condition_variable TaskPosted;
+    bool Stopping;
+  };
+
+} // namespace Common
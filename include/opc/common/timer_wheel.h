@@ -0,0 +1,120 @@
+/// @brief Hierarchical timer wheel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+#include <opc/common/thread.h>
+#include <opc/common/thread_pool.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Common
+{
+
+  /// @brief Identifier of scheduled timer, 0 is never returned.
+  typedef uint64_t TimerID;
+
+  /// @brief Schedules one shot and periodic callbacks for many timers with one thread.
+  /// Time is split into ticks of fixed resolution. Timers are kept in four levels of 64 slots,
+  /// level N slot covers 64^N ticks, so scheduling and cancelling take constant time
+  /// and a timer is moved between levels at most three times.
+  /// All timers expiring at the same tick are dispatched as one task. Periodic timers
+  /// are aligned to multiples of their interval, so timers with equal intervals always
+  /// expire together regardless of when they were scheduled.
+  class TimerWheel
+  {
+  public:
+    DEFINE_CLASS_POINTERS(TimerWheel);
+
+  public:
+    /// @param pool callbacks are executed by pool, without pool - by the timer thread.
+    explicit TimerWheel(ThreadPool::SharedPtr pool = ThreadPool::SharedPtr(), std::chrono::milliseconds resolution = std::chrono::milliseconds(1));
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /// @brief Call callback once after delay rounded up to resolution.
+    TimerID Schedule(std::chrono::milliseconds delay, ThreadProc callback);
+    /// @brief Call callback every interval until cancelled.
+    /// Next expiration does not wait for previous callback to finish.
+    TimerID SchedulePeriodic(std::chrono::milliseconds interval, ThreadProc callback);
+    /// @brief Stop the timer. Expirations which are dispatched but not started yet are skipped.
+    /// Cancel does not wait for a callback which is already running, so it can still run after
+    /// Cancel returns, for example a periodic callback in the thread pool. Callers which destroy
+    /// state used by callback must wait for it themselves. Waiting inside Cancel would deadlock
+    /// when a callback cancels its own timer.
+    /// @return false if timer already fired or was cancelled.
+    bool Cancel(TimerID id);
+
+    /// @brief Number of scheduled timers.
+    std::size_t Size() const;
+
+  private:
+    struct TimerCallback
+    {
+      ThreadProc Proc;
+      std::atomic<bool> Cancelled;
+
+      explicit TimerCallback(const ThreadProc& proc)
+        : Proc(proc)
+        , Cancelled(false)
+      {
+      }
+    };
+
+    struct Timer
+    {
+      uint64_t Expires;
+      uint64_t Period;
+      std::shared_ptr<TimerCallback> Callback;
+      uint32_t Generation;
+      int32_t Slot;
+      int32_t Prev;
+      int32_t Next;
+    };
+
+    typedef std::vector<std::shared_ptr<TimerCallback>> Batch;
+
+  private:
+    TimerID Add(uint64_t expires, uint64_t period, ThreadProc callback);
+    void Insert(int32_t index);
+    void Unlink(int32_t index);
+    void Free(int32_t index);
+    void Advance(uint64_t tick, std::vector<Batch>& expired);
+    uint64_t NextWakeupTick() const;
+    uint64_t ToTicks(std::chrono::milliseconds duration) const;
+    uint64_t CurrentRealTick() const;
+    void Dispatch(std::vector<Batch>& expired);
+    static void Execute(const Batch& callbacks);
+    void Run();
+
+  private:
+    ThreadPool::SharedPtr Pool;
+    const std::chrono::steady_clock::duration Resolution;
+    const std::chrono::steady_clock::time_point Started;
+
+    mutable std::mutex Mutex;
+    std::condition_variable Changed;
+    std::vector<Timer> Timers;
+    std::vector<int32_t> Slots;
+    int32_t FreeTimers;
+    std::size_t Count;
+    uint64_t CurrentTick;
+    bool Stopping;
+    Thread::UniquePtr Worker;
+  };
+
+} // namespace Common
@@ -0,0 +1,120 @@
+/// @brief Asynchronous completion based channels.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#ifndef OPC_UA_ASYNC_CHANNEL_H
+#define OPC_UA_ASYNC_CHANNEL_H
+
+#include <opc/common/class_pointers.h>
+#include <opc/ua/event_loop.h>
+#include <opc/ua/socket_channel.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace OpcUa
+{
+
+  /// @brief Called when operation finished.
+  /// @param error 0 on success, errno value otherwise. Cancelled operations get ECANCELED,
+  /// operations on a connection closed by peer get ECONNRESET.
+  /// @param bytes number of transferred bytes, can be non zero on error.
+  typedef std::function<void(int error, std::size_t bytes)> IOCompletion;
+
+  /// @brief Non blocking counterpart of IOChannel.
+  /// Operations are queued and completed in order, buffers must stay valid until completion.
+  class AsyncIOChannel
+  {
+  public:
+    DEFINE_CLASS_POINTERS(AsyncIOChannel);
+
+  public:
+    virtual ~AsyncIOChannel()
+    {
+    }
+
+    /// @brief Complete when the whole buffer was filled.
+    virtual void AsyncReceive(char* data, std::size_t size, IOCompletion completion) = 0;
+    /// @brief Complete when at least one byte was received.
+    virtual void AsyncReceiveSome(char* data, std::size_t size, IOCompletion completion) = 0;
+    /// @brief Complete when the whole buffer was sent.
+    virtual void AsyncSend(const char* message, std::size_t size, IOCompletion completion) = 0;
+    /// @brief Complete all pending operations with ECANCELED.
+    virtual void Cancel() = 0;
+  };
+
+  /// @brief Asynchronous channel over a socket served by EventLoop.
+  /// Operations can be started from any thread, completions are called by the loop
+  /// and may start next operations. Completions of one channel are called one at a time
+  /// in order even if several threads run the loop. Pending operations are cancelled when channel is destroyed,
+  /// the loop must outlive its channels.
+  class AsyncSocketChannel
+    : public AsyncIOChannel
+    , public std::enable_shared_from_this<AsyncSocketChannel>
+  {
+  public:
+    DEFINE_CLASS_POINTERS(AsyncSocketChannel);
+
+  public:
+    /// @brief Channel is switched to non blocking mode and write batching is disabled.
+    static SharedPtr Create(std::shared_ptr<SocketChannel> channel, EventLoop& loop);
+    virtual ~AsyncSocketChannel();
+
+    virtual void AsyncReceive(char* data, std::size_t size, IOCompletion completion);
+    virtual void AsyncReceiveSome(char* data, std::size_t size, IOCompletion completion);
+    virtual void AsyncSend(const char* message, std::size_t size, IOCompletion completion);
+    virtual void Cancel();
+
+    std::shared_ptr<SocketChannel> GetChannel() const;
+
+  private:
+    struct Operation
+    {
+      char* Data;
+      std::size_t Size;
+      std::size_t Transferred;
+      bool Some;
+      IOCompletion Completion;
+    };
+
+    struct Completed
+    {
+      IOCompletion Completion;
+      int Error;
+      std::size_t Bytes;
+    };
+
+  private:
+    AsyncSocketChannel(std::shared_ptr<SocketChannel> channel, EventLoop& loop);
+
+    void Start(std::deque<Operation>& queue, char* data, std::size_t size, bool some, IOCompletion completion);
+    void OnReady(uint32_t events);
+    void ProgressReceives(std::vector<Completed>& completed);
+    void ProgressSends(std::vector<Completed>& completed);
+    void CancelAll(int error, std::vector<Completed>& completed);
+    void Dispatch(std::unique_lock<std::mutex>& lock);
+    void Arm();
+
+    friend class EventLoop;
+
+  private:
+    std::shared_ptr<SocketChannel> Channel;
+    EventLoop& Loop;
+    std::mutex Mutex;
+    std::deque<Operation> Receives;
+    std::deque<Operation> Sends;
+    // Completions waiting for the thread which dispatches them.
+    std::vector<Completed> Pending;
+    bool Dispatching;
+  };
+
+} // namespace OpcUa
+
+#endif // OPC_UA_ASYNC_CHANNEL_H
@@ -0,0 +1,124 @@
+/// @brief Client side cache of node attributes.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+#include <opc/ua/server.h>
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct AttributeCacheParameters
+  {
+    /// @brief Maximum number of cached values. Least recently used values are evicted first. 0 - unlimited.
+    std::size_t MaxEntries;
+    /// @brief How long a value stays valid. Zero means until explicit invalidation.
+    std::chrono::milliseconds TimeToLive;
+    /// @brief Attributes which values are cached. Other attributes are always read from server.
+    std::vector<AttributeID> Attributes;
+
+    /// @brief By default caches attributes which usually never change.
+    AttributeCacheParameters();
+  };
+
+  struct AttributeCacheStatistics
+  {
+    uint64_t Hits;
+    uint64_t Misses;
+    uint64_t Evictions;
+    std::size_t Size;
+
+    AttributeCacheStatistics()
+      : Hits(0)
+      , Misses(0)
+      , Evictions(0)
+      , Size(0)
+    {
+    }
+  };
+
+  /// @brief Cache of attribute values keyed by node and attribute id.
+  /// Thread safe.
+  class AttributeCache
+  {
+  public:
+    DEFINE_CLASS_POINTERS(AttributeCache);
+
+  public:
+    explicit AttributeCache(const AttributeCacheParameters& params = AttributeCacheParameters());
+
+    bool IsCacheable(AttributeID attr) const;
+
+    /// @return true if valid value was found in the cache.
+    bool Get(const NodeID& node, AttributeID attr, DataValue& value);
+    void Put(const NodeID& node, AttributeID attr, const DataValue& value);
+
+    /// @brief Start reading values from server to put them into the cache.
+    /// Every StartRead has to be followed by FinishRead when the read is over.
+    /// @return Generation to pass to Put.
+    uint64_t StartRead();
+    void FinishRead();
+    /// @brief Put value read after StartRead returned generation.
+    /// Value is dropped if the attribute was invalidated since then, because it can be older than the invalidating write.
+    void Put(const NodeID& node, AttributeID attr, const DataValue& value, uint64_t generation);
+
+    void Invalidate(const NodeID& node, AttributeID attr);
+    /// @brief Drop all cached attributes of the node.
+    void Invalidate(const NodeID& node);
+    void Clear();
+
+    AttributeCacheStatistics GetStatistics() const;
+
+  private:
+    typedef std::pair<NodeID, AttributeID> Key;
+    typedef std::list<Key> UsageList;
+
+    struct Entry
+    {
+      DataValue Value;
+      std::chrono::steady_clock::time_point Expires;
+      UsageList::iterator Usage;
+    };
+
+    typedef std::map<Key, Entry> EntriesMap;
+
+  private:
+    void PutLocked(const Key& key, const DataValue& value);
+    void Erase(EntriesMap::iterator entryIt);
+
+  private:
+    const AttributeCacheParameters Params;
+    mutable std::mutex Mutex;
+    EntriesMap Entries;
+    // Most recently used keys are at the front.
+    UsageList Usage;
+    AttributeCacheStatistics Statistics;
+
+    // Generations of the last invalidations, kept only while reads are in flight.
+    uint64_t Generation;
+    std::size_t ReadsInFlight;
+    std::map<Key, uint64_t> AttributeGenerations;
+    std::map<NodeID, uint64_t> NodeGenerations;
+    uint64_t ClearGeneration;
+  };
+
+  /// @brief Creates server which attribute services read cacheable attributes through cache.
+  /// Writes made through returned server invalidate written attributes before and after the write,
+  /// values of reads which were in flight during the write are not cached.
+  /// Nodes created on the returned server use the cache for GetAttribute, GetName, DataType etc.
+  Remote::Server::SharedPtr CreateCachedServer(Remote::Server::SharedPtr server, AttributeCache::SharedPtr cache);
+
+} // namespace OpcUa
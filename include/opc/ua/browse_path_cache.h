@@ -0,0 +1,78 @@
+/// @brief Cache of resolved browse paths.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+#include <opc/ua/node.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OpcUa
+{
+
+  /// @brief Keeps node ids of resolved browse paths in a tree of browse names.
+  /// Paths sharing a prefix share tree nodes. Unresolved part of every path is translated
+  /// as one relative path from the deepest cached node of the path, all paths in one
+  /// TranslateBrowsePathsToNodeIds call per chunk. Unresolved prefixes of the paths are
+  /// translated in the same call, so later paths sharing them translate only the rest.
+  /// Thread safe, server is called without holding the lock.
+  class BrowsePathCache
+  {
+  public:
+    DEFINE_CLASS_POINTERS(BrowsePathCache);
+
+  public:
+    explicit BrowsePathCache(Remote::Server::SharedPtr server, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+
+    /// @brief Resolve paths relative to the starting node.
+    /// @return Result for every path in the same order.
+    std::vector<ChildSearchResult> Resolve(const NodeID& startingNode, const std::vector<std::vector<QualifiedName>>& paths);
+    Node Resolve(const NodeID& startingNode, const std::vector<QualifiedName>& path);
+
+    /// @brief Forget path and all paths starting with it. Call when that part of address space changes.
+    void Invalidate(const NodeID& startingNode, const std::vector<QualifiedName>& prefix);
+    /// @brief Forget all paths starting from the node.
+    void Invalidate(const NodeID& startingNode);
+    void Clear();
+
+    /// @brief Number of cached path elements.
+    std::size_t Size() const;
+
+  private:
+    struct PathElement;
+    typedef std::pair<uint16_t, std::string> NameKey;
+    typedef std::map<NameKey, std::unique_ptr<PathElement>> ChildrenMap;
+
+    struct PathElement
+    {
+      NodeID Id;
+      /// @brief False if element is only a part of longer resolved paths and its node id is not known.
+      bool Resolved;
+      ChildrenMap Children;
+    };
+
+  private:
+    static std::size_t CountElements(const PathElement& element);
+    /// @brief Cache node of the first length elements of the path.
+    void Insert(const NodeID& startingNode, const std::vector<QualifiedName>& path, std::size_t length, const NodeID& id);
+
+  private:
+    Remote::Server::SharedPtr Server;
+    const std::size_t MaxItemsPerRequest;
+    mutable std::mutex Mutex;
+    // Changed by every invalidation, translations started before it are not cached.
+    uint64_t Generation;
+    std::map<NodeID, std::unique_ptr<PathElement>> Roots;
+  };
+
+} // namespace OpcUa
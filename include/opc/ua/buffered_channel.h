@@ -0,0 +1,57 @@
+/// @brief Channel with read buffer.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#ifndef OPC_UA_BUFFERED_CHANNEL_H
+#define OPC_UA_BUFFERED_CHANNEL_H
+
+#include <opc/ua/socket_channel.h>
+
+#include <memory>
+#include <vector>
+
+namespace OpcUa
+{
+
+  /// @brief Reads socket with large recv calls and serves small reads from memory.
+  /// Decoders reading messages field by field make one syscall per buffer fill instead of one per field.
+  /// Unread data is moved to the beginning of the buffer when needed, so it is always contiguous and can be peeked.
+  class BufferedChannel : public OpcUa::IOChannel
+  {
+  public:
+    explicit BufferedChannel(std::shared_ptr<SocketChannel> channel, std::size_t bufferSize = 64 * 1024);
+
+    virtual std::size_t Receive(char* data, std::size_t size);
+    virtual void Send(const char* message, std::size_t size);
+    virtual int WaitForData(float second);
+
+    /// @brief Wait until at least size bytes are buffered.
+    /// @return Pointer to buffered data. Valid until next call to any receiving method.
+    /// @throws std::length_error if size is bigger than buffer.
+    const char* Peek(std::size_t size);
+    /// @brief Drop size bytes from the beginning of buffered data.
+    void Consume(std::size_t size);
+    /// @brief Number of buffered bytes.
+    std::size_t Available() const;
+
+    /// @brief Number of recv calls made to fill the buffer.
+    std::size_t GetFillCount() const;
+
+  private:
+    void Fill(std::size_t size);
+
+  private:
+    std::shared_ptr<SocketChannel> Channel;
+    std::vector<char> Buffer;
+    std::size_t Begin;
+    std::size_t End;
+    std::size_t FillCount;
+  };
+
+} // namespace OpcUa
+
+#endif // OPC_UA_BUFFERED_CHANNEL_H
@@ -0,0 +1,96 @@
+/// @brief Change detection and deadband filtering of sampled values.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/protocol/data_value.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace OpcUa
+{
+
+  enum class DeadbandType
+  {
+    None,
+    Absolute,
+    /// @brief Percent of engineering units range.
+    Percent,
+  };
+
+  struct DeadbandFilter
+  {
+    DeadbandType Type;
+    double Value;
+    /// @brief Engineering units range for percent deadband.
+    double Low;
+    double High;
+
+    DeadbandFilter()
+      : Type(DeadbandType::None)
+      , Value(0)
+      , Low(0)
+      , High(0)
+    {
+    }
+  };
+
+  /// @brief Set bit i of bitmap if |current[i] - last[i]| > threshold[i] or only one of the values is NaN.
+  /// Bits are set with OR, bitmap should have (count + 63) / 64 words. Uses SSE2 when available.
+  void DetectChanges(const double* last, const double* current, const double* thresholds, std::size_t count, uint64_t* bitmap);
+  /// @brief Set bit i of bitmap if current[i] != last[i] and |current[i] - last[i]| > threshold[i].
+  void DetectChanges(const int64_t* last, const int64_t* current, const double* thresholds, std::size_t count, uint64_t* bitmap);
+  void DetectChanges(const uint64_t* last, const uint64_t* current, const double* thresholds, std::size_t count, uint64_t* bitmap);
+
+  /// @brief Remembers last values of items and finds changed ones.
+  /// Numeric scalars are kept in contiguous columns, one for floating point and
+  /// integer types up to 32 bits, one for signed and one for unsigned 64 bit integers, and compared with
+  /// DetectChanges over the whole set of items. Other values are compared as Variants.
+  /// Value is changed when its status, type or value beyond deadband changed.
+  class ChangeDetector
+  {
+  public:
+    /// @brief Append item.
+    /// @return Index of item.
+    std::size_t Add(const DeadbandFilter& filter = DeadbandFilter());
+    /// @brief Remove item moving the last one to its place.
+    void Remove(std::size_t index);
+    std::size_t Size() const;
+
+    /// @brief Compare values with last ones and remember changed values.
+    /// The first value of an item is always changed.
+    /// @param values values in order of indexes, items after the end of values are not changed.
+    /// @param changed bitmap of changed items, resized to fit all items.
+    void Detect(const std::vector<DataValue>& values, std::vector<uint64_t>& changed);
+
+  private:
+    enum class Kind : uint8_t
+    {
+      None,
+      Double,
+      Int64,
+      UInt64,
+      Other,
+    };
+
+  private:
+    std::vector<double> Thresholds;
+    std::vector<Kind> Kinds;
+    std::vector<VariantType> Types;
+    std::vector<StatusCode> Statuses;
+    std::vector<double> LastDoubles;
+    std::vector<double> CurrentDoubles;
+    std::vector<int64_t> LastIntegers;
+    std::vector<int64_t> CurrentIntegers;
+    std::vector<uint64_t> LastUnsigned;
+    std::vector<uint64_t> CurrentUnsigned;
+    std::vector<Variant> LastOthers;
+  };
+
+} // namespace OpcUa
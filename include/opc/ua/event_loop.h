@@ -0,0 +1,74 @@
+/// @brief Event loop driving asynchronous channels.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#ifndef OPC_UA_EVENT_LOOP_H
+#define OPC_UA_EVENT_LOOP_H
+
+#include <opc/common/class_pointers.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace OpcUa
+{
+
+  class AsyncSocketChannel;
+
+  /// @brief Dispatches readiness of sockets to asynchronous channels with epoll.
+  /// Completion handlers of channels and posted functions are called by threads running the loop.
+  /// Usually one or two threads run a loop, every socket is armed once per operation so
+  /// the same channel is never processed by two threads at once.
+  class EventLoop
+  {
+  public:
+    DEFINE_CLASS_POINTERS(EventLoop);
+
+  public:
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /// @brief Process ready sockets and posted functions.
+    /// @param second timeout, negative value - wait infinitely.
+    /// @return Number of processed events.
+    std::size_t RunOnce(float second);
+    /// @brief Process events until Stop is called.
+    void Run();
+    /// @brief Make Run return in all threads. Can be called from any thread.
+    void Stop();
+    bool IsStopped() const;
+
+    /// @brief Call function from the thread running the loop. Can be called from any thread.
+    void Post(std::function<void()> function);
+
+  private:
+    friend class AsyncSocketChannel;
+
+    void Add(int sock, std::weak_ptr<AsyncSocketChannel> channel);
+    void Arm(int sock, uint32_t events);
+    void Remove(int sock);
+    void Wakeup();
+
+  private:
+    int Epoll;
+    int WakeupEvent;
+    std::atomic<bool> Stopped;
+    std::mutex Mutex;
+    std::map<int, std::weak_ptr<AsyncSocketChannel>> Channels;
+    std::vector<std::function<void()>> Posted;
+  };
+
+} // namespace OpcUa
+
+#endif // OPC_UA_EVENT_LOOP_H
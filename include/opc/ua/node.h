@@ -21,6 +21,8 @@
 
 #include <opc/ua/server.h>
 
+#include <atomic>
+#include <map>
 #include <sstream>
 
 
@@ -33,6 +35,57 @@ namespace OpcUa
       NodeNotFoundException() : std::runtime_error("NodeNotFoundException") { }
   };
 
+  /// @brief Which references are followed by Node::BrowseRecursive.
+  struct BrowseFilter
+  {
+    ReferenceID Reference;
+    bool IncludeSubtypes;
+    /// @brief Mask of NodeClass values of target nodes. NODE_CLASS_ALL - any class.
+    uint32_t NodeClasses;
+    uint32_t MaxReferencesPerNode;
+
+    /// @brief By default follows all hierarchical references.
+    BrowseFilter()
+      : Reference(ReferenceID::HierarchicalReferences)
+      , IncludeSubtypes(true)
+      , NodeClasses(NODE_CLASS_ALL)
+      , MaxReferencesPerNode(1000)
+    {
+    }
+  };
+
+  /// @brief Compact copy of a part of address space made by Node::BrowseRecursive.
+  struct AddressSpaceSnapshot
+  {
+    struct NodeData
+    {
+      NodeID Id;
+      QualifiedName BrowseName;
+      NodeClass Class;
+      NodeID TypeDefinition;
+      /// @brief Distance from the starting node.
+      uint32_t Depth;
+    };
+
+    struct Reference
+    {
+      /// @brief Indexes in Nodes.
+      uint32_t Source;
+      uint32_t Target;
+      NodeID ReferenceTypeID;
+    };
+
+    /// @brief Nodes in breadth first order. The starting node is the first one.
+    std::vector<NodeData> Nodes;
+    std::vector<Reference> References;
+  };
+
+  /// @brief Default maximum number of items packed into one service request by the batch helpers.
+  const std::size_t DefaultMaxItemsPerRequest = 1000;
+
+  struct ChildSearchResult;
+  class BrowsePathCache;
+
   /// @brief A Node object represent an OPC-UA node.
   /// It is high level object intended for developper who want to expose
   /// data through OPC-UA or read data from an OPCUA server.
@@ -47,9 +100,13 @@ namespace OpcUa
     Node(Remote::Server::SharedPtr srv, const NodeID& id);
     Node(Remote::Server::SharedPtr srv, const NodeID& id, const QualifiedName& name);
     Node(const Node& other); 
+    Node& operator=(const Node& other);
 
     NodeID GetId() const;
 
+    /// @brief Browse name of the node. It is read from the server on first use.
+    /// Can be called from several threads on the same node: concurrent first calls may read
+    /// the name more than once but only the first result is kept.
     QualifiedName GetName() const;
     void SetName(const QualifiedName& name);
 
@@ -61,6 +118,14 @@ namespace OpcUa
     /// @return One or zero chilren nodes.
     std::vector<Node> GetChildren() const;
 
+    /// @brief Walk subtree breadth first and store nodes and references in a snapshot.
+    /// Every node is visited only once, so loops in the address space are safe.
+    /// All nodes of one level are browsed with one ViewServices::BrowseNodes call per chunk of DefaultMaxItemsPerRequest nodes.
+    /// It saves round trips only with view services which override BrowseNodes, the default one browses node by node.
+    /// Class of this node is read with one more request.
+    /// @param depth how many levels below this node are browsed.
+    AddressSpaceSnapshot BrowseRecursive(uint32_t depth, const BrowseFilter& filter = BrowseFilter()) const;
+
     //The GetChildNode methods return a node defined by its path from the node. A path is defined by
     // a sequence of browse name(QualifiedName). A browse name is either defined through a qualifiedname object
     // or a string of format namespace:browsename. If a namespace is not specified it is assumed to be
@@ -69,6 +134,18 @@ namespace OpcUa
     Node GetChild(const std::vector<std::string>& path) const;
     Node GetChild(const std::string& browsename) const;
 
+    /// @brief Resolve several paths at once with one TranslateBrowsePathsToNodeIds call per chunk.
+    /// Paths are in the same format as for GetChild. String paths are parsed on every call,
+    /// callers resolving the same paths repeatedly should parse them once and pass QualifiedNames.
+    /// @return Result for every path in the same order. Not found paths have bad status instead of exception.
+    std::vector<ChildSearchResult> GetChildren(const std::vector<std::vector<std::string>>& paths, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest) const;
+    std::vector<ChildSearchResult> GetChildren(const std::vector<std::vector<QualifiedName>>& paths, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest) const;
+
+    /// @brief Resolve paths reusing prefixes already resolved by the cache.
+    /// Only unresolved parts of paths are sent to server.
+    std::vector<ChildSearchResult> GetChildren(const std::vector<std::vector<std::string>>& paths, BrowsePathCache& cache) const;
+    std::vector<ChildSearchResult> GetChildren(const std::vector<std::vector<QualifiedName>>& paths, BrowsePathCache& cache) const;
+
     std::vector<Node> GetProperties() const {return GetChildren(OpcUa::ReferenceID::HasProperty);}
     std::vector<Node> GetVariables() const {return GetChildren(OpcUa::ReferenceID::HasComponent);} //Not correct should filter by variable type
 
@@ -77,10 +154,9 @@ namespace OpcUa
     //TODO: How to get Referencies?
 
     //The Read and Write methods read or write attributes of the node
-    //FIXME: add possibility to read and write several nodes at once
+    //To read or write several nodes at once use ReadAttributes/WriteAttributes below.
     Variant GetAttribute(AttributeID attr) const;
     StatusCode SetAttribute(AttributeID attr, const Variant &val);
-    //std::vector<StatusCode> WriteAttrs(OpcUa::AttributeID attr, const Variant &val);
 
     Variant GetValue() const;
     StatusCode SetValue(const Variant& value);
@@ -112,17 +188,65 @@ namespace OpcUa
 
     bool operator==(Node const& x) const { return Id == x.Id; }
     bool operator!=(Node const& x) const { return Id != x.Id; }
-    //Node& operator=(const Node& x) { Id = x.Id; BrowseName = x.BrowseName; Server = x.GetServer(); return *this; }
 
   private:
     OpcUa::Remote::Server::SharedPtr Server;
     NodeID Id;
-    QualifiedName BrowseName;
+    // BrowseName is written once before BrowseNameResolved is set and never changed after.
+    mutable QualifiedName BrowseName;
+    mutable std::atomic<bool> BrowseNameResolved;
   };
 
 
+  /// @brief Result of resolving one path by Node::GetChildren.
+  struct ChildSearchResult
+  {
+    StatusCode Status;
+    /// @brief Found node. If status is bad then node has null id.
+    Node Target;
+
+    ChildSearchResult(StatusCode status, const Node& target)
+      : Status(status)
+      , Target(target)
+    {
+    }
+  };
+
   std::ostream& operator<<(std::ostream& os, const Node& node);
 
+  /// @brief Read several attributes with one Read call per chunk of maxItemsPerRequest items.
+  /// @return Values in the same order as attributes. Missing results are returned with BadUnexpectedError status.
+  std::vector<DataValue> ReadAttributes(Remote::Server::SharedPtr server, const std::vector<AttributeValueID>& attributes, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+
+  /// @brief Read the same attribute of several nodes at once.
+  std::vector<DataValue> ReadAttributes(Remote::Server::SharedPtr server, const std::vector<Node>& nodes, AttributeID attr, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+
+  /// @brief Read values of several nodes at once.
+  std::vector<DataValue> ReadValues(Remote::Server::SharedPtr server, const std::vector<Node>& nodes, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+
+  /// @brief Value of an attribute of a node to write with WriteAttributes.
+  struct NodeAttributeValue
+  {
+    Node Target;
+    AttributeID Attribute;
+    Variant Value;
+
+    NodeAttributeValue(const Node& node, AttributeID attr, const Variant& value)
+      : Target(node)
+      , Attribute(attr)
+      , Value(value)
+    {
+    }
+  };
+
+  /// @brief Write several attributes with one Write call per chunk of maxItemsPerRequest items.
+  /// @return Status codes in the same order as values. Missing results are returned as BadUnexpectedError.
+  std::vector<StatusCode> WriteAttributes(Remote::Server::SharedPtr server, const std::vector<WriteValue>& values, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+  std::vector<StatusCode> WriteAttributes(Remote::Server::SharedPtr server, const std::vector<NodeAttributeValue>& values, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+
+  /// @brief Write values of several nodes at once. nodes and values must have the same size.
+  std::vector<StatusCode> WriteValues(Remote::Server::SharedPtr server, const std::vector<Node>& nodes, const std::vector<Variant>& values, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+
   ObjectID VariantTypeToDataType(VariantType vt);
 
 } // namespace OpcUa
@@ -0,0 +1,84 @@
+/// @brief Batch creation of nodes.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+#include <opc/ua/node.h>
+
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct NodeBuilderResult
+  {
+    /// @brief Results of added nodes in order of adding.
+    /// Nodes the server returned no result for have BadUnexpectedError status.
+    std::vector<AddNodesResult> Nodes;
+    /// @brief Results of added references in order of adding, BadUnexpectedError if missing.
+    std::vector<StatusCode> References;
+  };
+
+  /// @brief Accumulates folders, variables and properties and adds them to the server
+  /// with one AddNodes call per chunk instead of separate call for every attribute.
+  /// A chunk of nodes is sent as soon as it is full, so the builder keeps at most one chunk
+  /// in memory and methods adding nodes can throw errors of AddNodes. References are sent by Commit.
+  /// Nodes get the same attributes as created by Node::AddFolder, Node::AddVariable and Node::AddProperty.
+  /// Parent and type definition references are created by server from AddNodesItem.
+  class NodeBuilder
+  {
+  public:
+    DEFINE_CLASS_POINTERS(NodeBuilder);
+
+  public:
+    explicit NodeBuilder(Remote::Server::SharedPtr server, std::size_t maxItemsPerRequest = DefaultMaxItemsPerRequest);
+
+    /// @brief Preallocate memory for nodes and their results.
+    void Reserve(std::size_t nodesCount);
+
+    /// @brief Methods without node id generate numeric id in the namespace of parent.
+    /// @return Id of the node which will be added.
+    NodeID AddFolder(const NodeID& parent, const NodeID& folderId, const QualifiedName& browseName);
+    NodeID AddFolder(const NodeID& parent, const QualifiedName& browseName);
+
+    NodeID AddVariable(const NodeID& parent, const NodeID& variableId, const QualifiedName& browseName, const Variant& value);
+    NodeID AddVariable(const NodeID& parent, const QualifiedName& browseName, const Variant& value);
+
+    NodeID AddProperty(const NodeID& parent, const NodeID& propertyId, const QualifiedName& browseName, const Variant& value);
+    NodeID AddProperty(const NodeID& parent, const QualifiedName& browseName, const Variant& value);
+
+    /// @brief Add prepared item as is.
+    void AddNode(const AddNodesItem& item);
+    void AddReference(const AddReferencesItem& item);
+
+    /// @brief Number of nodes not sent to server yet.
+    std::size_t Size() const;
+
+    /// @brief Send remaining nodes and then references to server. Builder becomes empty.
+    /// @return Results of all nodes added since previous commit.
+    NodeBuilderResult Commit();
+
+  public:
+    static AddNodesItem CreateFolderItem(const NodeID& parent, const NodeID& folderId, const QualifiedName& browseName);
+    static AddNodesItem CreateVariableItem(const NodeID& parent, const NodeID& variableId, const QualifiedName& browseName, const Variant& value);
+    static AddNodesItem CreatePropertyItem(const NodeID& parent, const NodeID& propertyId, const QualifiedName& browseName, const Variant& value);
+
+  private:
+    void SendFullChunk();
+    void SendNodes();
+
+  private:
+    Remote::Server::SharedPtr Server;
+    const std::size_t MaxItemsPerRequest;
+    std::vector<AddNodesItem> Nodes;
+    std::vector<AddReferencesItem> References;
+    std::vector<AddNodesResult> AddedNodes;
+  };
+
+} // namespace OpcUa
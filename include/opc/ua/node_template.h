@@ -0,0 +1,74 @@
+/// @brief Reusable subtrees of address space.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+#include <opc/ua/node_builder.h>
+
+#include <vector>
+
+namespace OpcUa
+{
+
+  /// @brief Description of a subtree which can be instantiated many times.
+  /// Template keeps ready AddNodesItems, instantiation only copies them and
+  /// replaces node ids, parents and browse name of the root.
+  class NodeTemplate
+  {
+  public:
+    DEFINE_CLASS_POINTERS(NodeTemplate);
+
+    /// @brief Index of a node inside template.
+    typedef std::size_t Handle;
+    static const Handle Root = 0;
+
+  public:
+    /// @brief Template with a folder as root.
+    explicit NodeTemplate(const QualifiedName& rootName);
+
+    /// @brief Capture existing subtree of address space.
+    /// Root keeps its class: an object root becomes a folder and a variable root a variable with its current value.
+    /// Other objects become folders, variables referenced with HasProperty become properties and other variables become variables with their current values.
+    static NodeTemplate Capture(const Node& root, uint32_t depth);
+
+    Handle AddFolder(Handle parent, const QualifiedName& browseName);
+    Handle AddVariable(Handle parent, const QualifiedName& browseName, const Variant& value);
+    Handle AddProperty(Handle parent, const QualifiedName& browseName, const Variant& value);
+
+    /// @brief Number of nodes including root.
+    std::size_t Size() const;
+
+    /// @brief Add one instance to the builder under parent node.
+    /// Node ids are generated in the namespace of parent.
+    /// @return Ids of instance nodes indexed by template handles.
+    std::vector<NodeID> Instantiate(NodeBuilder& builder, const NodeID& parent, const QualifiedName& rootName) const;
+
+    /// @brief Create instance for every root name under parent and commit them with batched AddNodes calls.
+    /// All nodes are sent even if some of them fail, nodes which were added stay in address space.
+    /// @return Ids of roots of instances.
+    /// @throws std::runtime_error if server did not add one of the nodes.
+    std::vector<NodeID> Instantiate(Remote::Server::SharedPtr server, const NodeID& parent, const std::vector<QualifiedName>& rootNames) const;
+
+  private:
+    struct TemplateNode
+    {
+      Handle Parent;
+      AddNodesItem Item;
+    };
+
+  private:
+    NodeTemplate();
+
+    Handle Add(Handle parent, const AddNodesItem& item);
+
+  private:
+    std::vector<TemplateNode> Nodes;
+  };
+
+} // namespace OpcUa
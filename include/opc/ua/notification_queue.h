@@ -0,0 +1,180 @@
+/// @brief Bounded queues of data change notifications.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/buffer_pool.h>
+#include <opc/common/class_pointers.h>
+#include <opc/common/mpsc_queue.h>
+#include <opc/ua/sampling_engine.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/uio.h>
+#include <unordered_map>
+#include <vector>
+
+namespace OpcUa
+{
+
+  enum class QueueOverflowPolicy
+  {
+    /// @brief Full queue drops its oldest notification to accept a new one.
+    DiscardOldest,
+    /// @brief Full queue drops new notifications.
+    DiscardNewest,
+  };
+
+  typedef std::shared_ptr<const std::vector<char>> EncodedValue;
+
+  /// @brief Data change notification with value already encoded in OPC UA binary.
+  struct EncodedNotification
+  {
+    IntegerID ClientHandle;
+    /// @brief Encoded DataValue, shared by notifications of all subscriptions which got the same change.
+    EncodedValue Value;
+  };
+
+  /// @brief PublishResult encoded in OPC UA binary for sending with vectored I/O.
+  struct EncodedPublishResult
+  {
+    IntegerID SubscriptionID;
+    IntegerID SequenceID;
+    bool MoreNotifications;
+    /// @brief Parts of encoded PublishResult in order of sending, e.g. with SocketChannel::SendV.
+    /// Response header and secure channel headers are not included.
+    std::vector<iovec> Parts;
+    /// @brief Buffers referenced by parts.
+    std::vector<EncodedValue> Buffers;
+
+    /// @brief Total size of parts in bytes.
+    std::size_t GetSize() const;
+  };
+
+  /// @brief Item of a subscription which gets a value.
+  struct NotificationTarget
+  {
+    IntegerID SubscriptionID;
+    IntegerID ClientHandle;
+  };
+
+  /// @brief Notifications of one subscription waiting for publishing.
+  /// Storage for capacity notifications is allocated once. A notification for an item
+  /// which is already queued replaces the value in place, so a slow client gets
+  /// the latest value of every item instead of the whole history.
+  /// Notification is MonitoredItems or EncodedNotification.
+  template <typename Notification>
+  class BasicNotificationQueue
+  {
+  public:
+    DEFINE_CLASS_POINTERS(BasicNotificationQueue);
+
+  public:
+    explicit BasicNotificationQueue(std::size_t capacity, QueueOverflowPolicy policy = QueueOverflowPolicy::DiscardOldest);
+
+    void Push(const Notification& item);
+    /// @brief Move up to maxCount oldest notifications to result, 0 - all of them.
+    /// @return Number of moved notifications.
+    std::size_t Pop(std::vector<Notification>& result, std::size_t maxCount = 0);
+
+    std::size_t Size() const;
+    std::size_t Capacity() const;
+    /// @brief Number of notifications dropped because queue was full.
+    uint64_t GetDiscarded() const;
+
+  private:
+    void DropOldest();
+
+  private:
+    const QueueOverflowPolicy Policy;
+    // Ring buffer of Count items starting from Head.
+    std::vector<Notification> Items;
+    std::size_t Head;
+    std::size_t Count;
+    uint64_t Discarded;
+    // Position in ring of every queued client handle.
+    std::unordered_map<IntegerID, std::size_t> Positions;
+  };
+
+  typedef BasicNotificationQueue<MonitoredItems> NotificationQueue;
+  typedef BasicNotificationQueue<EncodedNotification> EncodedNotificationQueue;
+
+  /// @brief Queues of all subscriptions fed by SamplingEngine.
+  /// Sampling threads hand changes over through a lock free queue and never wait for
+  /// publishing. Changes are moved to subscription queues by PopPublishResults or by
+  /// a sampling thread which finds the queues not locked.
+  ///
+  /// In encoded mode values are encoded into pooled buffers by the thread which
+  /// produced them, and publishing only joins ready buffers instead of encoding
+  /// the whole PublishResult again.
+  class NotificationQueues : public SamplingSink
+  {
+  public:
+    DEFINE_CLASS_POINTERS(NotificationQueues);
+
+  public:
+    /// @param pool enables encoded mode, buffers of encoded values are taken from it.
+    /// Results of encoded mode are taken with PopEncodedPublishResults, otherwise with PopPublishResults.
+    explicit NotificationQueues(Common::BufferPool::SharedPtr pool = Common::BufferPool::SharedPtr());
+
+    void AddSubscription(IntegerID subscriptionId, std::size_t capacity, QueueOverflowPolicy policy = QueueOverflowPolicy::DiscardOldest);
+    void RemoveSubscription(IntegerID subscriptionId);
+
+    virtual void OnDataChange(std::vector<SampledChange>& changes);
+    /// @brief Queue one value for items of many subscriptions.
+    /// In encoded mode the value is encoded once and all subscriptions share its bytes.
+    void OnDataChange(const DataValue& value, const std::vector<NotificationTarget>& targets);
+
+    /// @brief Build publish results of subscriptions which have notifications.
+    /// @param maxNotificationsPerPublish 0 - unlimited. Rest stays in queue and MoreNotifications is set.
+    std::vector<PublishResult> PopPublishResults(const std::vector<IntegerID>& subscriptionsIds, std::size_t maxNotificationsPerPublish = 0);
+    /// @brief The same as PopPublishResults for encoded mode.
+    std::vector<EncodedPublishResult> PopEncodedPublishResults(const std::vector<IntegerID>& subscriptionsIds, std::size_t maxNotificationsPerPublish = 0);
+
+  private:
+    struct Subscription
+    {
+      // Only the queue of current mode gets the capacity.
+      NotificationQueue Queue;
+      EncodedNotificationQueue EncodedQueue;
+      IntegerID SequenceNumber;
+
+      Subscription(std::size_t capacity, QueueOverflowPolicy policy, bool encoded)
+        : Queue(encoded ? 0 : capacity, policy)
+        , EncodedQueue(encoded ? capacity : 0, policy)
+        , SequenceNumber(0)
+      {
+      }
+    };
+
+    struct EncodedChange
+    {
+      IntegerID SubscriptionID;
+      EncodedNotification Item;
+    };
+
+    // Changes of one OnDataChange call, only the vector of current mode is filled.
+    struct PendingBatch
+    {
+      std::vector<SampledChange> Changes;
+      std::vector<EncodedChange> EncodedChanges;
+    };
+
+  private:
+    void MovePendingChanges();
+    void PushPending(PendingBatch batch);
+
+  private:
+    const Common::BufferPool::SharedPtr Pool;
+    Common::MpscQueue<PendingBatch> PendingChanges;
+    std::mutex Mutex;
+    std::map<IntegerID, std::unique_ptr<Subscription>> Subscriptions;
+  };
+
+} // namespace OpcUa
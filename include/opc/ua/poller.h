@@ -0,0 +1,56 @@
+/// @brief Readiness multiplexing of many socket channels.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#ifndef OPC_UA_POLLER_H
+#define OPC_UA_POLLER_H
+
+#include <opc/common/class_pointers.h>
+#include <opc/ua/socket_channel.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace OpcUa
+{
+
+  /// @brief Waits for incoming data on many channels at once with epoll.
+  /// One thread can serve thousands of connections instead of a blocked thread per socket.
+  /// Channels can be added and removed from any thread, Wait is called by one thread.
+  class Poller
+  {
+  public:
+    DEFINE_CLASS_POINTERS(Poller);
+
+  public:
+    Poller();
+    ~Poller();
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    /// @brief Start watching the channel. Channel is switched to non blocking mode.
+    void Add(std::shared_ptr<SocketChannel> channel);
+    void Remove(const SocketChannel& channel);
+    std::size_t Size() const;
+
+    /// @brief Wait until some channels have data or were closed by peer.
+    /// @param second timeout, negative value - wait infinitely.
+    /// @return Ready channels. Empty if timeout expired.
+    std::vector<std::shared_ptr<SocketChannel>> Wait(float second);
+
+  private:
+    int Epoll;
+    mutable std::mutex Mutex;
+    std::map<int, std::shared_ptr<SocketChannel>> Channels;
+  };
+
+} // namespace OpcUa
+
+#endif // OPC_UA_POLLER_H
@@ -0,0 +1,162 @@
+/// @brief Connection listener based on epoll.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#ifndef OPC_UA_REACTOR_LISTENER_H
+#define OPC_UA_REACTOR_LISTENER_H
+
+#include <opc/common/class_pointers.h>
+#include <opc/common/thread.h>
+#include <opc/ua/connection_listener.h>
+#include <opc/ua/socket_channel.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <set>
+#include <string>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <vector>
+
+namespace OpcUa
+{
+  namespace UaServer
+  {
+
+    struct ReactorListenerParameters
+    {
+      /// @brief Address to listen on, empty - all interfaces.
+      std::string Host;
+      /// @brief 0 - any free port, see ReactorConnectionListener::GetPort.
+      unsigned short Port;
+      /// @brief Threads accepting connections. Every thread has own socket bound with SO_REUSEPORT
+      /// and kernel spreads incoming connections between them.
+      unsigned AcceptorThreads;
+      /// @brief Threads calling IncomingConnectionProcessor::Process, started together with listener.
+      /// Process usually serves the whole session, so when all workers are busy
+      /// a new one is started for the next connection, up to MaxWorkerThreads.
+      unsigned WorkerThreads;
+      /// @brief Limit of worker threads, so a flood of connections does not create a thread for each of them.
+      /// Connections accepted when all of them are busy wait in the queue for a session to end.
+      std::size_t MaxWorkerThreads;
+      /// @brief Accepted connections waiting for workers. Connections are rejected when queue is full.
+      std::size_t MaxPendingConnections;
+      /// @brief Channels alive at once including pending ones, 0 - unlimited.
+      /// Channel is alive until processor releases the last pointer to it.
+      std::size_t MaxChannels;
+      /// @brief Connections accepted from one address (IPv6 - /64 network, IPv4 mapped IPv6 - IPv4 address) per second, 0 - unlimited.
+      /// Short bursts up to the same number of connections are allowed.
+      unsigned MaxConnectionsPerSecond;
+      int Backlog;
+
+      ReactorListenerParameters()
+        : Port(0)
+        , AcceptorThreads(1)
+        , WorkerThreads(1)
+        , MaxWorkerThreads(256)
+        , MaxPendingConnections(1024)
+        , MaxChannels(0)
+        , MaxConnectionsPerSecond(0)
+        , Backlog(SOMAXCONN)
+      {
+      }
+    };
+
+    struct ReactorListenerStatistics
+    {
+      uint64_t Accepted;
+      uint64_t Rejected;
+      std::size_t Active;
+      std::size_t Pending;
+
+      ReactorListenerStatistics()
+        : Accepted(0)
+        , Rejected(0)
+        , Active(0)
+        , Pending(0)
+      {
+      }
+    };
+
+    /// @brief Listens TCP port and passes accepted connections to processor.
+    /// Acceptors wait for incoming connections with epoll and take all of them with accept4()
+    /// until EAGAIN, so a burst of reconnecting clients is accepted with a few wakeups.
+    /// Connections over the limits are reset right after accept, before any memory is allocated for them.
+    class ReactorConnectionListener : public ConnectionListener
+    {
+    public:
+      DEFINE_CLASS_POINTERS(ReactorConnectionListener);
+
+    public:
+      explicit ReactorConnectionListener(const ReactorListenerParameters& params);
+      virtual ~ReactorConnectionListener();
+
+      /// @throws Common::Error if socket cannot be bound.
+      virtual void Start(std::shared_ptr<IncomingConnectionProcessor> connectionProcessor);
+      /// @brief Stop threads and close connections which were not passed to processor.
+      /// Channels being processed get IncomingConnectionProcessor::StopProcessing and are shut down,
+      /// so Process blocked in their I/O returns.
+      virtual void Stop();
+
+      /// @brief Port listened after Start.
+      unsigned short GetPort() const;
+
+      ReactorListenerStatistics GetStatistics() const;
+
+    private:
+      int CreateListenSocket(unsigned short port) const;
+      void Accept(int listenSocket);
+      void Work();
+      void StartWorker();
+      bool Admit(int sock, const sockaddr_storage& addr);
+      bool IsRateExceeded(const sockaddr_storage& addr);
+      void CloseSockets();
+
+    private:
+      const ReactorListenerParameters Params;
+      std::shared_ptr<IncomingConnectionProcessor> Processor;
+      unsigned short Port;
+      int StopEvent;
+      std::vector<int> ListenSockets;
+      std::vector<Common::Thread::UniquePtr> Acceptors;
+
+      struct SourceRate
+      {
+        std::string Source;
+        double Tokens;
+        std::chrono::steady_clock::time_point Updated;
+      };
+      typedef std::list<SourceRate> SourceList;
+
+      mutable std::mutex Mutex;
+      std::condition_variable QueueChanged;
+      std::deque<std::shared_ptr<SocketChannel>> Queue;
+      // Channels passed to Process which has not returned yet.
+      std::set<std::shared_ptr<SocketChannel>> Processing;
+      std::vector<Common::Thread::UniquePtr> Workers;
+      // Workers waiting for connections, including started threads which have not taken the lock yet.
+      std::size_t IdleWorkers;
+      std::size_t StartedWorkers;
+      bool Stopping;
+      uint64_t Accepted;
+      uint64_t Rejected;
+      // Shared with deleters of channels which can outlive listener.
+      std::shared_ptr<std::atomic<std::size_t>> Active;
+      // Buckets of recently seen sources, most recent first, limited in number.
+      SourceList Sources;
+      std::unordered_map<std::string, SourceList::iterator> SourceIndex;
+    };
+
+  } // namespace UaServer
+} // namespace OpcUa
+
+#endif // OPC_UA_REACTOR_LISTENER_H
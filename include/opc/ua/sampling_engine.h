@@ -0,0 +1,163 @@
+/// @brief Periodic sampling of monitored items.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#pragma once
+
+#include <opc/common/class_pointers.h>
+#include <opc/common/interface.h>
+#include <opc/common/timer_wheel.h>
+#include <opc/ua/change_detector.h>
+#include <opc/ua/node.h>
+#include <opc/ua/server.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace OpcUa
+{
+
+  /// @brief Changed value of sampled item.
+  struct SampledChange
+  {
+    IntegerID SubscriptionID;
+    MonitoredItems Item;
+  };
+
+  /// @brief Receives changes found by one sampling of a bucket.
+  class SamplingSink : private Common::Interface
+  {
+  public:
+    DEFINE_CLASS_POINTERS(SamplingSink);
+
+  public:
+    /// @brief Called by sampling threads, sink can take changes with swap.
+    virtual void OnDataChange(std::vector<SampledChange>& changes) = 0;
+  };
+
+  struct SamplingStatistics
+  {
+    uint64_t Samples;
+    uint64_t Changes;
+    /// @brief Ticks skipped because previous sampling of the bucket was not finished.
+    uint64_t Overruns;
+
+    SamplingStatistics()
+      : Samples(0)
+      , Changes(0)
+      , Overruns(0)
+    {
+    }
+  };
+
+  typedef uint64_t SampledItemID;
+
+  /// @brief Samples attributes of monitored items and reports changed values.
+  /// Items with equal sampling interval share a bucket served by one periodic timer.
+  /// Every tick reads the whole bucket with one batched Read (or with chunks of
+  /// maxItemsPerRequest items) and finds changed values with ChangeDetector over the whole bucket.
+  /// The first sample of an item is always reported.
+  /// Items can be added and removed while their bucket is sampled, sampling works with a copy
+  /// of the bucket taken when it started. Changes of one bucket are passed to sink in sampling order.
+  class SamplingEngine
+  {
+  public:
+    DEFINE_CLASS_POINTERS(SamplingEngine);
+
+  public:
+    /// @param timers should dispatch to a thread pool so buckets are sampled in parallel.
+    /// @param maxItemsPerRequest 0 - read the whole bucket with one request.
+    SamplingEngine(Remote::Server::SharedPtr server, Common::TimerWheel& timers, SamplingSink::SharedPtr sink, std::size_t maxItemsPerRequest = 0);
+    ~SamplingEngine();
+
+    SamplingEngine(const SamplingEngine&) = delete;
+    SamplingEngine& operator=(const SamplingEngine&) = delete;
+
+    SampledItemID Add(IntegerID subscriptionId, IntegerID clientHandle, const AttributeValueID& attribute, std::chrono::milliseconds interval, const DeadbandFilter& filter = DeadbandFilter());
+    /// @return false if item was not found.
+    bool Remove(SampledItemID id);
+    std::size_t Size() const;
+
+    /// @brief Sample bucket of interval immediately.
+    void Sample(std::chrono::milliseconds interval);
+
+    SamplingStatistics GetStatistics() const;
+
+  private:
+    struct Counters
+    {
+      std::atomic<uint64_t> Samples;
+      std::atomic<uint64_t> Changes;
+      std::atomic<uint64_t> Overruns;
+    };
+
+    /// @brief Items of one interval in parallel arrays, Request is sent to server as is.
+    struct BucketItems
+    {
+      ReadParameters Request;
+      std::vector<IntegerID> Subscriptions;
+      std::vector<IntegerID> ClientHandles;
+    };
+
+    /// @brief Item added to or removed from bucket which detector of the bucket does not know yet.
+    struct DetectorChange
+    {
+      bool Removed;
+      std::size_t Index;
+      DeadbandFilter Filter;
+    };
+
+    struct Bucket
+    {
+      // Engine mutex, guards items and timer of the bucket.
+      std::shared_ptr<std::mutex> Mutex;
+      Common::TimerID Timer;
+      BucketItems Items;
+      std::vector<SampledItemID> Ids;
+      std::vector<DetectorChange> DetectorChanges;
+      // Copy of items taken by sampling, reset when items change.
+      std::shared_ptr<const BucketItems> Snapshot;
+
+      // Held by sampling while it reads values and calls sink, guards detector.
+      std::mutex SamplingMutex;
+      ChangeDetector Detector;
+      std::vector<uint64_t> Changed;
+
+      Remote::Server::SharedPtr Server;
+      SamplingSink::SharedPtr Sink;
+      std::size_t MaxItemsPerRequest;
+      std::shared_ptr<Counters> Statistics;
+    };
+
+    struct Location
+    {
+      int64_t Interval;
+      std::size_t Index;
+    };
+
+  private:
+    static void Sample(Bucket& bucket, bool wait);
+
+  private:
+    Remote::Server::SharedPtr Server;
+    Common::TimerWheel& Timers;
+    SamplingSink::SharedPtr Sink;
+    const std::size_t MaxItemsPerRequest;
+    std::shared_ptr<Counters> Statistics;
+
+    // Shared with buckets which outlive engine while they are sampled.
+    const std::shared_ptr<std::mutex> Mutex;
+    SampledItemID LastID;
+    std::map<int64_t, std::shared_ptr<Bucket>> Buckets;
+    std::unordered_map<SampledItemID, Location> Locations;
+  };
+
+} // namespace OpcUa
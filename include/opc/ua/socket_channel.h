@@ -11,8 +11,17 @@
 #ifndef OPC_UA_CLIENT_SOCKET_CHANNEL_H
 #define OPC_UA_CLIENT_SOCKET_CHANNEL_H
 
+#include <opc/common/timer_wheel.h>
 #include <opc/ua/channel.h>
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+
 namespace OpcUa
 {
 
@@ -26,8 +35,91 @@ namespace OpcUa
     virtual void Send(const char* message, std::size_t size);
     virtual int WaitForData(float second);
 
+    /// @brief Receive whatever is available but at least one byte.
+    /// @return Number of received bytes.
+    std::size_t ReceiveSome(char* data, std::size_t size);
+
+    /// @brief Send all buffers in one sendmsg() call, short writes are continued.
+    /// Header and body of a message can be sent without joining them.
+    void SendV(const iovec* buffers, std::size_t count);
+    /// @brief Fill all buffers with readv().
+    /// @return Total number of received bytes.
+    std::size_t ReceiveV(const iovec* buffers, std::size_t count);
+
+    /// @brief Send count bytes of a file starting from offset with sendfile().
+    /// Data goes from page cache to socket without copying through user space.
+    void SendFile(int fd, off_t offset, std::size_t count);
+    /// @brief Send memory (e.g. memory mapped file) through a pipe with vmsplice()/splice().
+    /// Pages are referenced, not copied, and can stay in flight after return,
+    /// so use it for read only data like mapped files and blobs which are not modified.
+    /// Falls back to Send if splicing is not supported.
+    void SendMapped(const char* data, std::size_t size);
+
+    /// @brief Collect small messages in memory and send them with one syscall.
+    /// Buffered data is sent when it would exceed maxBuffered bytes, when Send finds that
+    /// the oldest buffered message waits longer than maxDelay seconds (0 - no time limit),
+    /// on Flush and before any receiving so requests are never stuck in the buffer.
+    /// Receiving waits for a concurrent send only while there is buffered data.
+    /// The delay is checked only by Send, a channel which stops sending keeps buffered data
+    /// until Flush or receiving. Use the overload with timers to limit the delay anyway.
+    void EnableWriteBatching(std::size_t maxBuffered, float maxDelay = 0);
+    /// @brief The same, but buffered data is also sent by a timer maxDelay seconds after the
+    /// first buffered message, so it is not kept by an idle channel. Timers must outlive the channel.
+    /// The timer waits for a send blocked by another thread, so use timers with a thread pool
+    /// if other timers must not be delayed by slow peers.
+    void EnableWriteBatching(std::size_t maxBuffered, float maxDelay, Common::TimerWheel& timers);
+    /// @brief Flush buffered data and send every message immediately.
+    void DisableWriteBatching();
+    /// @brief Send buffered data.
+    void Flush();
+
+    int GetSocket() const;
+
+    /// @brief Switch socket to non blocking mode.
+    /// Receive and Send keep their semantics and wait for readiness with poll()
+    /// when socket would block. Channels used with Poller should be non blocking.
+    void SetNonBlocking(bool nonBlocking);
+    bool IsNonBlocking() const;
+
+  private:
+    // Sending methods and batching settings are serialized with the mutex, so the flush timer
+    // can send from its thread. Timer callbacks share the state and find the channel
+    // reset after destruction.
+    struct SendState
+    {
+      std::mutex Mutex;
+      SocketChannel* Channel;
+
+      explicit SendState(SocketChannel* channel)
+        : Channel(channel)
+      {
+      }
+    };
+
+  private:
+    void WaitFor(short events);
+    void SendAll(std::vector<iovec>& buffers);
+    void FlushBeforeReceive();
+    // Methods below are called with the send mutex locked.
+    void SendLocked(const char* message, std::size_t size);
+    void SendVLocked(const iovec* buffers, std::size_t count);
+    void FlushLocked();
+    void FlushExpiredLocked();
+    void ScheduleFlushLocked();
+
   private:
     int Socket;
+    bool NonBlocking;
+    const std::shared_ptr<SendState> State;
+    // Checked by receiving without the lock.
+    std::atomic<bool> HasPending;
+    bool Batching;
+    std::size_t MaxBuffered;
+    std::chrono::steady_clock::duration MaxDelay;
+    std::chrono::steady_clock::time_point FirstPendingTime;
+    std::vector<char> Pending;
+    Common::TimerWheel* Timers;
+    Common::TimerID FlushTimer;
   };
 
 }
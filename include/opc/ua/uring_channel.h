@@ -0,0 +1,150 @@
+/// @brief Channel based on Linux io_uring.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#ifndef OPC_UA_URING_CHANNEL_H
+#define OPC_UA_URING_CHANNEL_H
+
+#include <opc/common/class_pointers.h>
+#include <opc/ua/channel.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace OpcUa
+{
+
+  /// @brief Submission and completion rings shared by many channels.
+  /// Operations are queued by any thread and started in batches: one io_uring_enter()
+  /// call of Submit starts every operation queued since the previous call, whatever
+  /// socket it belongs to. Own thread of the ring waits for completions and calls
+  /// callbacks of completed operations.
+  ///
+  /// Only batches are faster than plain sockets. Receive, Send and Poll wait until the
+  /// completion thread hands the result back through a condition variable, which costs a
+  /// thread switch per operation: UringChannel, which uses them, made about 62k round trips/s
+  /// against 99k of SocketChannel. Callers which own many sockets should queue operations of
+  /// all of them and call Submit once.
+  class Uring
+  {
+  public:
+    DEFINE_CLASS_POINTERS(Uring);
+
+    /// @brief Result of operation, negative errno on failure.
+    typedef std::function<void(int result)> Callback;
+
+  public:
+    /// @throws Common::Error if kernel does not support io_uring.
+    explicit Uring(unsigned entries = 256);
+    /// @brief Operations which are still in flight complete with -ECANCELED.
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    /// @return Ring or null pointer if kernel does not support io_uring.
+    static SharedPtr TryCreate(unsigned entries = 256);
+
+    /// @brief Queue recv()/send()/poll() without starting it.
+    /// Buffer must stay valid until callback is called. Callback is called by the completion
+    /// thread, or by Submit if kernel refused the operation. When submission ring is full
+    /// queued operations are submitted to free it.
+    void QueueReceive(int sock, char* data, std::size_t size, int flags, Callback callback);
+    void QueueSend(int sock, const char* data, std::size_t size, int flags, Callback callback);
+    void QueuePoll(int sock, short events, Callback callback);
+
+    /// @brief Start all queued operations with one io_uring_enter() call.
+    /// Returns immediately if another thread has already submitted them.
+    /// @return Number of started operations.
+    unsigned Submit();
+
+    /// @brief Queue operation, submit it together with operations queued by other threads and wait for the result.
+    /// Result comes back from the completion thread, see the note on performance above.
+    /// @return Result of operation, negative errno on failure.
+    int Receive(int sock, char* data, std::size_t size, int flags);
+    int Send(int sock, const char* data, std::size_t size, int flags);
+    int Poll(int sock, short events);
+
+  private:
+    struct Operation;
+
+    void Queue(uint8_t opcode, int sock, const char* data, std::size_t size, int flags, Callback callback);
+    int Execute(uint8_t opcode, int sock, const char* data, std::size_t size, int flags);
+    io_uring_sqe* NextSqe(std::unique_lock<std::mutex>& lock);
+    void PushSqe();
+    unsigned SubmitQueued(std::unique_lock<std::mutex>& lock);
+    void Reap();
+    void Unmap();
+
+  private:
+    int Ring;
+    void* SqRing;
+    std::size_t SqRingSize;
+    void* CqRing;
+    std::size_t CqRingSize;
+    io_uring_sqe* Sqes;
+    std::size_t SqesSize;
+
+    unsigned* SqHead;
+    unsigned* SqTail;
+    unsigned* SqMask;
+    unsigned* SqArray;
+    unsigned SqEntries;
+    unsigned* CqHead;
+    unsigned* CqTail;
+    unsigned* CqMask;
+    io_uring_cqe* Cqes;
+
+    // Guards submission ring and the set of operations.
+    std::mutex Mutex;
+    // Signalled by completion thread when kernel can accept new operations.
+    std::condition_variable Reaped;
+    unsigned Unsubmitted;
+    // Queued and started operations, owned by the ring until completion.
+    std::unordered_set<Operation*> Operations;
+    std::thread Reaper;
+  };
+
+  /// @brief Socket channel which receives and sends through io_uring.
+  /// Has the same semantics as SocketChannel. Operations of all channels of a ring
+  /// which are called at the same time are started by one system call. If kernel does not
+  /// support socket operations in io_uring the channel uses recv()/send() directly.
+  class UringChannel : public OpcUa::IOChannel
+  {
+  public:
+    UringChannel(int sock, Uring::SharedPtr ring);
+    virtual ~UringChannel();
+
+    virtual std::size_t Receive(char* data, std::size_t size);
+    virtual void Send(const char* message, std::size_t size);
+    virtual int WaitForData(float second);
+
+  private:
+    void WaitFor(short events);
+
+  private:
+    int Socket;
+    Uring::SharedPtr Ring;
+    std::atomic<bool> Fallback;
+  };
+
+  /// @brief Create UringChannel if ring is not null and SocketChannel otherwise,
+  /// so callers can pass result of Uring::TryCreate as is.
+  std::shared_ptr<IOChannel> CreateSocketChannel(int sock, Uring::SharedPtr ring);
+
+} // namespace OpcUa
+
+#endif // OPC_UA_URING_CHANNEL_H
@@ -32,6 +32,31 @@ namespace OpcUa
       virtual std::vector<ReferenceDescription> Browse(const OpcUa::NodesQuery& query) const = 0;
       virtual std::vector<ReferenceDescription> BrowseNext() const = 0;
       virtual std::vector<BrowsePathResult> TranslateBrowsePathsToNodeIds(const TranslateBrowsePathsParameters& params) const = 0;
+
+      /// @brief Browse all nodes of the query following continuation points.
+      /// @return References of every node of the query in the same order.
+      /// Browse returns references of all nodes in one list and BrowseNext continues only the last
+      /// request, so by default nodes are browsed one by one. Services which keep results of
+      /// a browse response per node should override it and send the whole query at once.
+      /// No services of this library override it yet, so every node still costs one Browse
+      /// round trip plus one per continuation point.
+      virtual std::vector<std::vector<ReferenceDescription>> BrowseNodes(const OpcUa::NodesQuery& query) const
+      {
+        std::vector<std::vector<ReferenceDescription>> result;
+        result.reserve(query.NodesToBrowse.size());
+        OpcUa::NodesQuery single = query;
+        for (const BrowseDescription& description : query.NodesToBrowse)
+        {
+          single.NodesToBrowse.assign(1, description);
+          std::vector<ReferenceDescription> references;
+          for (std::vector<ReferenceDescription> refs = Browse(single); !refs.empty(); refs = BrowseNext())
+          {
+            references.insert(references.end(), refs.begin(), refs.end());
+          }
+          result.push_back(references);
+        }
+        return result;
+      }
     };
 
   } // namespace Remote
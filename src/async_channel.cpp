@@ -0,0 +1,266 @@
+/// @brief Asynchronous completion based channels.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/async_channel.h>
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+namespace OpcUa
+{
+
+  AsyncSocketChannel::SharedPtr AsyncSocketChannel::Create(std::shared_ptr<SocketChannel> channel, EventLoop& loop)
+  {
+    SharedPtr result(new AsyncSocketChannel(channel, loop));
+    loop.Add(channel->GetSocket(), result);
+    return result;
+  }
+
+  AsyncSocketChannel::AsyncSocketChannel(std::shared_ptr<SocketChannel> channel, EventLoop& loop)
+    : Channel(channel)
+    , Loop(loop)
+    , Dispatching(false)
+  {
+    Channel->DisableWriteBatching();
+    Channel->SetNonBlocking(true);
+  }
+
+  AsyncSocketChannel::~AsyncSocketChannel()
+  {
+    Loop.Remove(Channel->GetSocket());
+
+    std::vector<Completed> completed;
+    completed.swap(Pending);
+    CancelAll(ECANCELED, completed);
+    if (!completed.empty())
+    {
+      Loop.Post([completed]()
+      {
+        for (const Completed& operation : completed)
+        {
+          operation.Completion(operation.Error, operation.Bytes);
+        }
+      });
+    }
+  }
+
+  void AsyncSocketChannel::AsyncReceive(char* data, std::size_t size, IOCompletion completion)
+  {
+    Start(Receives, data, size, false, completion);
+  }
+
+  void AsyncSocketChannel::AsyncReceiveSome(char* data, std::size_t size, IOCompletion completion)
+  {
+    Start(Receives, data, size, true, completion);
+  }
+
+  void AsyncSocketChannel::AsyncSend(const char* message, std::size_t size, IOCompletion completion)
+  {
+    Start(Sends, const_cast<char*>(message), size, false, completion);
+  }
+
+  void AsyncSocketChannel::Cancel()
+  {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      CancelAll(ECANCELED, Pending);
+      if (Pending.empty())
+      {
+        return;
+      }
+    }
+    // Completions are always called by the loop, never by the thread starting or cancelling.
+    SharedPtr self = shared_from_this();
+    Loop.Post([self]()
+    {
+      std::unique_lock<std::mutex> lock(self->Mutex);
+      self->Dispatch(lock);
+    });
+  }
+
+  std::shared_ptr<SocketChannel> AsyncSocketChannel::GetChannel() const
+  {
+    return Channel;
+  }
+
+  void AsyncSocketChannel::Start(std::deque<Operation>& queue, char* data, std::size_t size, bool some, IOCompletion completion)
+  {
+    Operation operation;
+    operation.Data = data;
+    operation.Size = size;
+    operation.Transferred = 0;
+    operation.Some = some;
+    operation.Completion = completion;
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    queue.push_back(operation);
+    // Dispatching thread arms the socket after completions.
+    if (!Dispatching)
+    {
+      Arm();
+    }
+  }
+
+  void AsyncSocketChannel::OnReady(uint32_t events)
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+    {
+      ProgressReceives(Pending);
+    }
+    if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+    {
+      ProgressSends(Pending);
+    }
+    Dispatch(lock);
+  }
+
+  void AsyncSocketChannel::ProgressReceives(std::vector<Completed>& completed)
+  {
+    while (!Receives.empty())
+    {
+      Operation& operation = Receives.front();
+      int error = 0;
+      if (operation.Transferred < operation.Size)
+      {
+        const ssize_t received = recv(Channel->GetSocket(), operation.Data + operation.Transferred, operation.Size - operation.Transferred, 0);
+        if (received < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+          return;
+        }
+        error = received < 0 ? errno : received == 0 ? ECONNRESET : 0;
+        operation.Transferred += received > 0 ? received : 0;
+      }
+
+      if (!error && !operation.Some && operation.Transferred < operation.Size)
+      {
+        continue;
+      }
+      Completed result = {operation.Completion, error, operation.Transferred};
+      completed.push_back(result);
+      Receives.pop_front();
+    }
+  }
+
+  void AsyncSocketChannel::ProgressSends(std::vector<Completed>& completed)
+  {
+    while (!Sends.empty())
+    {
+      Operation& operation = Sends.front();
+      int error = 0;
+      if (operation.Transferred < operation.Size)
+      {
+        const ssize_t sent = send(Channel->GetSocket(), operation.Data + operation.Transferred, operation.Size - operation.Transferred, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+          return;
+        }
+        error = sent < 0 ? errno : 0;
+        operation.Transferred += sent > 0 ? sent : 0;
+      }
+
+      if (!error && operation.Transferred < operation.Size)
+      {
+        continue;
+      }
+      Completed result = {operation.Completion, error, operation.Transferred};
+      completed.push_back(result);
+      Sends.pop_front();
+    }
+  }
+
+  void AsyncSocketChannel::CancelAll(int error, std::vector<Completed>& completed)
+  {
+    for (std::deque<Operation>* queue : {&Receives, &Sends})
+    {
+      for (const Operation& operation : *queue)
+      {
+        Completed result = {operation.Completion, error, operation.Transferred};
+        completed.push_back(result);
+      }
+      queue->clear();
+    }
+  }
+
+  void AsyncSocketChannel::Dispatch(std::unique_lock<std::mutex>& lock)
+  {
+    // Another thread is calling completions of this channel, it will call these too.
+    if (Dispatching)
+    {
+      return;
+    }
+
+    // Socket is not armed until completions are called, so the next readiness
+    // cannot be handled by another thread in the meantime.
+    Dispatching = true;
+    std::vector<Completed> completed;
+    while (!Pending.empty())
+    {
+      completed.clear();
+      completed.swap(Pending);
+      lock.unlock();
+      std::size_t called = 0;
+      try
+      {
+        // Completions can start new operations on this channel.
+        for (; called < completed.size(); ++called)
+        {
+          completed[called].Completion(completed[called].Error, completed[called].Bytes);
+        }
+      }
+      catch (...)
+      {
+        // Exception goes to the loop, the rest is dispatched by the next loop iteration.
+        lock.lock();
+        Pending.insert(Pending.begin(), completed.begin() + called + 1, completed.end());
+        Dispatching = false;
+        Arm();
+        if (!Pending.empty())
+        {
+          SharedPtr self = shared_from_this();
+          Loop.Post([self]()
+          {
+            std::unique_lock<std::mutex> lock(self->Mutex);
+            self->Dispatch(lock);
+          });
+        }
+        throw;
+      }
+      lock.lock();
+    }
+    Dispatching = false;
+    Arm();
+  }
+
+  void AsyncSocketChannel::Arm()
+  {
+    uint32_t events = 0;
+    if (!Receives.empty())
+    {
+      events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (!Sends.empty())
+    {
+      events |= EPOLLOUT;
+    }
+    if (events)
+    {
+      Loop.Arm(Channel->GetSocket(), events);
+    }
+  }
+
+} // namespace OpcUa
@@ -0,0 +1,343 @@
+/// @brief Client side cache of node attributes.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/attribute_cache.h>
+
+#include <algorithm>
+
+namespace
+{
+  using namespace OpcUa;
+
+  struct ReadGuard
+  {
+    AttributeCache& Cache;
+    const uint64_t Generation;
+
+    explicit ReadGuard(AttributeCache& cache)
+      : Cache(cache)
+      , Generation(cache.StartRead())
+    {
+    }
+
+    ~ReadGuard()
+    {
+      Cache.FinishRead();
+    }
+  };
+
+  class CachedAttributeServices : public Remote::AttributeServices
+  {
+  public:
+    CachedAttributeServices(Remote::AttributeServices::SharedPtr attributes, AttributeCache::SharedPtr cache)
+      : Attributes(attributes)
+      , Cache(cache)
+    {
+    }
+
+    virtual std::vector<DataValue> Read(const OpcUa::ReadParameters& params) const
+    {
+      std::vector<DataValue> result(params.AttributesToRead.size());
+      std::vector<std::size_t> missed;
+      ReadParameters missedParams = params;
+      missedParams.AttributesToRead.clear();
+
+      for (std::size_t i = 0; i < params.AttributesToRead.size(); ++i)
+      {
+        const AttributeValueID& attribute = params.AttributesToRead[i];
+        if (Cache->IsCacheable(attribute.Attribute) && attribute.IndexRange.empty() && Cache->Get(attribute.Node, attribute.Attribute, result[i]))
+        {
+          continue;
+        }
+        missed.push_back(i);
+        missedParams.AttributesToRead.push_back(attribute);
+      }
+
+      if (missed.empty())
+      {
+        return result;
+      }
+
+      const ReadGuard guard(*Cache);
+      const std::vector<DataValue> values = Attributes->Read(missedParams);
+      for (std::size_t i = 0; i < missed.size() && i < values.size(); ++i)
+      {
+        const AttributeValueID& attribute = missedParams.AttributesToRead[i];
+        result[missed[i]] = values[i];
+        if (Cache->IsCacheable(attribute.Attribute) && attribute.IndexRange.empty() && values[i].Status == StatusCode::Good)
+        {
+          Cache->Put(attribute.Node, attribute.Attribute, values[i], guard.Generation);
+        }
+      }
+      return result;
+    }
+
+    virtual std::vector<StatusCode> Write(const std::vector<OpcUa::WriteValue>& values)
+    {
+      // Reads running at the same time can get old values until the server applies the write,
+      // so attributes are invalidated again after it. Reads started before that do not put their values.
+      Invalidate(values);
+      const std::vector<StatusCode> result = Attributes->Write(values);
+      Invalidate(values);
+      return result;
+    }
+
+  private:
+    void Invalidate(const std::vector<OpcUa::WriteValue>& values)
+    {
+      for (const WriteValue& value : values)
+      {
+        Cache->Invalidate(value.Node, value.Attribute);
+      }
+    }
+
+  private:
+    Remote::AttributeServices::SharedPtr Attributes;
+    AttributeCache::SharedPtr Cache;
+  };
+
+  class CachedServer : public Remote::Server
+  {
+  public:
+    CachedServer(Remote::Server::SharedPtr server, AttributeCache::SharedPtr cache)
+      : Server(server)
+      , CachedAttributes(new CachedAttributeServices(server->Attributes(), cache))
+    {
+    }
+
+    virtual void CreateSession(const Remote::SessionParameters& parameters)
+    {
+      Server->CreateSession(parameters);
+    }
+
+    virtual void ActivateSession()
+    {
+      Server->ActivateSession();
+    }
+
+    virtual void CloseSession()
+    {
+      Server->CloseSession();
+    }
+
+    virtual Remote::EndpointServices::SharedPtr Endpoints() const
+    {
+      return Server->Endpoints();
+    }
+
+    virtual Remote::ViewServices::SharedPtr Views() const
+    {
+      return Server->Views();
+    }
+
+    virtual Remote::NodeManagementServices::SharedPtr NodeManagement() const
+    {
+      return Server->NodeManagement();
+    }
+
+    virtual Remote::AttributeServices::SharedPtr Attributes() const
+    {
+      return CachedAttributes;
+    }
+
+    virtual Remote::SubscriptionServices::SharedPtr Subscriptions() const
+    {
+      return Server->Subscriptions();
+    }
+
+  private:
+    Remote::Server::SharedPtr Server;
+    Remote::AttributeServices::SharedPtr CachedAttributes;
+  };
+
+}
+
+namespace OpcUa
+{
+
+  AttributeCacheParameters::AttributeCacheParameters()
+    : MaxEntries(100000)
+    , TimeToLive(0)
+  {
+    Attributes.push_back(AttributeID::NODE_CLASS);
+    Attributes.push_back(AttributeID::BROWSE_NAME);
+    Attributes.push_back(AttributeID::DISPLAY_NAME);
+    Attributes.push_back(AttributeID::DESCRIPTION);
+    Attributes.push_back(AttributeID::DATA_TYPE);
+    Attributes.push_back(AttributeID::VALUE_RANK);
+    Attributes.push_back(AttributeID::ARRAY_DIMENSIONS);
+  }
+
+  AttributeCache::AttributeCache(const AttributeCacheParameters& params)
+    : Params(params)
+    , Generation(0)
+    , ReadsInFlight(0)
+    , ClearGeneration(0)
+  {
+  }
+
+  bool AttributeCache::IsCacheable(AttributeID attr) const
+  {
+    return std::find(Params.Attributes.begin(), Params.Attributes.end(), attr) != Params.Attributes.end();
+  }
+
+  bool AttributeCache::Get(const NodeID& node, AttributeID attr, DataValue& value)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    EntriesMap::iterator entryIt = Entries.find(Key(node, attr));
+    if (entryIt == Entries.end())
+    {
+      ++Statistics.Misses;
+      return false;
+    }
+
+    if (Params.TimeToLive.count() && entryIt->second.Expires <= std::chrono::steady_clock::now())
+    {
+      Erase(entryIt);
+      ++Statistics.Misses;
+      return false;
+    }
+
+    Usage.splice(Usage.begin(), Usage, entryIt->second.Usage);
+    value = entryIt->second.Value;
+    ++Statistics.Hits;
+    return true;
+  }
+
+  void AttributeCache::Put(const NodeID& node, AttributeID attr, const DataValue& value)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    PutLocked(Key(node, attr), value);
+  }
+
+  uint64_t AttributeCache::StartRead()
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ++ReadsInFlight;
+    return Generation;
+  }
+
+  void AttributeCache::FinishRead()
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (--ReadsInFlight == 0)
+    {
+      // No read can compare with these generations any more.
+      AttributeGenerations.clear();
+      NodeGenerations.clear();
+    }
+  }
+
+  void AttributeCache::Put(const NodeID& node, AttributeID attr, const DataValue& value, uint64_t generation)
+  {
+    const Key key(node, attr);
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (ClearGeneration > generation)
+    {
+      return;
+    }
+    std::map<Key, uint64_t>::const_iterator attributeIt = AttributeGenerations.find(key);
+    if (attributeIt != AttributeGenerations.end() && attributeIt->second > generation)
+    {
+      return;
+    }
+    std::map<NodeID, uint64_t>::const_iterator nodeIt = NodeGenerations.find(node);
+    if (nodeIt != NodeGenerations.end() && nodeIt->second > generation)
+    {
+      return;
+    }
+    PutLocked(key, value);
+  }
+
+  void AttributeCache::Invalidate(const NodeID& node, AttributeID attr)
+  {
+    const Key key(node, attr);
+    std::lock_guard<std::mutex> lock(Mutex);
+    EntriesMap::iterator entryIt = Entries.find(key);
+    if (entryIt != Entries.end())
+    {
+      Erase(entryIt);
+    }
+    ++Generation;
+    if (ReadsInFlight)
+    {
+      AttributeGenerations[key] = Generation;
+    }
+  }
+
+  void AttributeCache::Invalidate(const NodeID& node)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    EntriesMap::iterator entryIt = Entries.lower_bound(Key(node, static_cast<AttributeID>(0)));
+    while (entryIt != Entries.end() && entryIt->first.first == node)
+    {
+      Erase(entryIt++);
+    }
+    ++Generation;
+    if (ReadsInFlight)
+    {
+      NodeGenerations[node] = Generation;
+    }
+  }
+
+  void AttributeCache::Clear()
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Entries.clear();
+    Usage.clear();
+    ClearGeneration = ++Generation;
+  }
+
+  AttributeCacheStatistics AttributeCache::GetStatistics() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    AttributeCacheStatistics statistics = Statistics;
+    statistics.Size = Entries.size();
+    return statistics;
+  }
+
+  void AttributeCache::PutLocked(const Key& key, const DataValue& value)
+  {
+    const std::chrono::steady_clock::time_point expires = Params.TimeToLive.count()
+      ? std::chrono::steady_clock::now() + Params.TimeToLive
+      : std::chrono::steady_clock::time_point::max();
+
+    EntriesMap::iterator entryIt = Entries.find(key);
+    if (entryIt != Entries.end())
+    {
+      entryIt->second.Value = value;
+      entryIt->second.Expires = expires;
+      Usage.splice(Usage.begin(), Usage, entryIt->second.Usage);
+      return;
+    }
+
+    if (Params.MaxEntries && Entries.size() >= Params.MaxEntries)
+    {
+      Erase(Entries.find(Usage.back()));
+      ++Statistics.Evictions;
+    }
+
+    Usage.push_front(key);
+    Entry& entry = Entries[key];
+    entry.Value = value;
+    entry.Expires = expires;
+    entry.Usage = Usage.begin();
+  }
+
+  void AttributeCache::Erase(EntriesMap::iterator entryIt)
+  {
+    Usage.erase(entryIt->second.Usage);
+    Entries.erase(entryIt);
+  }
+
+  Remote::Server::SharedPtr CreateCachedServer(Remote::Server::SharedPtr server, AttributeCache::SharedPtr cache)
+  {
+    return Remote::Server::SharedPtr(new CachedServer(server, cache));
+  }
+
+} // namespace OpcUa
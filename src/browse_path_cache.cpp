@@ -0,0 +1,257 @@
+/// @brief Cache of resolved browse paths.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/browse_path_cache.h>
+
+#include <algorithm>
+
+namespace OpcUa
+{
+
+  BrowsePathCache::BrowsePathCache(Remote::Server::SharedPtr server, std::size_t maxItemsPerRequest)
+    : Server(server)
+    , MaxItemsPerRequest(maxItemsPerRequest ? maxItemsPerRequest : DefaultMaxItemsPerRequest)
+    , Generation(0)
+  {
+  }
+
+  std::vector<ChildSearchResult> BrowsePathCache::Resolve(const NodeID& startingNode, const std::vector<std::vector<QualifiedName>>& paths)
+  {
+    // Unresolved part of a path, translated from the deepest cached node of the path.
+    // Every unresolved prefix of the path is translated in the same call, so later paths
+    // sharing the prefix start from its node. Paths with the same part share one request.
+    struct Request
+    {
+      std::size_t Path;
+      std::size_t Depth;
+      std::size_t End;
+      NodeID Start;
+    };
+
+    std::vector<Request> requests;
+    // Index of request in the requests for every path, or npos when the path was found in cache.
+    std::vector<std::size_t> pathRequests(paths.size(), std::string::npos);
+    std::vector<NodeID> ids(paths.size(), startingNode);
+    uint64_t generation = 0;
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      generation = Generation;
+      auto rootIt = Roots.find(startingNode);
+      std::map<std::pair<NodeID, std::vector<NameKey>>, std::size_t> requestIndexes;
+      for (std::size_t i = 0; i < paths.size(); ++i)
+      {
+        const PathElement* element = rootIt != Roots.end() ? rootIt->second.get() : nullptr;
+        std::size_t depth = 0;
+        for (std::size_t j = 0; element && j < paths[i].size(); ++j)
+        {
+          ChildrenMap::const_iterator childIt = element->Children.find(NameKey(paths[i][j].NamespaceIndex, paths[i][j].Name));
+          element = childIt != element->Children.end() ? childIt->second.get() : nullptr;
+          if (element && element->Resolved)
+          {
+            ids[i] = element->Id;
+            depth = j + 1;
+          }
+        }
+
+        std::vector<NameKey> suffix;
+        for (std::size_t end = depth + 1; end <= paths[i].size(); ++end)
+        {
+          suffix.push_back(NameKey(paths[i][end - 1].NamespaceIndex, paths[i][end - 1].Name));
+          auto inserted = requestIndexes.insert(std::make_pair(std::make_pair(ids[i], suffix), requests.size()));
+          if (inserted.second)
+          {
+            Request request;
+            request.Path = i;
+            request.Depth = depth;
+            request.End = end;
+            request.Start = ids[i];
+            requests.push_back(request);
+          }
+          if (end == paths[i].size())
+          {
+            pathRequests[i] = inserted.first->second;
+          }
+        }
+      }
+    }
+
+    // Server is called without the lock, so other threads can use cached paths meanwhile.
+    std::vector<BrowsePathResult> translated;
+    translated.reserve(requests.size());
+    for (std::size_t first = 0; first < requests.size(); first += MaxItemsPerRequest)
+    {
+      const std::size_t last = std::min(first + MaxItemsPerRequest, requests.size());
+      TranslateBrowsePathsParameters params;
+      params.BrowsePaths.reserve(last - first);
+      for (std::size_t i = first; i < last; ++i)
+      {
+        const std::vector<QualifiedName>& path = paths[requests[i].Path];
+        BrowsePath browsePath;
+        browsePath.StartingNode = requests[i].Start;
+        for (std::size_t j = requests[i].Depth; j < requests[i].End; ++j)
+        {
+          RelativePathElement element;
+          element.TargetName = path[j];
+          browsePath.Path.Elements.push_back(element);
+        }
+        params.BrowsePaths.push_back(browsePath);
+      }
+
+      std::vector<BrowsePathResult> results = Server->Views()->TranslateBrowsePathsToNodeIds(params);
+      results.resize(last - first);
+      for (BrowsePathResult& result : results)
+      {
+        if (result.Status == StatusCode::Good && result.Targets.empty())
+        {
+          result.Status = StatusCode::BadNoMatch;
+        }
+        translated.push_back(result);
+      }
+    }
+
+    if (!requests.empty())
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      // Paths translated before invalidation may be stale, they are returned but not cached.
+      if (generation == Generation)
+      {
+        for (std::size_t i = 0; i < requests.size(); ++i)
+        {
+          // Only found nodes are cached, so nodes added later become visible without invalidation.
+          if (translated[i].Status == StatusCode::Good)
+          {
+            Insert(startingNode, paths[requests[i].Path], requests[i].End, translated[i].Targets.front().Node);
+          }
+        }
+      }
+    }
+
+    std::vector<ChildSearchResult> result;
+    result.reserve(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+      const BrowsePathResult* translation = pathRequests[i] != std::string::npos ? &translated[pathRequests[i]] : nullptr;
+      if (translation && translation->Status != StatusCode::Good)
+      {
+        result.push_back(ChildSearchResult(translation->Status, Node(Server, NodeID(), QualifiedName())));
+      }
+      else if (paths[i].empty())
+      {
+        result.push_back(ChildSearchResult(StatusCode::Good, Node(Server, startingNode)));
+      }
+      else
+      {
+        const NodeID& id = translation ? translation->Targets.front().Node : ids[i];
+        result.push_back(ChildSearchResult(StatusCode::Good, Node(Server, id, paths[i].back())));
+      }
+    }
+    return result;
+  }
+
+  Node BrowsePathCache::Resolve(const NodeID& startingNode, const std::vector<QualifiedName>& path)
+  {
+    const std::vector<ChildSearchResult> result = Resolve(startingNode, std::vector<std::vector<QualifiedName>>(1, path));
+    if (result.front().Status != StatusCode::Good)
+    {
+      throw NodeNotFoundException();
+    }
+    return result.front().Target;
+  }
+
+  void BrowsePathCache::Invalidate(const NodeID& startingNode, const std::vector<QualifiedName>& prefix)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ++Generation;
+    auto rootIt = Roots.find(startingNode);
+    if (rootIt == Roots.end())
+    {
+      return;
+    }
+    if (prefix.empty())
+    {
+      Roots.erase(rootIt);
+      return;
+    }
+
+    PathElement* element = rootIt->second.get();
+    for (std::size_t i = 0; i + 1 < prefix.size(); ++i)
+    {
+      ChildrenMap::iterator childIt = element->Children.find(NameKey(prefix[i].NamespaceIndex, prefix[i].Name));
+      if (childIt == element->Children.end())
+      {
+        return;
+      }
+      element = childIt->second.get();
+    }
+    element->Children.erase(NameKey(prefix.back().NamespaceIndex, prefix.back().Name));
+  }
+
+  void BrowsePathCache::Invalidate(const NodeID& startingNode)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ++Generation;
+    Roots.erase(startingNode);
+  }
+
+  void BrowsePathCache::Clear()
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ++Generation;
+    Roots.clear();
+  }
+
+  std::size_t BrowsePathCache::Size() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    std::size_t size = 0;
+    for (const auto& root : Roots)
+    {
+      size += CountElements(*root.second);
+    }
+    return size;
+  }
+
+  std::size_t BrowsePathCache::CountElements(const PathElement& element)
+  {
+    std::size_t count = 0;
+    for (const auto& child : element.Children)
+    {
+      count += (child.second->Resolved ? 1 : 0) + CountElements(*child.second);
+    }
+    return count;
+  }
+
+  void BrowsePathCache::Insert(const NodeID& startingNode, const std::vector<QualifiedName>& path, std::size_t length, const NodeID& id)
+  {
+    std::unique_ptr<PathElement>& root = Roots[startingNode];
+    if (!root)
+    {
+      root.reset(new PathElement);
+      root->Id = startingNode;
+      root->Resolved = true;
+    }
+
+    // Translation returns only the last node of the path, so missing elements
+    // on the way to it are kept unresolved.
+    PathElement* element = root.get();
+    for (std::size_t i = 0; i < length; ++i)
+    {
+      const QualifiedName& name = path[i];
+      std::unique_ptr<PathElement>& child = element->Children[NameKey(name.NamespaceIndex, name.Name)];
+      if (!child)
+      {
+        child.reset(new PathElement);
+        child->Resolved = false;
+      }
+      element = child.get();
+    }
+    element->Id = id;
+    element->Resolved = true;
+  }
+
+} // namespace OpcUa
@@ -0,0 +1,114 @@
+/// @brief Channel with read buffer.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/buffered_channel.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+
+namespace OpcUa
+{
+
+  BufferedChannel::BufferedChannel(std::shared_ptr<SocketChannel> channel, std::size_t bufferSize)
+    : Channel(channel)
+    , Buffer(bufferSize ? bufferSize : 1)
+    , Begin(0)
+    , End(0)
+    , FillCount(0)
+  {
+  }
+
+  std::size_t BufferedChannel::Receive(char* data, std::size_t size)
+  {
+    const std::size_t buffered = std::min(size, Available());
+    memcpy(data, &Buffer[Begin], buffered);
+    Consume(buffered);
+
+    const std::size_t rest = size - buffered;
+    if (rest == 0)
+    {
+      return size;
+    }
+    // Big blocks go directly to the caller without copying through the buffer.
+    if (rest >= Buffer.size())
+    {
+      Channel->Receive(data + buffered, rest);
+      return size;
+    }
+
+    memcpy(data + buffered, Peek(rest), rest);
+    Consume(rest);
+    return size;
+  }
+
+  void BufferedChannel::Send(const char* message, std::size_t size)
+  {
+    Channel->Send(message, size);
+  }
+
+  int BufferedChannel::WaitForData(float second)
+  {
+    if (Available())
+    {
+      return 1;
+    }
+    return Channel->WaitForData(second);
+  }
+
+  const char* BufferedChannel::Peek(std::size_t size)
+  {
+    if (size > Buffer.size())
+    {
+      throw std::length_error("Requested more data than buffer can hold.");
+    }
+    Fill(size);
+    return &Buffer[Begin];
+  }
+
+  void BufferedChannel::Consume(std::size_t size)
+  {
+    Begin += std::min(size, Available());
+    if (Begin == End)
+    {
+      Begin = End = 0;
+    }
+  }
+
+  std::size_t BufferedChannel::Available() const
+  {
+    return End - Begin;
+  }
+
+  std::size_t BufferedChannel::GetFillCount() const
+  {
+    return FillCount;
+  }
+
+  void BufferedChannel::Fill(std::size_t size)
+  {
+    if (Available() >= size)
+    {
+      return;
+    }
+
+    if (Begin + size > Buffer.size())
+    {
+      memmove(&Buffer[0], &Buffer[Begin], Available());
+      End -= Begin;
+      Begin = 0;
+    }
+
+    while (Available() < size)
+    {
+      End += Channel->ReceiveSome(&Buffer[End], Buffer.size() - End);
+      ++FillCount;
+    }
+  }
+
+} // namespace OpcUa
@@ -0,0 +1,253 @@
+/// @brief Change detection and deadband filtering of sampled values.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/change_detector.h>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  using namespace OpcUa;
+
+  template <typename T>
+  bool GetDouble(const std::vector<T>& values, double& result)
+  {
+    if (values.size() != 1)
+    {
+      return false;
+    }
+    result = values.front();
+    return true;
+  }
+
+  template <typename T, typename Integer>
+  bool GetInteger(const std::vector<T>& values, Integer& result)
+  {
+    if (values.size() != 1)
+    {
+      return false;
+    }
+    result = values.front();
+    return true;
+  }
+
+  enum class NumberType
+  {
+    None,
+    Double,
+    Int64,
+    UInt64,
+  };
+
+  /// @return false if variant is not a floating point or an integer scalar up to 32 bits.
+  bool GetDouble(const Variant& variant, double& result)
+  {
+    const VariantValue& value = variant.Value;
+    switch (variant.Type)
+    {
+      case VariantType::BOOLEAN: return GetDouble(value.Boolean, result);
+      case VariantType::SBYTE: return GetDouble(value.SByte, result);
+      case VariantType::BYTE: return GetDouble(value.Byte, result);
+      case VariantType::INT16: return GetDouble(value.Int16, result);
+      case VariantType::UINT16: return GetDouble(value.UInt16, result);
+      case VariantType::INT32: return GetDouble(value.Int32, result);
+      case VariantType::UINT32: return GetDouble(value.UInt32, result);
+      case VariantType::FLOAT: return GetDouble(value.Float, result);
+      case VariantType::DOUBLE: return GetDouble(value.Double, result);
+      default: return false;
+    }
+  }
+
+  /// @return Column the variant is kept in, None if variant is not a numeric scalar.
+  NumberType GetNumber(const Variant& variant, double& doubleValue, int64_t& intValue, uint64_t& unsignedValue)
+  {
+    // 64 bit integers do not fit into double exactly. Signed and unsigned ones are kept
+    // in separate columns, so differences are computed without wrapping around 2^63.
+    switch (variant.Type)
+    {
+      case VariantType::INT64: return GetInteger(variant.Value.Int64, intValue) ? NumberType::Int64 : NumberType::None;
+      case VariantType::UINT64: return GetInteger(variant.Value.UInt64, unsignedValue) ? NumberType::UInt64 : NumberType::None;
+      default: return GetDouble(variant, doubleValue) ? NumberType::Double : NumberType::None;
+    }
+  }
+
+  inline bool IsChanged(double last, double current, double threshold)
+  {
+    return std::fabs(current - last) > threshold || std::isnan(current) != std::isnan(last);
+  }
+}
+
+namespace OpcUa
+{
+
+  void DetectChanges(const double* last, const double* current, const double* thresholds, std::size_t count, uint64_t* bitmap)
+  {
+    std::size_t i = 0;
+#ifdef __SSE2__
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    for (; i + 2 <= count; i += 2)
+    {
+      const __m128d lastValues = _mm_loadu_pd(last + i);
+      const __m128d currentValues = _mm_loadu_pd(current + i);
+      const __m128d difference = _mm_andnot_pd(signMask, _mm_sub_pd(currentValues, lastValues));
+      const __m128d exceeded = _mm_cmpgt_pd(difference, _mm_loadu_pd(thresholds + i));
+      const __m128d nanChanged = _mm_xor_pd(_mm_cmpunord_pd(currentValues, currentValues), _mm_cmpunord_pd(lastValues, lastValues));
+      const uint64_t bits = _mm_movemask_pd(_mm_or_pd(exceeded, nanChanged));
+      // i is even, both bits are in the same word.
+      bitmap[i / 64] |= bits << (i % 64);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+      if (IsChanged(last[i], current[i], thresholds[i]))
+      {
+        bitmap[i / 64] |= uint64_t(1) << (i % 64);
+      }
+    }
+  }
+
+  void DetectChanges(const int64_t* last, const int64_t* current, const double* thresholds, std::size_t count, uint64_t* bitmap)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      // Difference is computed without overflow, distinct values never compare as equal doubles.
+      const uint64_t difference = current[i] > last[i] ? uint64_t(current[i]) - uint64_t(last[i]) : uint64_t(last[i]) - uint64_t(current[i]);
+      if (difference && static_cast<double>(difference) > thresholds[i])
+      {
+        bitmap[i / 64] |= uint64_t(1) << (i % 64);
+      }
+    }
+  }
+
+  void DetectChanges(const uint64_t* last, const uint64_t* current, const double* thresholds, std::size_t count, uint64_t* bitmap)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const uint64_t difference = current[i] > last[i] ? current[i] - last[i] : last[i] - current[i];
+      if (difference && static_cast<double>(difference) > thresholds[i])
+      {
+        bitmap[i / 64] |= uint64_t(1) << (i % 64);
+      }
+    }
+  }
+
+  std::size_t ChangeDetector::Add(const DeadbandFilter& filter)
+  {
+    double threshold = 0;
+    if (filter.Type == DeadbandType::Absolute)
+    {
+      threshold = filter.Value;
+    }
+    else if (filter.Type == DeadbandType::Percent)
+    {
+      threshold = filter.Value / 100 * (filter.High - filter.Low);
+    }
+
+    Thresholds.push_back(threshold);
+    Kinds.push_back(Kind::None);
+    Types.push_back(VariantType::NUL);
+    Statuses.push_back(StatusCode::Good);
+    LastDoubles.push_back(0);
+    CurrentDoubles.push_back(0);
+    LastIntegers.push_back(0);
+    CurrentIntegers.push_back(0);
+    LastUnsigned.push_back(0);
+    CurrentUnsigned.push_back(0);
+    LastOthers.push_back(Variant());
+    return Kinds.size() - 1;
+  }
+
+  void ChangeDetector::Remove(std::size_t index)
+  {
+    const std::size_t last = Kinds.size() - 1;
+    Thresholds[index] = Thresholds[last];
+    Kinds[index] = Kinds[last];
+    Types[index] = Types[last];
+    Statuses[index] = Statuses[last];
+    LastDoubles[index] = LastDoubles[last];
+    LastIntegers[index] = LastIntegers[last];
+    LastUnsigned[index] = LastUnsigned[last];
+    LastOthers[index] = LastOthers[last];
+
+    Thresholds.pop_back();
+    Kinds.pop_back();
+    Types.pop_back();
+    Statuses.pop_back();
+    LastDoubles.pop_back();
+    CurrentDoubles.pop_back();
+    LastIntegers.pop_back();
+    CurrentIntegers.pop_back();
+    LastUnsigned.pop_back();
+    CurrentUnsigned.pop_back();
+    LastOthers.pop_back();
+  }
+
+  std::size_t ChangeDetector::Size() const
+  {
+    return Kinds.size();
+  }
+
+  void ChangeDetector::Detect(const std::vector<DataValue>& values, std::vector<uint64_t>& changed)
+  {
+    const std::size_t size = Kinds.size();
+    changed.assign((size + 63) / 64, 0);
+
+    // Gather numbers into columns. Items of other kinds get current equal to last, so kernels skip them.
+    std::vector<Kind> kinds(size);
+    for (std::size_t i = 0; i < size && i < values.size(); ++i)
+    {
+      const DataValue& value = values[i];
+      CurrentDoubles[i] = LastDoubles[i];
+      CurrentIntegers[i] = LastIntegers[i];
+      CurrentUnsigned[i] = LastUnsigned[i];
+      switch (GetNumber(value.Value, CurrentDoubles[i], CurrentIntegers[i], CurrentUnsigned[i]))
+      {
+        case NumberType::Double: kinds[i] = Kind::Double; break;
+        case NumberType::Int64: kinds[i] = Kind::Int64; break;
+        case NumberType::UInt64: kinds[i] = Kind::UInt64; break;
+        default: kinds[i] = Kind::Other; break;
+      }
+
+      const bool forced = kinds[i] != Kinds[i]
+        || value.Value.Type != Types[i]
+        || value.Status != Statuses[i]
+        || (kinds[i] == Kind::Other && !(value.Value == LastOthers[i]));
+      if (forced)
+      {
+        changed[i / 64] |= uint64_t(1) << (i % 64);
+      }
+    }
+
+    const std::size_t answered = std::min(size, values.size());
+    DetectChanges(LastDoubles.data(), CurrentDoubles.data(), Thresholds.data(), answered, changed.data());
+    DetectChanges(LastIntegers.data(), CurrentIntegers.data(), Thresholds.data(), answered, changed.data());
+    DetectChanges(LastUnsigned.data(), CurrentUnsigned.data(), Thresholds.data(), answered, changed.data());
+
+    // Remember values of changed items only, values inside deadband do not move the base.
+    for (std::size_t word = 0; word < changed.size(); ++word)
+    {
+      for (uint64_t bits = changed[word]; bits; bits &= bits - 1)
+      {
+        const std::size_t i = word * 64 + __builtin_ctzll(bits);
+        Kinds[i] = kinds[i];
+        Types[i] = values[i].Value.Type;
+        Statuses[i] = values[i].Status;
+        LastDoubles[i] = CurrentDoubles[i];
+        LastIntegers[i] = CurrentIntegers[i];
+        LastUnsigned[i] = CurrentUnsigned[i];
+        LastOthers[i] = kinds[i] == Kind::Other ? values[i].Value : Variant();
+      }
+    }
+  }
+
+} // namespace OpcUa
@@ -0,0 +1,131 @@
+/// @brief Pool of reusable byte buffers.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/common/buffer_pool.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+  const uint32_t NoSlot = std::numeric_limits<uint32_t>::max();
+
+  uint64_t MakeHead(uint32_t slot, uint64_t head)
+  {
+    return ((head >> 32) + 1) << 32 | slot;
+  }
+
+  void Push(std::atomic<uint64_t>& head, std::atomic<uint32_t>* next, uint32_t slot)
+  {
+    uint64_t current = head.load(std::memory_order_relaxed);
+    do
+    {
+      next[slot].store(static_cast<uint32_t>(current), std::memory_order_relaxed);
+    }
+    while (!head.compare_exchange_weak(current, MakeHead(slot, current), std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  uint32_t Pop(std::atomic<uint64_t>& head, const std::atomic<uint32_t>* next)
+  {
+    uint64_t current = head.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(current) != NoSlot)
+    {
+      // Next can be stale if the slot was taken meanwhile, then the counter has changed and exchange fails.
+      const uint32_t slot = static_cast<uint32_t>(current);
+      if (head.compare_exchange_weak(current, MakeHead(next[slot].load(std::memory_order_relaxed), current), std::memory_order_acquire, std::memory_order_acquire))
+      {
+        return slot;
+      }
+    }
+    return NoSlot;
+  }
+
+}
+
+namespace Common
+{
+
+  BufferPool::Storage::Storage(std::size_t maxFreeBuffers, std::size_t maxBufferCapacity)
+    : FreeSlots(NoSlot)
+    , EmptySlots(NoSlot)
+    , FreeCount(0)
+    , MaxBufferCapacity(maxBufferCapacity)
+  {
+    const uint32_t slots = static_cast<uint32_t>(std::min<std::size_t>(maxFreeBuffers, NoSlot));
+    Next.reset(new std::atomic<uint32_t>[slots]);
+    Buffers.reset(new Buffer*[slots]);
+    for (uint32_t slot = 0; slot < slots; ++slot)
+    {
+      Buffers[slot] = nullptr;
+      Push(EmptySlots, Next.get(), slot);
+    }
+  }
+
+  BufferPool::Storage::~Storage()
+  {
+    for (uint32_t slot = Pop(FreeSlots, Next.get()); slot != NoSlot; slot = Pop(FreeSlots, Next.get()))
+    {
+      delete Buffers[slot];
+    }
+  }
+
+  BufferPool::BufferPool(std::size_t maxFreeBuffers, std::size_t maxBufferCapacity)
+    : FreeBuffers(new Storage(maxFreeBuffers, maxBufferCapacity))
+  {
+  }
+
+  std::shared_ptr<BufferPool::Buffer> BufferPool::Acquire()
+  {
+    std::unique_ptr<Buffer> buffer;
+    const uint32_t slot = Pop(FreeBuffers->FreeSlots, FreeBuffers->Next.get());
+    if (slot != NoSlot)
+    {
+      buffer.reset(FreeBuffers->Buffers[slot]);
+      --FreeBuffers->FreeCount;
+      Push(FreeBuffers->EmptySlots, FreeBuffers->Next.get(), slot);
+    }
+    else
+    {
+      buffer.reset(new Buffer);
+    }
+
+    // Deleter keeps storage alive, so buffers released after the pool are simply deleted by it.
+    const std::shared_ptr<Storage> storage = FreeBuffers;
+    return std::shared_ptr<Buffer>(buffer.release(), [storage](Buffer* released)
+    {
+      Release(storage, released);
+    });
+  }
+
+  std::size_t BufferPool::GetFreeCount() const
+  {
+    return FreeBuffers->FreeCount;
+  }
+
+  void BufferPool::Release(const std::shared_ptr<Storage>& storage, Buffer* buffer)
+  {
+    std::unique_ptr<Buffer> released(buffer);
+    if (released->capacity() > storage->MaxBufferCapacity)
+    {
+      return;
+    }
+
+    // No empty slot means the pool already keeps maxFreeBuffers buffers.
+    const uint32_t slot = Pop(storage->EmptySlots, storage->Next.get());
+    if (slot == NoSlot)
+    {
+      return;
+    }
+    released->clear();
+    storage->Buffers[slot] = released.release();
+    ++storage->FreeCount;
+    Push(storage->FreeSlots, storage->Next.get(), slot);
+  }
+
+} // namespace Common
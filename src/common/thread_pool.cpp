@@ -0,0 +1,240 @@
+/// @brief Pool of worker threads with work stealing.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/common/thread_pool.h>
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+  // Worker of which pool is the current thread.
+  thread_local const Common::ThreadPool* CurrentPool = nullptr;
+  thread_local unsigned CurrentWorker = 0;
+
+  // Chunks per worker in ParallelFor, more chunks balance uneven work better.
+  const std::size_t ChunksPerWorker = 4;
+}
+
+namespace Common
+{
+
+  ThreadPool::ThreadPool(unsigned threads, ThreadObserver* observer)
+    : Observer(observer)
+    , Pending(0)
+    , NextWorker(0)
+    , Stopping(false)
+  {
+    if (!threads)
+    {
+      threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (unsigned i = 0; i < threads; ++i)
+    {
+      Workers.push_back(std::unique_ptr<Worker>(new Worker));
+    }
+    for (unsigned i = 0; i < threads; ++i)
+    {
+      Threads.push_back(Thread::Create(std::bind(&ThreadPool::Run, this, i)));
+    }
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Stopping = true;
+    }
+    TaskPosted.notify_all();
+    Threads.clear();
+  }
+
+  void ThreadPool::Post(ThreadProc task)
+  {
+    const unsigned index = CurrentPool == this ? CurrentWorker : NextWorker++ % Workers.size();
+    // Counted before it is queued, so a worker which takes the task at once cannot bring Pending below zero.
+    ++Pending;
+    {
+      std::lock_guard<std::mutex> lock(Workers[index]->Mutex);
+      Workers[index]->Tasks.push_back(task);
+    }
+    {
+      // Sleeping worker checks Pending under this lock, so the notification is not lost.
+      std::lock_guard<std::mutex> lock(Mutex);
+    }
+    TaskPosted.notify_one();
+  }
+
+  void ThreadPool::ParallelFor(std::size_t begin, std::size_t end, std::function<void(std::size_t)> body, std::size_t grain)
+  {
+    if (begin >= end)
+    {
+      return;
+    }
+
+    struct State
+    {
+      std::size_t Begin;
+      std::size_t End;
+      std::size_t ChunkSize;
+      std::size_t Chunks;
+      std::function<void(std::size_t)> Body;
+      std::atomic<std::size_t> NextChunk;
+      std::size_t Completed;
+      std::exception_ptr Error;
+      std::mutex Mutex;
+      std::condition_variable Done;
+    };
+
+    const std::size_t size = end - begin;
+    const std::size_t maxChunks = Workers.size() * ChunksPerWorker;
+    std::shared_ptr<State> state(new State);
+    state->Begin = begin;
+    state->End = end;
+    state->ChunkSize = std::max(std::max(grain, std::size_t(1)), (size + maxChunks - 1) / maxChunks);
+    state->Chunks = (size + state->ChunkSize - 1) / state->ChunkSize;
+    state->Body = body;
+    state->NextChunk = 0;
+    state->Completed = 0;
+
+    // Helpers take chunks until none left, late helpers return immediately.
+    auto process = [state]()
+    {
+      std::size_t chunk = 0;
+      while ((chunk = state->NextChunk++) < state->Chunks)
+      {
+        const std::size_t first = state->Begin + chunk * state->ChunkSize;
+        const std::size_t last = std::min(first + state->ChunkSize, state->End);
+        try
+        {
+          for (std::size_t i = first; i < last; ++i)
+          {
+            state->Body(i);
+          }
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock(state->Mutex);
+          if (!state->Error)
+          {
+            state->Error = std::current_exception();
+          }
+        }
+
+        std::lock_guard<std::mutex> lock(state->Mutex);
+        if (++state->Completed == state->Chunks)
+        {
+          state->Done.notify_all();
+        }
+      }
+    };
+
+    const std::size_t helpers = std::min<std::size_t>(state->Chunks - 1, Workers.size());
+    for (std::size_t i = 0; i < helpers; ++i)
+    {
+      Post(process);
+    }
+    process();
+
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    state->Done.wait(lock, [&state]() { return state->Completed == state->Chunks; });
+    if (state->Error)
+    {
+      std::rethrow_exception(state->Error);
+    }
+  }
+
+  unsigned ThreadPool::Size() const
+  {
+    return Workers.size();
+  }
+
+  void ThreadPool::Run(unsigned index)
+  {
+    CurrentPool = this;
+    CurrentWorker = index;
+    while (true)
+    {
+      ThreadProc task;
+      if (Pop(index, task))
+      {
+        --Pending;
+        Execute(task);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(Mutex);
+      TaskPosted.wait(lock, [this]() { return Stopping || Pending > 0; });
+      // Queued tasks are finished before stopping.
+      if (Stopping && Pending == 0)
+      {
+        return;
+      }
+    }
+  }
+
+  bool ThreadPool::Pop(unsigned index, ThreadProc& task)
+  {
+    {
+      Worker& own = *Workers[index];
+      std::lock_guard<std::mutex> lock(own.Mutex);
+      if (!own.Tasks.empty())
+      {
+        task = std::move(own.Tasks.back());
+        own.Tasks.pop_back();
+        return true;
+      }
+    }
+
+    for (std::size_t i = 1; i < Workers.size(); ++i)
+    {
+      Worker& victim = *Workers[(index + i) % Workers.size()];
+      std::lock_guard<std::mutex> lock(victim.Mutex);
+      if (!victim.Tasks.empty())
+      {
+        task = std::move(victim.Tasks.front());
+        victim.Tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void ThreadPool::Execute(ThreadProc& task)
+  {
+    try
+    {
+      task();
+    }
+    catch (const std::exception& exc)
+    {
+      if (Observer)
+      {
+        Observer->OnError(exc);
+      }
+      else
+      {
+        std::cerr << "Unhandled exception in thread pool task. " << exc.what() << std::endl;
+      }
+    }
+    catch (...)
+    {
+      if (Observer)
+      {
+        Observer->OnError(std::runtime_error("Unknown exception in thread pool task."));
+      }
+      else
+      {
+        std::cerr << "Unknown exception in thread pool task." << std::endl;
+      }
+    }
+  }
+
+} // namespace Common
@@ -0,0 +1,336 @@
+/// @brief Hierarchical timer wheel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/common/timer_wheel.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+  const unsigned Bits = 6;
+  const uint64_t SlotsPerLevel = 1 << Bits;
+  const uint64_t Mask = SlotsPerLevel - 1;
+  const unsigned Levels = 4;
+  // Longer delays are cascaded from the last level again.
+  const uint64_t MaxDelta = (uint64_t(1) << (Bits * Levels)) - 1;
+}
+
+namespace Common
+{
+
+  TimerWheel::TimerWheel(ThreadPool::SharedPtr pool, std::chrono::milliseconds resolution)
+    : Pool(pool)
+    , Resolution(std::max(resolution, std::chrono::milliseconds(1)))
+    , Started(std::chrono::steady_clock::now())
+    , Slots(SlotsPerLevel * Levels, -1)
+    , FreeTimers(-1)
+    , Count(0)
+    , CurrentTick(0)
+    , Stopping(false)
+  {
+    Worker = Thread::Create(std::bind(&TimerWheel::Run, this));
+  }
+
+  TimerWheel::~TimerWheel()
+  {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Stopping = true;
+    }
+    Changed.notify_all();
+    Worker.reset();
+  }
+
+  TimerID TimerWheel::Schedule(std::chrono::milliseconds delay, ThreadProc callback)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const uint64_t now = CurrentRealTick();
+    if (!Count)
+    {
+      // Idle wheel is not advanced by timer thread.
+      CurrentTick = std::max(CurrentTick, now);
+    }
+    // Wheel can lag behind real time while callbacks run, so the delay is counted from real time.
+    // Current tick is partially elapsed, one more tick guarantees the delay is not shortened.
+    const TimerID id = Add(std::max(CurrentTick, now) + ToTicks(delay) + 1, 0, callback);
+    Changed.notify_one();
+    return id;
+  }
+
+  TimerID TimerWheel::SchedulePeriodic(std::chrono::milliseconds interval, ThreadProc callback)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (!Count)
+    {
+      CurrentTick = std::max(CurrentTick, CurrentRealTick());
+    }
+    const uint64_t period = std::max<uint64_t>(ToTicks(interval), 1);
+    const TimerID id = Add((CurrentTick / period + 1) * period, period, callback);
+    Changed.notify_one();
+    return id;
+  }
+
+  bool TimerWheel::Cancel(TimerID id)
+  {
+    const uint32_t index = id & 0xFFFFFFFF;
+    const uint32_t generation = id >> 32;
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (index >= Timers.size() || Timers[index].Generation != generation || Timers[index].Slot < 0)
+    {
+      return false;
+    }
+    // Batches already dispatched keep the callback, the flag makes them skip it.
+    Timers[index].Callback->Cancelled = true;
+    Unlink(index);
+    Free(index);
+    return true;
+  }
+
+  std::size_t TimerWheel::Size() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Count;
+  }
+
+  TimerID TimerWheel::Add(uint64_t expires, uint64_t period, ThreadProc callback)
+  {
+    int32_t index = FreeTimers;
+    if (index >= 0)
+    {
+      FreeTimers = Timers[index].Next;
+    }
+    else
+    {
+      Timer timer = Timer();
+      timer.Generation = 1;
+      Timers.push_back(timer);
+      index = Timers.size() - 1;
+    }
+
+    Timer& timer = Timers[index];
+    timer.Expires = expires;
+    timer.Period = period;
+    timer.Callback = std::make_shared<TimerCallback>(callback);
+    Insert(index);
+    ++Count;
+    return (TimerID(timer.Generation) << 32) | index;
+  }
+
+  void TimerWheel::Insert(int32_t index)
+  {
+    Timer& timer = Timers[index];
+    uint64_t delta = timer.Expires > CurrentTick ? timer.Expires - CurrentTick : 0;
+    uint64_t slotTick = timer.Expires;
+    if (delta > MaxDelta)
+    {
+      delta = MaxDelta;
+      slotTick = CurrentTick + MaxDelta;
+    }
+
+    unsigned level = 0;
+    while (level + 1 < Levels && delta >= (uint64_t(1) << (Bits * (level + 1))))
+    {
+      ++level;
+    }
+
+    timer.Slot = level * SlotsPerLevel + ((slotTick >> (Bits * level)) & Mask);
+    timer.Prev = -1;
+    timer.Next = Slots[timer.Slot];
+    if (timer.Next >= 0)
+    {
+      Timers[timer.Next].Prev = index;
+    }
+    Slots[timer.Slot] = index;
+  }
+
+  void TimerWheel::Unlink(int32_t index)
+  {
+    Timer& timer = Timers[index];
+    if (timer.Prev >= 0)
+    {
+      Timers[timer.Prev].Next = timer.Next;
+    }
+    else
+    {
+      Slots[timer.Slot] = timer.Next;
+    }
+    if (timer.Next >= 0)
+    {
+      Timers[timer.Next].Prev = timer.Prev;
+    }
+  }
+
+  void TimerWheel::Free(int32_t index)
+  {
+    Timer& timer = Timers[index];
+    // Generation makes ids of fired and cancelled timers invalid.
+    if (!++timer.Generation)
+    {
+      timer.Generation = 1;
+    }
+    timer.Callback.reset();
+    timer.Slot = -1;
+    timer.Next = FreeTimers;
+    FreeTimers = index;
+    --Count;
+  }
+
+  void TimerWheel::Advance(uint64_t tick, std::vector<Batch>& expired)
+  {
+    while (CurrentTick < tick)
+    {
+      if (!Count)
+      {
+        CurrentTick = tick;
+        return;
+      }
+
+      ++CurrentTick;
+
+      // Cascade from the highest level reached so timers moved down are not skipped.
+      unsigned level = 1;
+      while (level < Levels && !(CurrentTick & ((uint64_t(1) << (Bits * level)) - 1)))
+      {
+        ++level;
+      }
+      while (--level > 0)
+      {
+        const int32_t slot = level * SlotsPerLevel + ((CurrentTick >> (Bits * level)) & Mask);
+        int32_t index = Slots[slot];
+        Slots[slot] = -1;
+        while (index >= 0)
+        {
+          const int32_t next = Timers[index].Next;
+          Insert(index);
+          index = next;
+        }
+      }
+
+      int32_t index = Slots[CurrentTick & Mask];
+      Slots[CurrentTick & Mask] = -1;
+      Batch batch;
+      while (index >= 0)
+      {
+        Timer& timer = Timers[index];
+        const int32_t next = timer.Next;
+        batch.push_back(timer.Callback);
+        if (timer.Period)
+        {
+          timer.Expires += timer.Period;
+          Insert(index);
+        }
+        else
+        {
+          Free(index);
+        }
+        index = next;
+      }
+      if (!batch.empty())
+      {
+        expired.push_back(Batch());
+        expired.back().swap(batch);
+      }
+    }
+  }
+
+  uint64_t TimerWheel::NextWakeupTick() const
+  {
+    for (uint64_t tick = CurrentTick + 1; tick < CurrentTick + SlotsPerLevel; ++tick)
+    {
+      if (Slots[tick & Mask] >= 0)
+      {
+        return tick;
+      }
+    }
+    // Next cascade from upper levels.
+    return ((CurrentTick >> Bits) + 1) << Bits;
+  }
+
+  uint64_t TimerWheel::ToTicks(std::chrono::milliseconds duration) const
+  {
+    const std::chrono::steady_clock::duration value = std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration);
+    if (value.count() <= 0)
+    {
+      return 0;
+    }
+    return (value + Resolution - std::chrono::steady_clock::duration(1)) / Resolution;
+  }
+
+  uint64_t TimerWheel::CurrentRealTick() const
+  {
+    return (std::chrono::steady_clock::now() - Started) / Resolution;
+  }
+
+  void TimerWheel::Dispatch(std::vector<Batch>& expired)
+  {
+    for (Batch& batch : expired)
+    {
+      if (!Pool)
+      {
+        Execute(batch);
+        continue;
+      }
+      std::shared_ptr<Batch> callbacks(new Batch);
+      callbacks->swap(batch);
+      Pool->Post([callbacks]()
+      {
+        Execute(*callbacks);
+      });
+    }
+  }
+
+  void TimerWheel::Execute(const Batch& callbacks)
+  {
+    for (const std::shared_ptr<TimerCallback>& callback : callbacks)
+    {
+      if (callback->Cancelled)
+      {
+        continue;
+      }
+      try
+      {
+        callback->Proc();
+      }
+      catch (const std::exception& exc)
+      {
+        std::cerr << "Unhandled exception in timer callback. " << exc.what() << std::endl;
+      }
+    }
+  }
+
+  void TimerWheel::Run()
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (!Stopping)
+    {
+      const uint64_t now = CurrentRealTick();
+      if (now > CurrentTick)
+      {
+        std::vector<Batch> expired;
+        Advance(now, expired);
+        if (!expired.empty())
+        {
+          lock.unlock();
+          Dispatch(expired);
+          lock.lock();
+        }
+        continue;
+      }
+
+      if (!Count)
+      {
+        Changed.wait(lock);
+        continue;
+      }
+      Changed.wait_until(lock, Started + Resolution * NextWakeupTick());
+    }
+  }
+
+} // namespace Common
@@ -0,0 +1,206 @@
+/// @brief Event loop driving asynchronous channels.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/event_loop.h>
+#include <opc/ua/async_channel.h>
+#include <opc/ua/errors.h>
+
+#include <cmath>
+#include <errno.h>
+#include <iostream>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace
+{
+  const int MaxEventsPerWait = 256;
+}
+
+namespace OpcUa
+{
+
+  EventLoop::EventLoop()
+    : Epoll(epoll_create1(EPOLL_CLOEXEC))
+    , WakeupEvent(-1)
+    , Stopped(false)
+  {
+    if (Epoll < 0)
+    {
+      THROW_OS_ERROR("Unable to create epoll instance.");
+    }
+
+    WakeupEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (WakeupEvent < 0)
+    {
+      close(Epoll);
+      THROW_OS_ERROR("Unable to create wakeup event.");
+    }
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = WakeupEvent;
+    if (epoll_ctl(Epoll, EPOLL_CTL_ADD, WakeupEvent, &event) < 0)
+    {
+      close(WakeupEvent);
+      close(Epoll);
+      THROW_OS_ERROR("Unable to add wakeup event to epoll.");
+    }
+  }
+
+  EventLoop::~EventLoop()
+  {
+    if (close(WakeupEvent) < 0)
+    {
+      std::cerr << "Failed to close wake up event of event loop. " << strerror(errno) << std::endl;
+    }
+    if (close(Epoll) < 0)
+    {
+      std::cerr << "Failed to close epoll of event loop. " << strerror(errno) << std::endl;
+    }
+  }
+
+  std::size_t EventLoop::RunOnce(float second)
+  {
+    epoll_event events[MaxEventsPerWait];
+    // Rounded up so a loop waiting for less than 1 ms does not spin.
+    const int timeout = second < 0 ? -1 : static_cast<int>(std::ceil(second * 1000));
+    int count = epoll_wait(Epoll, events, MaxEventsPerWait, timeout);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        return 0;
+      }
+      THROW_OS_ERROR("Failed to wait for sockets.");
+    }
+
+    std::size_t processed = 0;
+    for (int i = 0; i < count; ++i)
+    {
+      if (events[i].data.fd == WakeupEvent)
+      {
+        // Stopped loop keeps the event signalled to wake up every thread.
+        if (!Stopped)
+        {
+          uint64_t value = 0;
+          read(WakeupEvent, &value, sizeof(value));
+        }
+
+        std::vector<std::function<void()>> posted;
+        {
+          std::lock_guard<std::mutex> lock(Mutex);
+          posted.swap(Posted);
+        }
+        for (std::function<void()>& function : posted)
+        {
+          function();
+        }
+        processed += posted.size();
+        continue;
+      }
+
+      AsyncSocketChannel::SharedPtr channel;
+      {
+        std::lock_guard<std::mutex> lock(Mutex);
+        // Channel could be destroyed by another thread after epoll_wait returned.
+        auto channelIt = Channels.find(events[i].data.fd);
+        if (channelIt != Channels.end())
+        {
+          channel = channelIt->second.lock();
+        }
+      }
+      if (channel)
+      {
+        channel->OnReady(events[i].events);
+        ++processed;
+      }
+    }
+    return processed;
+  }
+
+  void EventLoop::Run()
+  {
+    while (!Stopped)
+    {
+      RunOnce(-1);
+    }
+  }
+
+  void EventLoop::Stop()
+  {
+    Stopped = true;
+    Wakeup();
+  }
+
+  bool EventLoop::IsStopped() const
+  {
+    return Stopped;
+  }
+
+  void EventLoop::Post(std::function<void()> function)
+  {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Posted.push_back(function);
+    }
+    Wakeup();
+  }
+
+  void EventLoop::Add(int sock, std::weak_ptr<AsyncSocketChannel> channel)
+  {
+    // Socket is armed by channel when an operation is started.
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLONESHOT;
+    event.data.fd = sock;
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (epoll_ctl(Epoll, EPOLL_CTL_ADD, sock, &event) < 0)
+    {
+      THROW_OS_ERROR("Unable to add socket to epoll.");
+    }
+    Channels[sock] = channel;
+  }
+
+  void EventLoop::Arm(int sock, uint32_t events)
+  {
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events | EPOLLONESHOT;
+    event.data.fd = sock;
+    if (epoll_ctl(Epoll, EPOLL_CTL_MOD, sock, &event) < 0)
+    {
+      THROW_OS_ERROR("Unable to arm socket in epoll.");
+    }
+  }
+
+  void EventLoop::Remove(int sock)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (Channels.erase(sock))
+    {
+      // Kernels before 2.6.9 require non null event even for deletion.
+      epoll_event event;
+      memset(&event, 0, sizeof(event));
+      epoll_ctl(Epoll, EPOLL_CTL_DEL, sock, &event);
+    }
+  }
+
+  void EventLoop::Wakeup()
+  {
+    const uint64_t value = 1;
+    if (write(WakeupEvent, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    {
+      std::cerr << "Failed to wake up event loop. " << strerror(errno) << std::endl;
+    }
+  }
+
+} // namespace OpcUa
@@ -20,10 +20,85 @@
 
 
 #include <opc/ua/node.h>
+#include <opc/ua/browse_path_cache.h>
 #include <opc/ua/strings.h>
 #include <opc/ua/variable_access_level.h>
 #include <opc/common/object_id.h>
 
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+
+namespace
+{
+  using namespace OpcUa;
+
+  // Guards the first write of a lazily read browse name. Held only for the assignment.
+  std::mutex NameMutex;
+
+  // Query of forward references of nodes.
+  NodesQuery MakeBrowseQuery(const std::vector<NodeID>& nodes, const BrowseFilter& filter)
+  {
+    OpcUa::BrowseDescription description;
+    description.Direction = OpcUa::BrowseDirection::Forward;
+    description.IncludeSubtypes = filter.IncludeSubtypes;
+    description.NodeClasses = filter.NodeClasses;
+    description.ResultMask = OpcUa::REFERENCE_ALL;
+    description.ReferenceTypeID = filter.Reference;
+
+    OpcUa::NodesQuery query;
+    query.MaxReferenciesPerNode = filter.MaxReferencesPerNode;
+    query.NodesToBrowse.reserve(nodes.size());
+    for (const NodeID& node : nodes)
+    {
+      description.NodeToBrowse = node;
+      query.NodesToBrowse.push_back(description);
+    }
+    return query;
+  }
+
+  // Parse elements of path in format 'namespace:browsename'. Elements without namespace
+  // inherit namespace of previous element, first element inherits ns.
+  std::vector<QualifiedName> ParsePath(const std::vector<std::string>& path, uint16_t ns)
+  {
+    std::vector<QualifiedName> result;
+    result.reserve(path.size());
+    for (const std::string& str: path)
+    {
+      QualifiedName qname = QualifiedName::ParseFromString(str, ns);
+      ns = qname.NamespaceIndex;
+      result.push_back(qname);
+    }
+    return result;
+  }
+
+  std::vector<std::vector<QualifiedName>> ParsePaths(const std::vector<std::vector<std::string>>& paths, uint16_t ns)
+  {
+    std::vector<std::vector<QualifiedName>> result;
+    result.reserve(paths.size());
+    for (const std::vector<std::string>& path : paths)
+    {
+      result.push_back(ParsePath(path, ns));
+    }
+    return result;
+  }
+
+  BrowsePath MakeBrowsePath(const NodeID& startingNode, const std::vector<QualifiedName>& path)
+  {
+    BrowsePath bpath;
+    bpath.StartingNode = startingNode;
+    bpath.Path.Elements.reserve(path.size());
+    for (const QualifiedName& qname: path)
+    {
+      RelativePathElement el;
+      el.TargetName = qname;
+      bpath.Path.Elements.push_back(el);
+    }
+    return bpath;
+  }
+
+}
 
 namespace OpcUa
 {
@@ -31,13 +106,12 @@ namespace OpcUa
   Node::Node(Remote::Server::SharedPtr srv)
     : Node(srv, ObjectID::RootFolder)
   {
-    BrowseName = GetName();
   }
 
   Node::Node(Remote::Server::SharedPtr srv, const NodeID& id)
     : Server(srv)
     , Id(id)
-    , BrowseName(GetName())
+    , BrowseNameResolved(false)
   {
   }
 
@@ -45,14 +119,33 @@ namespace OpcUa
     : Server(srv)
     , Id(id)
     , BrowseName(name)
+    , BrowseNameResolved(true)
   {
   }
 
   Node::Node(const Node& other)
     : Server(other.Server)
     , Id(other.Id)
-    , BrowseName(other.BrowseName)
+    , BrowseNameResolved(false)
   {
+    if (other.BrowseNameResolved.load(std::memory_order_acquire))
+    {
+      BrowseName = other.BrowseName;
+      BrowseNameResolved.store(true, std::memory_order_release);
+    }
+  }
+
+  Node& Node::operator=(const Node& other)
+  {
+    if (this != &other)
+    {
+      Server = other.Server;
+      Id = other.Id;
+      const bool resolved = other.BrowseNameResolved.load(std::memory_order_acquire);
+      BrowseName = resolved ? other.BrowseName : QualifiedName();
+      BrowseNameResolved.store(resolved, std::memory_order_release);
+    }
+    return *this;
   }
 
   NodeID Node::GetId() const
@@ -70,8 +163,7 @@ namespace OpcUa
     std::vector<DataValue> vec =  Server->Attributes()-> Read(params); 
     if ( vec.size() > 0 )
     {
-      DataValue dv =  Server->Attributes()->Read(params).front(); 
-      return dv.Value;
+      return vec.front().Value;
     }
     else
     {
@@ -96,28 +188,20 @@ namespace OpcUa
 
   std::vector<Node> Node::GetChildren(const OpcUa::ReferenceID& refid) const
   {
-    OpcUa::BrowseDescription description;
-    description.NodeToBrowse = Id;
-    description.Direction = OpcUa::BrowseDirection::Forward;
-    description.IncludeSubtypes = true;
-    description.NodeClasses = OpcUa::NODE_CLASS_ALL;
-    description.ResultMask = OpcUa::REFERENCE_ALL;
-    description.ReferenceTypeID =  refid;
+    BrowseFilter filter;
+    filter.Reference = refid;
+    filter.MaxReferencesPerNode = 100;
 
-    OpcUa::NodesQuery query;
-    query.NodesToBrowse.push_back(description);
-    query.MaxReferenciesPerNode = 100;
+    const std::vector<std::vector<ReferenceDescription>> refs = Server->Views()->BrowseNodes(MakeBrowseQuery(std::vector<NodeID>(1, Id), filter));
     std::vector<Node> nodes;
-    std::vector<OpcUa::ReferenceDescription> refs = Server->Views()->Browse(query);
-    while(!refs.empty())
+    if (refs.empty())
     {
-      for (auto refIt : refs)
-      {
-        Node node(Server, refIt.TargetNodeID);
-        //std::cout << "Creating node with borwsename: " << refIt.BrowseName.NamespaceIndex << refIt.BrowseName.Name << std::endl;
-        nodes.push_back(node);
-      }
-      refs = Server->Views()->BrowseNext();
+      return nodes;
+    }
+    for (const ReferenceDescription& ref : refs.front())
+    {
+      // Browse name is already in the reference, no need to read it again.
+      nodes.push_back(Node(Server, ref.TargetNodeID, ref.BrowseName));
     }
     return nodes;
   }
@@ -127,12 +211,90 @@ namespace OpcUa
     return GetChildren(ReferenceID::HierarchicalReferences);
   }
 
+  AddressSpaceSnapshot Node::BrowseRecursive(uint32_t depth, const BrowseFilter& filter) const
+  {
+    AddressSpaceSnapshot snapshot;
+    std::map<NodeID, uint32_t> indexes;
+
+    AddressSpaceSnapshot::NodeData root;
+    root.Id = Id;
+    root.BrowseName = GetName();
+    // Classes of other nodes come with references, the starting node has to be read.
+    const Variant nodeClass = GetAttribute(AttributeID::NODE_CLASS);
+    root.Class = nodeClass.Type == VariantType::INT32 && !nodeClass.Value.Int32.empty()
+      ? static_cast<NodeClass>(nodeClass.Value.Int32.front())
+      : NodeClass::Unspecified;
+    root.Depth = 0;
+    snapshot.Nodes.push_back(root);
+    indexes.insert(std::make_pair(Id, 0));
+
+    // Nodes are appended level by level, so snapshot itself is the queue of breadth first search.
+    // All nodes of a level are browsed with one request per chunk.
+    for (std::size_t levelBegin = 0, levelEnd = 1; levelBegin < levelEnd; levelBegin = levelEnd, levelEnd = snapshot.Nodes.size())
+    {
+      const uint32_t level = snapshot.Nodes[levelBegin].Depth;
+      if (level >= depth)
+      {
+        break;
+      }
+
+      for (std::size_t first = levelBegin; first < levelEnd; first += DefaultMaxItemsPerRequest)
+      {
+        const std::size_t last = std::min(first + DefaultMaxItemsPerRequest, levelEnd);
+        std::vector<NodeID> frontier;
+        frontier.reserve(last - first);
+        for (std::size_t i = first; i < last; ++i)
+        {
+          frontier.push_back(snapshot.Nodes[i].Id);
+        }
+
+        const std::vector<std::vector<ReferenceDescription>> refs = Server->Views()->BrowseNodes(MakeBrowseQuery(frontier, filter));
+        for (std::size_t i = first; i < last && i - first < refs.size(); ++i)
+        {
+          for (const ReferenceDescription& ref : refs[i - first])
+          {
+            auto inserted = indexes.insert(std::make_pair(ref.TargetNodeID, static_cast<uint32_t>(snapshot.Nodes.size())));
+            if (inserted.second)
+            {
+              AddressSpaceSnapshot::NodeData node;
+              node.Id = ref.TargetNodeID;
+              node.BrowseName = ref.BrowseName;
+              node.Class = ref.TargetNodeClass;
+              node.TypeDefinition = ref.TargetNodeTypeDefinition;
+              node.Depth = level + 1;
+              snapshot.Nodes.push_back(node);
+            }
+
+            AddressSpaceSnapshot::Reference reference;
+            reference.Source = static_cast<uint32_t>(i);
+            reference.Target = inserted.first->second;
+            reference.ReferenceTypeID = ref.ReferenceTypeID;
+            snapshot.References.push_back(reference);
+          }
+        }
+      }
+    }
+    return snapshot;
+  }
+
   QualifiedName Node::GetName() const
   {
+    if (BrowseNameResolved.load(std::memory_order_acquire))
+    {
+      return BrowseName;
+    }
+
+    // Server is called without lock, threads resolving the same node at once keep the first name.
     Variant var = GetAttribute(OpcUa::AttributeID::BROWSE_NAME);
     if (var.Type == OpcUa::VariantType::QUALIFIED_NAME)
     {
-      return var.Value.Name.front();
+      std::lock_guard<std::mutex> lock(NameMutex);
+      if (!BrowseNameResolved.load(std::memory_order_relaxed))
+      {
+        BrowseName = var.Value.Name.front();
+        BrowseNameResolved.store(true, std::memory_order_release);
+      }
+      return BrowseName;
     }
 
     return QualifiedName(); // TODO Exception!
@@ -165,41 +327,23 @@ namespace OpcUa
 
   Node Node::GetChild(const std::vector<std::string>& path) const
   {
-    std::vector<QualifiedName> vec;
-    uint16_t ns = BrowseName.NamespaceIndex;
-    for (std::string str: path)
-    {
-      QualifiedName qname = QualifiedName::ParseFromString(str, ns);
-      ns = qname.NamespaceIndex;
-      vec.push_back(qname);
-    }
-    return GetChild(vec);
+    return GetChild(ParsePath(path, GetName().NamespaceIndex));
   }
 
 
   Node Node::GetChild(const std::vector<QualifiedName>& path) const
   {
-    std::vector<RelativePathElement> rpath;
-    for (QualifiedName qname: path)
-    {
-      RelativePathElement el;
-      el.TargetName = qname;
-      rpath.push_back(el);
-    }
-    BrowsePath bpath;
-    bpath.Path.Elements = rpath;
-    bpath.StartingNode = Id;
     std::vector<BrowsePath> bpaths;
-    bpaths.push_back(bpath);
+    bpaths.push_back(MakeBrowsePath(Id, path));
     TranslateBrowsePathsParameters params;
     params.BrowsePaths = bpaths;
 
     std::vector<BrowsePathResult> result = Server->Views()->TranslateBrowsePathsToNodeIds(params);
 
-    if ( result.front().Status == OpcUa::StatusCode::Good )
+    if ( !result.empty() && result.front().Status == OpcUa::StatusCode::Good && !result.front().Targets.empty() )
     {
       NodeID node =result.front().Targets.front().Node ;
-      return Node(Server, node);
+      return Node(Server, node, path.empty() ? GetName() : path.back());
     }
     else
     {
@@ -207,11 +351,65 @@ namespace OpcUa
     }
   }
 
+  std::vector<ChildSearchResult> Node::GetChildren(const std::vector<std::vector<std::string>>& paths, std::size_t maxItemsPerRequest) const
+  {
+    return GetChildren(ParsePaths(paths, GetName().NamespaceIndex), maxItemsPerRequest);
+  }
+
+  std::vector<ChildSearchResult> Node::GetChildren(const std::vector<std::vector<std::string>>& paths, BrowsePathCache& cache) const
+  {
+    return GetChildren(ParsePaths(paths, GetName().NamespaceIndex), cache);
+  }
+
+  std::vector<ChildSearchResult> Node::GetChildren(const std::vector<std::vector<QualifiedName>>& paths, BrowsePathCache& cache) const
+  {
+    return cache.Resolve(Id, paths);
+  }
+
+  std::vector<ChildSearchResult> Node::GetChildren(const std::vector<std::vector<QualifiedName>>& paths, std::size_t maxItemsPerRequest) const
+  {
+    if (maxItemsPerRequest == 0)
+    {
+      maxItemsPerRequest = paths.size();
+    }
+
+    std::vector<ChildSearchResult> result;
+    result.reserve(paths.size());
+    for (std::size_t first = 0; first < paths.size(); first += maxItemsPerRequest)
+    {
+      const std::size_t last = std::min(first + maxItemsPerRequest, paths.size());
+      TranslateBrowsePathsParameters params;
+      params.BrowsePaths.reserve(last - first);
+      for (std::size_t i = first; i < last; ++i)
+      {
+        params.BrowsePaths.push_back(MakeBrowsePath(Id, paths[i]));
+      }
+
+      const std::vector<BrowsePathResult> targets = Server->Views()->TranslateBrowsePathsToNodeIds(params);
+      for (std::size_t i = first; i < last; ++i)
+      {
+        const std::size_t idx = i - first;
+        if (idx < targets.size() && targets[idx].Status == StatusCode::Good && !targets[idx].Targets.empty())
+        {
+          const QualifiedName& name = paths[i].empty() ? GetName() : paths[i].back();
+          result.push_back(ChildSearchResult(StatusCode::Good, Node(Server, targets[idx].Targets.front().Node, name)));
+        }
+        else
+        {
+          const StatusCode status = idx < targets.size() && targets[idx].Status != StatusCode::Good ? targets[idx].Status : StatusCode::BadNoMatch;
+          result.push_back(ChildSearchResult(status, Node(Server, NodeID(), QualifiedName())));
+        }
+      }
+    }
+    return result;
+  }
+
   // TODO: move to somewhere
   std::string Node::ToString() const
   {
     std::ostringstream os;
-    os << "Node(" << BrowseName.NamespaceIndex <<":"<< BrowseName.Name << ", id=" ;
+    const QualifiedName& name = GetName();
+    os << "Node(" << name.NamespaceIndex <<":"<< name.Name << ", id=" ;
     OpcUa::NodeIDEncoding encoding = static_cast<OpcUa::NodeIDEncoding>(Id.Encoding & OpcUa::NodeIDEncoding::EV_VALUE_MASK);
 
     if (encoding != EV_TWO_BYTE)
@@ -264,14 +462,14 @@ namespace OpcUa
   Node Node::AddFolder(const std::string& nodeid, const std::string& browsename)
    {
      NodeID node = NodeID::ParseFromString(nodeid, this->Id.GetNamespaceIndex());
-     QualifiedName qn = QualifiedName::ParseFromString(browsename, this->BrowseName.NamespaceIndex);
+     QualifiedName qn = QualifiedName::ParseFromString(browsename, GetName().NamespaceIndex);
      return AddFolder(node, qn);
    }
 
   Node Node::AddFolder(const std::string& name)
   {
     NodeID nodeid = OpcUa::NumericNodeID(Common::GenerateNewID(), this->Id.GetNamespaceIndex());
-    QualifiedName qn = QualifiedName::ParseFromString(name, BrowseName.NamespaceIndex);
+    QualifiedName qn = QualifiedName::ParseFromString(name, GetName().NamespaceIndex);
     return AddFolder(nodeid, qn);
   }
 
@@ -313,14 +511,14 @@ namespace OpcUa
   Node Node::AddVariable(const std::string& name, const Variant& val)
   {
     NodeID nodeid = OpcUa::NumericNodeID(Common::GenerateNewID(), this->Id.GetNamespaceIndex());
-    QualifiedName qn = QualifiedName::ParseFromString(name, BrowseName.NamespaceIndex);
+    QualifiedName qn = QualifiedName::ParseFromString(name, GetName().NamespaceIndex);
     return AddVariable(nodeid, qn, val);
   }
 
   Node Node::AddVariable(const std::string& nodeid, const std::string& browsename, const Variant& val)
   {
     NodeID node = NodeID::ParseFromString(nodeid, this->Id.GetNamespaceIndex());
-    QualifiedName qn = QualifiedName::ParseFromString(browsename, this->BrowseName.NamespaceIndex);
+    QualifiedName qn = QualifiedName::ParseFromString(browsename, GetName().NamespaceIndex);
     return AddVariable(node, qn, val);
   }
 
@@ -375,14 +573,14 @@ namespace OpcUa
   Node Node::AddProperty(const std::string& name, const Variant& val)
   {
     NodeID nodeid = OpcUa::NumericNodeID(Common::GenerateNewID(), this->Id.GetNamespaceIndex());
-    const QualifiedName& qname = QualifiedName::ParseFromString(name, BrowseName.NamespaceIndex);
+    const QualifiedName& qname = QualifiedName::ParseFromString(name, GetName().NamespaceIndex);
     return AddProperty(nodeid, qname, val);
   }
 
   Node Node::AddProperty(const std::string& nodeid, const std::string& browsename, const Variant& val)
   {
     NodeID node = NodeID::ParseFromString(nodeid, this->Id.GetNamespaceIndex());
-    QualifiedName qn = QualifiedName::ParseFromString(browsename, this->BrowseName.NamespaceIndex);
+    QualifiedName qn = QualifiedName::ParseFromString(browsename, GetName().NamespaceIndex);
     return AddProperty(node, qn, val);
   }
 
@@ -441,6 +639,105 @@ namespace OpcUa
     return GetAttribute(AttributeID::DATA_TYPE);
   }
 
+  std::vector<DataValue> ReadAttributes(Remote::Server::SharedPtr server, const std::vector<AttributeValueID>& attributes, std::size_t maxItemsPerRequest)
+  {
+    if (maxItemsPerRequest == 0)
+    {
+      maxItemsPerRequest = attributes.size();
+    }
+
+    std::vector<DataValue> result;
+    result.reserve(attributes.size());
+    for (std::size_t first = 0; first < attributes.size(); first += maxItemsPerRequest)
+    {
+      const std::size_t last = std::min(first + maxItemsPerRequest, attributes.size());
+      ReadParameters params;
+      params.AttributesToRead.assign(attributes.begin() + first, attributes.begin() + last);
+      std::vector<DataValue> values = server->Attributes()->Read(params);
+      // Keep results aligned with the request even if server answered with less values.
+      DataValue missing;
+      missing.Encoding = DATA_VALUE_STATUS_CODE;
+      missing.Status = StatusCode::BadUnexpectedError;
+      values.resize(last - first, missing);
+      result.insert(result.end(), values.begin(), values.end());
+    }
+    return result;
+  }
+
+  std::vector<DataValue> ReadAttributes(Remote::Server::SharedPtr server, const std::vector<Node>& nodes, AttributeID attr, std::size_t maxItemsPerRequest)
+  {
+    std::vector<AttributeValueID> attributes;
+    attributes.reserve(nodes.size());
+    for (const Node& node : nodes)
+    {
+      AttributeValueID attribute;
+      attribute.Node = node.GetId();
+      attribute.Attribute = attr;
+      attributes.push_back(attribute);
+    }
+    return ReadAttributes(server, attributes, maxItemsPerRequest);
+  }
+
+  std::vector<DataValue> ReadValues(Remote::Server::SharedPtr server, const std::vector<Node>& nodes, std::size_t maxItemsPerRequest)
+  {
+    return ReadAttributes(server, nodes, AttributeID::VALUE, maxItemsPerRequest);
+  }
+
+  std::vector<StatusCode> WriteAttributes(Remote::Server::SharedPtr server, const std::vector<WriteValue>& values, std::size_t maxItemsPerRequest)
+  {
+    if (maxItemsPerRequest == 0)
+    {
+      maxItemsPerRequest = values.size();
+    }
+
+    std::vector<StatusCode> result;
+    result.reserve(values.size());
+    for (std::size_t first = 0; first < values.size(); first += maxItemsPerRequest)
+    {
+      const std::size_t last = std::min(first + maxItemsPerRequest, values.size());
+      std::vector<StatusCode> codes = server->Attributes()->Write(std::vector<WriteValue>(values.begin() + first, values.begin() + last));
+      // Items the server did not answer for are reported as not written.
+      codes.resize(last - first, StatusCode::BadUnexpectedError);
+      result.insert(result.end(), codes.begin(), codes.end());
+    }
+    return result;
+  }
+
+  std::vector<StatusCode> WriteAttributes(Remote::Server::SharedPtr server, const std::vector<NodeAttributeValue>& values, std::size_t maxItemsPerRequest)
+  {
+    std::vector<WriteValue> attributes;
+    attributes.reserve(values.size());
+    for (const NodeAttributeValue& value : values)
+    {
+      WriteValue attribute;
+      attribute.Node = value.Target.GetId();
+      attribute.Attribute = value.Attribute;
+      attribute.Data = value.Value;
+      attributes.push_back(attribute);
+    }
+    return WriteAttributes(server, attributes, maxItemsPerRequest);
+  }
+
+  std::vector<StatusCode> WriteValues(Remote::Server::SharedPtr server, const std::vector<Node>& nodes, const std::vector<Variant>& values, std::size_t maxItemsPerRequest)
+  {
+    if (nodes.size() != values.size())
+    {
+      throw std::invalid_argument("Number of nodes and values to write differs.");
+    }
+
+    std::vector<WriteValue> attributes;
+    attributes.reserve(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+      WriteValue attribute;
+      attribute.Node = nodes[i].GetId();
+      attribute.Attribute = AttributeID::VALUE;
+      attribute.Data = values[i];
+      attributes.push_back(attribute);
+    }
+    return WriteAttributes(server, attributes, maxItemsPerRequest);
+  }
+
 } // namespace OpcUa
 
 
@@ -0,0 +1,191 @@
+/// @brief Batch creation of nodes.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/node_builder.h>
+#include <opc/common/object_id.h>
+
+#include <algorithm>
+
+namespace
+{
+  using namespace OpcUa;
+
+  AddNodesItem CreateBaseItem(const NodeID& parent, ReferenceID reference, const NodeID& id, const QualifiedName& browseName, NodeClass nodeClass, ObjectID typeDefinition)
+  {
+    AddNodesItem item;
+    item.ParentNodeId = parent;
+    item.ReferenceTypeId = reference;
+    item.RequestedNewNodeID = id;
+    item.BrowseName = browseName;
+    item.Class = nodeClass;
+    item.TypeDefinition = typeDefinition;
+
+    std::map<AttributeID, Variant>& attrs = item.Attributes.Attributes;
+    attrs[AttributeID::NODE_ID] = id;
+    attrs[AttributeID::NODE_CLASS] = static_cast<int32_t>(nodeClass);
+    attrs[AttributeID::BROWSE_NAME] = browseName;
+    attrs[AttributeID::DISPLAY_NAME] = LocalizedText(browseName.Name);
+    attrs[AttributeID::DESCRIPTION] = LocalizedText(browseName.Name);
+    attrs[AttributeID::WRITE_MASK] = 0;
+    attrs[AttributeID::USER_WRITE_MASK] = 0;
+    attrs[AttributeID::EVENT_NOTIFIER] = (uint8_t)0;
+    return item;
+  }
+
+  NodeID GenerateID(const NodeID& parent)
+  {
+    return OpcUa::NumericNodeID(Common::GenerateNewID(), parent.GetNamespaceIndex());
+  }
+
+}
+
+namespace OpcUa
+{
+
+  NodeBuilder::NodeBuilder(Remote::Server::SharedPtr server, std::size_t maxItemsPerRequest)
+    : Server(server)
+    , MaxItemsPerRequest(maxItemsPerRequest ? maxItemsPerRequest : DefaultMaxItemsPerRequest)
+  {
+  }
+
+  void NodeBuilder::Reserve(std::size_t nodesCount)
+  {
+    Nodes.reserve(std::min(nodesCount, MaxItemsPerRequest));
+    AddedNodes.reserve(nodesCount);
+  }
+
+  NodeID NodeBuilder::AddFolder(const NodeID& parent, const NodeID& folderId, const QualifiedName& browseName)
+  {
+    Nodes.push_back(CreateFolderItem(parent, folderId, browseName));
+    SendFullChunk();
+    return folderId;
+  }
+
+  NodeID NodeBuilder::AddFolder(const NodeID& parent, const QualifiedName& browseName)
+  {
+    return AddFolder(parent, GenerateID(parent), browseName);
+  }
+
+  NodeID NodeBuilder::AddVariable(const NodeID& parent, const NodeID& variableId, const QualifiedName& browseName, const Variant& value)
+  {
+    Nodes.push_back(CreateVariableItem(parent, variableId, browseName, value));
+    SendFullChunk();
+    return variableId;
+  }
+
+  NodeID NodeBuilder::AddVariable(const NodeID& parent, const QualifiedName& browseName, const Variant& value)
+  {
+    return AddVariable(parent, GenerateID(parent), browseName, value);
+  }
+
+  NodeID NodeBuilder::AddProperty(const NodeID& parent, const NodeID& propertyId, const QualifiedName& browseName, const Variant& value)
+  {
+    Nodes.push_back(CreatePropertyItem(parent, propertyId, browseName, value));
+    SendFullChunk();
+    return propertyId;
+  }
+
+  NodeID NodeBuilder::AddProperty(const NodeID& parent, const QualifiedName& browseName, const Variant& value)
+  {
+    return AddProperty(parent, GenerateID(parent), browseName, value);
+  }
+
+  void NodeBuilder::AddNode(const AddNodesItem& item)
+  {
+    Nodes.push_back(item);
+    SendFullChunk();
+  }
+
+  void NodeBuilder::AddReference(const AddReferencesItem& item)
+  {
+    References.push_back(item);
+  }
+
+  std::size_t NodeBuilder::Size() const
+  {
+    return Nodes.size();
+  }
+
+  NodeBuilderResult NodeBuilder::Commit()
+  {
+    SendNodes();
+
+    NodeBuilderResult result;
+    result.Nodes.swap(AddedNodes);
+    result.References.reserve(References.size());
+    for (std::size_t first = 0; first < References.size(); first += MaxItemsPerRequest)
+    {
+      const std::size_t last = std::min(first + MaxItemsPerRequest, References.size());
+      const std::vector<AddReferencesItem> chunk(References.begin() + first, References.begin() + last);
+      std::vector<StatusCode> added = Server->NodeManagement()->AddReferences(chunk);
+      added.resize(chunk.size(), StatusCode::BadUnexpectedError);
+      result.References.insert(result.References.end(), added.begin(), added.end());
+    }
+
+    std::vector<AddNodesItem>().swap(Nodes);
+    std::vector<AddReferencesItem>().swap(References);
+    return result;
+  }
+
+  void NodeBuilder::SendFullChunk()
+  {
+    if (Nodes.size() >= MaxItemsPerRequest)
+    {
+      SendNodes();
+    }
+  }
+
+  void NodeBuilder::SendNodes()
+  {
+    if (Nodes.empty())
+    {
+      return;
+    }
+
+    std::vector<AddNodesResult> added = Server->NodeManagement()->AddNodes(Nodes);
+    // Keep results aligned with nodes even if server answered with less results.
+    AddNodesResult missing;
+    missing.Status = StatusCode::BadUnexpectedError;
+    added.resize(Nodes.size(), missing);
+    AddedNodes.insert(AddedNodes.end(), added.begin(), added.end());
+    // Capacity is kept for the next chunk.
+    Nodes.clear();
+  }
+
+  AddNodesItem NodeBuilder::CreateFolderItem(const NodeID& parent, const NodeID& folderId, const QualifiedName& browseName)
+  {
+    return CreateBaseItem(parent, ReferenceID::Organizes, folderId, browseName, NodeClass::Object, ObjectID::FolderType);
+  }
+
+  AddNodesItem NodeBuilder::CreateVariableItem(const NodeID& parent, const NodeID& variableId, const QualifiedName& browseName, const Variant& value)
+  {
+    AddNodesItem item = CreateBaseItem(parent, ReferenceID::HasComponent, variableId, browseName, NodeClass::Variable, ObjectID::BaseDataVariableType);
+    std::map<AttributeID, Variant>& attrs = item.Attributes.Attributes;
+    attrs[AttributeID::VALUE] = value;
+    attrs[AttributeID::DATA_TYPE] = VariantTypeToDataType(value.Type);
+    attrs[AttributeID::ARRAY_DIMENSIONS] = value.Dimensions.size(); //FIXME: to check!! the same as in Node::AddVariable
+    attrs[AttributeID::MINIMUM_SAMPLING_INTERVAL] = Duration(0);
+    attrs[AttributeID::HISTORIZING] = false;
+    attrs[AttributeID::VALUE_RANK] = ~int32_t();
+    return item;
+  }
+
+  AddNodesItem NodeBuilder::CreatePropertyItem(const NodeID& parent, const NodeID& propertyId, const QualifiedName& browseName, const Variant& value)
+  {
+    AddNodesItem item = CreateBaseItem(parent, ReferenceID::HasProperty, propertyId, browseName, NodeClass::Variable, ObjectID::PropertyType);
+    std::map<AttributeID, Variant>& attrs = item.Attributes.Attributes;
+    attrs[AttributeID::VALUE] = value;
+    attrs[AttributeID::DATA_TYPE] = VariantTypeToDataType(value.Type);
+    attrs[AttributeID::ARRAY_DIMENSIONS] = value.Dimensions.size(); //FIXME: to check!! the same as in Node::AddProperty
+    attrs[AttributeID::MINIMUM_SAMPLING_INTERVAL] = Duration(0);
+    attrs[AttributeID::HISTORIZING] = false;
+    attrs[AttributeID::VALUE_RANK] = int32_t(-1);
+    return item;
+  }
+
+} // namespace OpcUa
@@ -0,0 +1,193 @@
+/// @brief Reusable subtrees of address space.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/node_template.h>
+#include <opc/common/object_id.h>
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace OpcUa
+{
+
+  const NodeTemplate::Handle NodeTemplate::Root;
+
+  NodeTemplate::NodeTemplate(const QualifiedName& rootName)
+  {
+    TemplateNode root;
+    root.Parent = Root;
+    root.Item = NodeBuilder::CreateFolderItem(NodeID(), NodeID(), rootName);
+    Nodes.push_back(root);
+  }
+
+  NodeTemplate NodeTemplate::Capture(const Node& root, uint32_t depth)
+  {
+    const AddressSpaceSnapshot snapshot = root.BrowseRecursive(depth);
+    const AddressSpaceSnapshot::NodeData& rootData = snapshot.Nodes.front();
+    if (rootData.Class != NodeClass::Object && rootData.Class != NodeClass::Variable)
+    {
+      throw std::invalid_argument("Only objects and variables can be captured.");
+    }
+
+    // Parent of every node is the source of the first reference which found it.
+    std::vector<const AddressSpaceSnapshot::Reference*> parents(snapshot.Nodes.size(), nullptr);
+    for (const AddressSpaceSnapshot::Reference& ref : snapshot.References)
+    {
+      if (!parents[ref.Target] && ref.Target != 0)
+      {
+        parents[ref.Target] = &ref;
+      }
+    }
+
+    std::vector<Node> variables;
+    for (const AddressSpaceSnapshot::NodeData& node : snapshot.Nodes)
+    {
+      if (node.Class == NodeClass::Variable)
+      {
+        variables.push_back(Node(root.GetServer(), node.Id, node.BrowseName));
+      }
+    }
+    const std::vector<DataValue> values = ReadValues(root.GetServer(), variables);
+
+    // Root keeps its class, a variable root keeps its value.
+    NodeTemplate result;
+    TemplateNode rootNode;
+    rootNode.Parent = Root;
+    rootNode.Item = rootData.Class == NodeClass::Variable
+      ? NodeBuilder::CreateVariableItem(NodeID(), NodeID(), rootData.BrowseName, values.front().Value)
+      : NodeBuilder::CreateFolderItem(NodeID(), NodeID(), rootData.BrowseName);
+    result.Nodes.push_back(rootNode);
+
+    // Snapshot is in breadth first order, so parents are added before their children.
+    // Nodes of other classes are not captured together with their subtrees.
+    std::vector<Handle> handles(snapshot.Nodes.size(), Root);
+    std::vector<bool> captured(snapshot.Nodes.size(), false);
+    captured[0] = true;
+    std::size_t variableIndex = rootData.Class == NodeClass::Variable ? 1 : 0;
+    for (std::size_t i = 1; i < snapshot.Nodes.size(); ++i)
+    {
+      const AddressSpaceSnapshot::NodeData& node = snapshot.Nodes[i];
+      const bool isVariable = node.Class == NodeClass::Variable;
+      const Variant value = isVariable ? values[variableIndex++].Value : Variant();
+      if (!captured[parents[i]->Source])
+      {
+        continue;
+      }
+
+      const Handle parent = handles[parents[i]->Source];
+      captured[i] = isVariable || node.Class == NodeClass::Object;
+      if (isVariable)
+      {
+        handles[i] = parents[i]->ReferenceTypeID == NodeID(ReferenceID::HasProperty)
+          ? result.AddProperty(parent, node.BrowseName, value)
+          : result.AddVariable(parent, node.BrowseName, value);
+      }
+      else if (node.Class == NodeClass::Object)
+      {
+        handles[i] = result.AddFolder(parent, node.BrowseName);
+      }
+    }
+    return result;
+  }
+
+  NodeTemplate::NodeTemplate()
+  {
+  }
+
+  NodeTemplate::Handle NodeTemplate::AddFolder(Handle parent, const QualifiedName& browseName)
+  {
+    return Add(parent, NodeBuilder::CreateFolderItem(NodeID(), NodeID(), browseName));
+  }
+
+  NodeTemplate::Handle NodeTemplate::AddVariable(Handle parent, const QualifiedName& browseName, const Variant& value)
+  {
+    return Add(parent, NodeBuilder::CreateVariableItem(NodeID(), NodeID(), browseName, value));
+  }
+
+  NodeTemplate::Handle NodeTemplate::AddProperty(Handle parent, const QualifiedName& browseName, const Variant& value)
+  {
+    return Add(parent, NodeBuilder::CreatePropertyItem(NodeID(), NodeID(), browseName, value));
+  }
+
+  std::size_t NodeTemplate::Size() const
+  {
+    return Nodes.size();
+  }
+
+  std::vector<NodeID> NodeTemplate::Instantiate(NodeBuilder& builder, const NodeID& parent, const QualifiedName& rootName) const
+  {
+    std::vector<NodeID> ids;
+    ids.reserve(Nodes.size());
+    for (std::size_t i = 0; i < Nodes.size(); ++i)
+    {
+      const TemplateNode& node = Nodes[i];
+      const NodeID id = OpcUa::NumericNodeID(Common::GenerateNewID(), parent.GetNamespaceIndex());
+      ids.push_back(id);
+
+      AddNodesItem item = node.Item;
+      item.RequestedNewNodeID = id;
+      item.ParentNodeId = i == Root ? parent : ids[node.Parent];
+      item.Attributes.Attributes[AttributeID::NODE_ID] = id;
+      if (i == Root)
+      {
+        item.BrowseName = rootName;
+        item.Attributes.Attributes[AttributeID::BROWSE_NAME] = rootName;
+        item.Attributes.Attributes[AttributeID::DISPLAY_NAME] = LocalizedText(rootName.Name);
+        item.Attributes.Attributes[AttributeID::DESCRIPTION] = LocalizedText(rootName.Name);
+      }
+      builder.AddNode(item);
+    }
+    return ids;
+  }
+
+  std::vector<NodeID> NodeTemplate::Instantiate(Remote::Server::SharedPtr server, const NodeID& parent, const std::vector<QualifiedName>& rootNames) const
+  {
+    NodeBuilder builder(server);
+    builder.Reserve(Nodes.size() * rootNames.size());
+
+    std::vector<NodeID> roots;
+    roots.reserve(rootNames.size());
+    for (const QualifiedName& name : rootNames)
+    {
+      roots.push_back(Instantiate(builder, parent, name)[Root]);
+    }
+
+    const NodeBuilderResult result = builder.Commit();
+    for (std::size_t i = 0; i < Nodes.size() * rootNames.size(); ++i)
+    {
+      if (i >= result.Nodes.size() || result.Nodes[i].Status != StatusCode::Good)
+      {
+        std::ostringstream message;
+        message << "Unable to add node '" << Nodes[i % Nodes.size()].Item.BrowseName.Name << "' of instance '" << rootNames[i / Nodes.size()].Name << "'";
+        if (i < result.Nodes.size())
+        {
+          message << ": status 0x" << std::hex << std::setw(8) << std::setfill('0') << static_cast<uint32_t>(result.Nodes[i].Status);
+        }
+        message << ".";
+        throw std::runtime_error(message.str());
+      }
+    }
+    return roots;
+  }
+
+  NodeTemplate::Handle NodeTemplate::Add(Handle parent, const AddNodesItem& item)
+  {
+    if (parent >= Nodes.size())
+    {
+      throw std::invalid_argument("Invalid parent node in template.");
+    }
+
+    TemplateNode node;
+    node.Parent = parent;
+    node.Item = item;
+    Nodes.push_back(node);
+    return Nodes.size() - 1;
+  }
+
+} // namespace OpcUa
@@ -0,0 +1,385 @@
+/// @brief Bounded queues of data change notifications.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/notification_queue.h>
+#include <opc/ua/protocol/binary/stream.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+  // OPC UA time counts 100 ns intervals from 1601-01-01.
+  const uint64_t SecondsFrom1601To1970 = 11644473600ull;
+
+  OpcUa::DateTime CurrentDateTime()
+  {
+    const std::chrono::system_clock::duration sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+    const uint64_t intervals = std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch).count() * 10;
+    return intervals + SecondsFrom1601To1970 * 10000000;
+  }
+
+  const std::size_t SerializerBufferSize = 4096;
+
+  // NotificationData of PublishResult is an ExtensionObject with DataChangeNotification
+  // in binary body. Its type id is written as four byte node id.
+  const uint8_t FourByteNodeIdEncoding = 1;
+  const uint8_t DataChangeNotificationNamespace = 0;
+  const uint16_t DataChangeNotificationEncodingDefaultBinary = 811;
+  const uint8_t ExtensionObjectBinaryBody = 1;
+
+  // Appends data flushed from serializer to a buffer.
+  class BufferAcceptor
+  {
+  public:
+    explicit BufferAcceptor(std::vector<char>& buffer)
+      : Buffer(buffer)
+    {
+    }
+
+    void Send(const char* data, std::size_t size)
+    {
+      Buffer.insert(Buffer.end(), data, data + size);
+    }
+
+  private:
+    std::vector<char>& Buffer;
+  };
+
+  OpcUa::EncodedValue EncodeValue(Common::BufferPool& pool, OpcUa::Binary::DataSerializer& serializer, const OpcUa::DataValue& value)
+  {
+    serializer << value;
+    const std::shared_ptr<std::vector<char>> buffer = pool.Acquire();
+    BufferAcceptor acceptor(*buffer);
+    serializer.Flush(acceptor);
+    return buffer;
+  }
+
+  iovec GetPart(const std::vector<char>& buffer, std::size_t offset, std::size_t size)
+  {
+    iovec part;
+    part.iov_base = const_cast<char*>(buffer.data() + offset);
+    part.iov_len = size;
+    return part;
+  }
+}
+
+namespace OpcUa
+{
+
+  std::size_t EncodedPublishResult::GetSize() const
+  {
+    std::size_t size = 0;
+    for (const iovec& part : Parts)
+    {
+      size += part.iov_len;
+    }
+    return size;
+  }
+
+  template <typename Notification>
+  BasicNotificationQueue<Notification>::BasicNotificationQueue(std::size_t capacity, QueueOverflowPolicy policy)
+    : Policy(policy)
+    , Items(std::max<std::size_t>(capacity, 1))
+    , Head(0)
+    , Count(0)
+    , Discarded(0)
+  {
+    Positions.reserve(Items.size());
+  }
+
+  template <typename Notification>
+  void BasicNotificationQueue<Notification>::Push(const Notification& item)
+  {
+    auto positionIt = Positions.find(item.ClientHandle);
+    if (positionIt != Positions.end())
+    {
+      Items[positionIt->second].Value = item.Value;
+      return;
+    }
+
+    if (Count == Items.size())
+    {
+      ++Discarded;
+      if (Policy == QueueOverflowPolicy::DiscardNewest)
+      {
+        return;
+      }
+      DropOldest();
+    }
+
+    const std::size_t position = (Head + Count) % Items.size();
+    Items[position] = item;
+    Positions[item.ClientHandle] = position;
+    ++Count;
+  }
+
+  template <typename Notification>
+  std::size_t BasicNotificationQueue<Notification>::Pop(std::vector<Notification>& result, std::size_t maxCount)
+  {
+    const std::size_t count = maxCount ? std::min(maxCount, Count) : Count;
+    result.reserve(result.size() + count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      Notification& item = Items[Head];
+      Positions.erase(item.ClientHandle);
+      result.push_back(Notification());
+      std::swap(result.back(), item);
+      Head = (Head + 1) % Items.size();
+      --Count;
+    }
+    return count;
+  }
+
+  template <typename Notification>
+  std::size_t BasicNotificationQueue<Notification>::Size() const
+  {
+    return Count;
+  }
+
+  template <typename Notification>
+  std::size_t BasicNotificationQueue<Notification>::Capacity() const
+  {
+    return Items.size();
+  }
+
+  template <typename Notification>
+  uint64_t BasicNotificationQueue<Notification>::GetDiscarded() const
+  {
+    return Discarded;
+  }
+
+  template <typename Notification>
+  void BasicNotificationQueue<Notification>::DropOldest()
+  {
+    Positions.erase(Items[Head].ClientHandle);
+    // Release value, encoded buffer goes back to its pool.
+    Items[Head] = Notification();
+    Head = (Head + 1) % Items.size();
+    --Count;
+  }
+
+  template class BasicNotificationQueue<MonitoredItems>;
+  template class BasicNotificationQueue<EncodedNotification>;
+
+  NotificationQueues::NotificationQueues(Common::BufferPool::SharedPtr pool)
+    : Pool(pool)
+  {
+  }
+
+  void NotificationQueues::AddSubscription(IntegerID subscriptionId, std::size_t capacity, QueueOverflowPolicy policy)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Subscriptions[subscriptionId].reset(new Subscription(capacity, policy, static_cast<bool>(Pool)));
+  }
+
+  void NotificationQueues::RemoveSubscription(IntegerID subscriptionId)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Subscriptions.erase(subscriptionId);
+  }
+
+  void NotificationQueues::OnDataChange(std::vector<SampledChange>& changes)
+  {
+    PendingBatch batch;
+    if (!Pool)
+    {
+      batch.Changes.swap(changes);
+      PushPending(std::move(batch));
+      return;
+    }
+
+    Binary::DataSerializer serializer(SerializerBufferSize);
+    batch.EncodedChanges.resize(changes.size());
+    for (std::size_t i = 0; i < changes.size(); ++i)
+    {
+      EncodedChange& encoded = batch.EncodedChanges[i];
+      encoded.SubscriptionID = changes[i].SubscriptionID;
+      encoded.Item.ClientHandle = changes[i].Item.ClientHandle;
+      encoded.Item.Value = EncodeValue(*Pool, serializer, changes[i].Item.Value);
+    }
+    changes.clear();
+    PushPending(std::move(batch));
+  }
+
+  void NotificationQueues::OnDataChange(const DataValue& value, const std::vector<NotificationTarget>& targets)
+  {
+    if (!Pool)
+    {
+      std::vector<SampledChange> changes(targets.size());
+      for (std::size_t i = 0; i < targets.size(); ++i)
+      {
+        changes[i].SubscriptionID = targets[i].SubscriptionID;
+        changes[i].Item.ClientHandle = targets[i].ClientHandle;
+        changes[i].Item.Value = value;
+      }
+      OnDataChange(changes);
+      return;
+    }
+
+    Binary::DataSerializer serializer(SerializerBufferSize);
+    const EncodedValue encodedValue = EncodeValue(*Pool, serializer, value);
+    PendingBatch batch;
+    batch.EncodedChanges.resize(targets.size());
+    for (std::size_t i = 0; i < targets.size(); ++i)
+    {
+      EncodedChange& encoded = batch.EncodedChanges[i];
+      encoded.SubscriptionID = targets[i].SubscriptionID;
+      encoded.Item.ClientHandle = targets[i].ClientHandle;
+      encoded.Item.Value = encodedValue;
+    }
+    PushPending(std::move(batch));
+  }
+
+  void NotificationQueues::PushPending(PendingBatch batch)
+  {
+    PendingChanges.Push(std::move(batch));
+
+    // Keep pending changes bounded when nobody publishes, but never wait for the lock.
+    std::unique_lock<std::mutex> lock(Mutex, std::try_to_lock);
+    if (lock)
+    {
+      MovePendingChanges();
+    }
+  }
+
+  std::vector<PublishResult> NotificationQueues::PopPublishResults(const std::vector<IntegerID>& subscriptionsIds, std::size_t maxNotificationsPerPublish)
+  {
+    std::vector<PublishResult> results;
+    const DateTime now = CurrentDateTime();
+    std::lock_guard<std::mutex> lock(Mutex);
+    MovePendingChanges();
+    for (IntegerID id : subscriptionsIds)
+    {
+      auto subscriptionIt = Subscriptions.find(id);
+      if (subscriptionIt == Subscriptions.end() || !subscriptionIt->second->Queue.Size())
+      {
+        continue;
+      }
+
+      Subscription& subscription = *subscriptionIt->second;
+      DataChangeNotification notification;
+      subscription.Queue.Pop(notification.Notification, maxNotificationsPerPublish);
+
+      PublishResult result;
+      result.SubscriptionID = id;
+      result.MoreNotifications = subscription.Queue.Size() != 0;
+      result.Message.SequenceID = ++subscription.SequenceNumber;
+      result.Message.PublishTime = now;
+      result.Message.Data.push_back(NotificationData(notification));
+      result.AvailableSequenceNumber.push_back(result.Message.SequenceID);
+      results.push_back(result);
+    }
+    return results;
+  }
+
+  std::vector<EncodedPublishResult> NotificationQueues::PopEncodedPublishResults(const std::vector<IntegerID>& subscriptionsIds, std::size_t maxNotificationsPerPublish)
+  {
+    std::vector<EncodedPublishResult> results;
+    if (!Pool)
+    {
+      return results;
+    }
+
+    const DateTime now = CurrentDateTime();
+    Binary::DataSerializer serializer(SerializerBufferSize);
+    std::vector<EncodedNotification> notifications;
+    std::lock_guard<std::mutex> lock(Mutex);
+    MovePendingChanges();
+    for (IntegerID id : subscriptionsIds)
+    {
+      auto subscriptionIt = Subscriptions.find(id);
+      if (subscriptionIt == Subscriptions.end() || !subscriptionIt->second->EncodedQueue.Size())
+      {
+        continue;
+      }
+
+      Subscription& subscription = *subscriptionIt->second;
+      notifications.clear();
+      subscription.EncodedQueue.Pop(notifications, maxNotificationsPerPublish);
+
+      EncodedPublishResult result;
+      result.SubscriptionID = id;
+      result.MoreNotifications = subscription.EncodedQueue.Size() != 0;
+      result.SequenceID = ++subscription.SequenceNumber;
+
+      // Body of DataChangeNotification: notifications and empty diagnostic infos.
+      std::size_t bodySize = 2 * sizeof(int32_t);
+      for (const EncodedNotification& notification : notifications)
+      {
+        bodySize += sizeof(uint32_t) + notification.Value->size();
+      }
+
+      // Everything except values goes to one frame buffer: fields up to the first
+      // notification, client handles of notifications and fields after the last one.
+      const std::shared_ptr<std::vector<char>> frame = Pool->Acquire();
+      BufferAcceptor acceptor(*frame);
+      serializer << result.SubscriptionID;
+      serializer << int32_t(1) << result.SequenceID; // AvailableSequenceNumbers
+      serializer << result.MoreNotifications;
+      serializer << result.SequenceID << now;
+      serializer << int32_t(1); // NotificationData
+      serializer << FourByteNodeIdEncoding << DataChangeNotificationNamespace << DataChangeNotificationEncodingDefaultBinary;
+      serializer << ExtensionObjectBinaryBody << static_cast<int32_t>(bodySize);
+      serializer << static_cast<int32_t>(notifications.size());
+      serializer.Flush(acceptor);
+      const std::size_t headSize = frame->size();
+
+      for (const EncodedNotification& notification : notifications)
+      {
+        serializer << notification.ClientHandle;
+      }
+      serializer << int32_t(0); // DiagnosticInfos of DataChangeNotification
+      serializer << int32_t(0) << int32_t(0); // Results and DiagnosticInfos of PublishResult
+      serializer.Flush(acceptor);
+
+      // Frame is complete, parts can point into it now.
+      const std::size_t handlesSize = notifications.size() * sizeof(uint32_t);
+      result.Parts.reserve(2 * notifications.size() + 2);
+      result.Buffers.reserve(notifications.size() + 1);
+      result.Parts.push_back(GetPart(*frame, 0, headSize));
+      for (std::size_t i = 0; i < notifications.size(); ++i)
+      {
+        const EncodedValue& value = notifications[i].Value;
+        result.Parts.push_back(GetPart(*frame, headSize + i * sizeof(uint32_t), sizeof(uint32_t)));
+        result.Parts.push_back(GetPart(*value, 0, value->size()));
+        result.Buffers.push_back(value);
+      }
+      result.Parts.push_back(GetPart(*frame, headSize + handlesSize, frame->size() - headSize - handlesSize));
+      result.Buffers.push_back(frame);
+      results.push_back(std::move(result));
+    }
+    return results;
+  }
+
+  void NotificationQueues::MovePendingChanges()
+  {
+    PendingBatch batch;
+    while (PendingChanges.Pop(batch))
+    {
+      // Changes of deleted subscriptions can still come from sampling in progress.
+      for (const SampledChange& change : batch.Changes)
+      {
+        auto subscriptionIt = Subscriptions.find(change.SubscriptionID);
+        if (subscriptionIt != Subscriptions.end())
+        {
+          subscriptionIt->second->Queue.Push(change.Item);
+        }
+      }
+      for (const EncodedChange& change : batch.EncodedChanges)
+      {
+        auto subscriptionIt = Subscriptions.find(change.SubscriptionID);
+        if (subscriptionIt != Subscriptions.end())
+        {
+          subscriptionIt->second->EncodedQueue.Push(change.Item);
+        }
+      }
+    }
+  }
+
+} // namespace OpcUa
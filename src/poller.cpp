@@ -0,0 +1,109 @@
+/// @brief Readiness multiplexing of many socket channels.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/poller.h>
+#include <opc/ua/errors.h>
+
+#include <cmath>
+#include <errno.h>
+#include <iostream>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace
+{
+  const int MaxEventsPerWait = 256;
+}
+
+namespace OpcUa
+{
+
+  Poller::Poller()
+    : Epoll(epoll_create1(EPOLL_CLOEXEC))
+  {
+    if (Epoll < 0)
+    {
+      THROW_OS_ERROR("Unable to create epoll instance.");
+    }
+  }
+
+  Poller::~Poller()
+  {
+    if (close(Epoll) < 0)
+    {
+      std::cerr << "Failed to close epoll instance. " << strerror(errno) << std::endl;
+    }
+  }
+
+  void Poller::Add(std::shared_ptr<SocketChannel> channel)
+  {
+    channel->SetNonBlocking(true);
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = channel->GetSocket();
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (epoll_ctl(Epoll, EPOLL_CTL_ADD, channel->GetSocket(), &event) < 0)
+    {
+      THROW_OS_ERROR("Unable to add socket to epoll.");
+    }
+    Channels[channel->GetSocket()] = channel;
+  }
+
+  void Poller::Remove(const SocketChannel& channel)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (Channels.erase(channel.GetSocket()))
+    {
+      // Kernels before 2.6.9 require non null event even for deletion.
+      epoll_event event;
+      memset(&event, 0, sizeof(event));
+      epoll_ctl(Epoll, EPOLL_CTL_DEL, channel.GetSocket(), &event);
+    }
+  }
+
+  std::size_t Poller::Size() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Channels.size();
+  }
+
+  std::vector<std::shared_ptr<SocketChannel>> Poller::Wait(float second)
+  {
+    epoll_event events[MaxEventsPerWait];
+    // Timeout below 1 ms is rounded up, otherwise it would not wait at all.
+    const int timeout = second < 0 ? -1 : static_cast<int>(std::ceil(second * 1000));
+    int count = epoll_wait(Epoll, events, MaxEventsPerWait, timeout);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        return std::vector<std::shared_ptr<SocketChannel>>();
+      }
+      THROW_OS_ERROR("Failed to wait for sockets.");
+    }
+
+    std::vector<std::shared_ptr<SocketChannel>> ready;
+    ready.reserve(count);
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (int i = 0; i < count; ++i)
+    {
+      // Channel could be removed by another thread after epoll_wait returned.
+      auto channelIt = Channels.find(events[i].data.fd);
+      if (channelIt != Channels.end())
+      {
+        ready.push_back(channelIt->second);
+      }
+    }
+    return ready;
+  }
+
+} // namespace OpcUa
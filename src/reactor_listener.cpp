@@ -0,0 +1,453 @@
+/// @brief Connection listener based on epoll.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/reactor_listener.h>
+#include <opc/ua/errors.h>
+
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+  // Least recently seen sources are forgotten above this number. Sources which did not
+  // connect for a second have full bucket anyway, so only floods from more sources
+  // than this per second can reset a bucket early.
+  const std::size_t MaxTrackedSources = 65536;
+
+  void Reject(int sock)
+  {
+    // Reset instead of graceful close, nothing is kept in TIME_WAIT for rejected clients.
+    linger reset;
+    reset.l_onoff = 1;
+    reset.l_linger = 0;
+    setsockopt(sock, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    close(sock);
+  }
+}
+
+namespace OpcUa
+{
+  namespace UaServer
+  {
+
+    ReactorConnectionListener::ReactorConnectionListener(const ReactorListenerParameters& params)
+      : Params(params)
+      , Port(0)
+      , StopEvent(-1)
+      , IdleWorkers(0)
+      , StartedWorkers(0)
+      , Stopping(false)
+      , Accepted(0)
+      , Rejected(0)
+      , Active(new std::atomic<std::size_t>(0))
+    {
+    }
+
+    ReactorConnectionListener::~ReactorConnectionListener()
+    {
+      Stop();
+    }
+
+    void ReactorConnectionListener::Start(std::shared_ptr<IncomingConnectionProcessor> connectionProcessor)
+    {
+      Stop();
+
+      StopEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (StopEvent < 0)
+      {
+        THROW_OS_ERROR("Unable to create stop event.");
+      }
+
+      try
+      {
+        ListenSockets.push_back(CreateListenSocket(Params.Port));
+        sockaddr_storage addr;
+        socklen_t addrLen = sizeof(addr);
+        if (getsockname(ListenSockets.front(), reinterpret_cast<sockaddr*>(&addr), &addrLen) < 0)
+        {
+          THROW_OS_ERROR("Unable to get listen socket address.");
+        }
+        Port = ntohs(addr.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6&>(addr).sin6_port : reinterpret_cast<sockaddr_in&>(addr).sin_port);
+
+        // Port 0 is resolved by the first socket, others must share it.
+        for (unsigned i = 1; i < Params.AcceptorThreads; ++i)
+        {
+          ListenSockets.push_back(CreateListenSocket(Port));
+        }
+      }
+      catch (...)
+      {
+        CloseSockets();
+        throw;
+      }
+
+      Processor = connectionProcessor;
+      Stopping = false;
+      const std::size_t workers = std::max<std::size_t>(std::min<std::size_t>(Params.WorkerThreads, Params.MaxWorkerThreads), 1);
+      {
+        std::lock_guard<std::mutex> lock(Mutex);
+        IdleWorkers = workers;
+        StartedWorkers = workers;
+      }
+      for (std::size_t i = 0; i < workers; ++i)
+      {
+        StartWorker();
+      }
+      for (int sock : ListenSockets)
+      {
+        Acceptors.push_back(Common::Thread::Create(std::bind(&ReactorConnectionListener::Accept, this, sock)));
+      }
+    }
+
+    void ReactorConnectionListener::Stop()
+    {
+      if (StopEvent < 0)
+      {
+        return;
+      }
+
+      std::set<std::shared_ptr<SocketChannel>> processing;
+      {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Stopping = true;
+        processing = Processing;
+      }
+      QueueChanged.notify_all();
+      // Event is never read, so it wakes up every acceptor.
+      const uint64_t value = 1;
+      write(StopEvent, &value, sizeof(value));
+      Acceptors.clear();
+
+      // Workers are busy with sessions until processor stops them. Shutdown also breaks
+      // I/O of processors which ignore StopProcessing or have not started processing yet.
+      for (const std::shared_ptr<SocketChannel>& channel : processing)
+      {
+        try
+        {
+          Processor->StopProcessing(channel);
+        }
+        catch (const std::exception& exc)
+        {
+          std::cerr << "Failed to stop processing of connection. " << exc.what() << std::endl;
+        }
+        shutdown(channel->GetSocket(), SHUT_RDWR);
+      }
+      processing.clear();
+
+      // Acceptors are stopped, nobody starts new workers.
+      Workers.clear();
+      IdleWorkers = 0;
+      StartedWorkers = 0;
+      Queue.clear();
+      Sources.clear();
+      SourceIndex.clear();
+      Processor.reset();
+      CloseSockets();
+    }
+
+    unsigned short ReactorConnectionListener::GetPort() const
+    {
+      return Port;
+    }
+
+    ReactorListenerStatistics ReactorConnectionListener::GetStatistics() const
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      ReactorListenerStatistics result;
+      result.Accepted = Accepted;
+      result.Rejected = Rejected;
+      result.Active = *Active;
+      result.Pending = Queue.size();
+      return result;
+    }
+
+    int ReactorConnectionListener::CreateListenSocket(unsigned short port) const
+    {
+      addrinfo hints;
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags = AI_PASSIVE;
+      addrinfo* addr = nullptr;
+      const std::string service = std::to_string(port);
+      if (int error = getaddrinfo(Params.Host.empty() ? nullptr : Params.Host.c_str(), service.c_str(), &hints, &addr))
+      {
+        THROW_ERROR2(CannotResolveListenAddress, Params.Host, gai_strerror(error));
+      }
+
+      const int sock = socket(addr->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (sock < 0)
+      {
+        freeaddrinfo(addr);
+        THROW_OS_ERROR("Unable to create listen socket.");
+      }
+
+      const int on = 1;
+      setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0 && Params.AcceptorThreads > 1)
+      {
+        const int error = errno;
+        freeaddrinfo(addr);
+        close(sock);
+        errno = error;
+        THROW_OS_ERROR("Unable to share listen port between threads.");
+      }
+
+      const int bound = bind(sock, addr->ai_addr, addr->ai_addrlen);
+      freeaddrinfo(addr);
+      if (bound < 0 || listen(sock, Params.Backlog) < 0)
+      {
+        const int error = errno;
+        close(sock);
+        errno = error;
+        THROW_OS_ERROR("Unable to listen port.");
+      }
+      return sock;
+    }
+
+    void ReactorConnectionListener::Accept(int listenSocket)
+    {
+      const int epoll = epoll_create1(EPOLL_CLOEXEC);
+      if (epoll < 0)
+      {
+        std::cerr << "Unable to create epoll instance. " << strerror(errno) << std::endl;
+        return;
+      }
+
+      epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.fd = listenSocket;
+      epoll_ctl(epoll, EPOLL_CTL_ADD, listenSocket, &event);
+      event.data.fd = StopEvent;
+      epoll_ctl(epoll, EPOLL_CTL_ADD, StopEvent, &event);
+
+      bool stopped = false;
+      while (!stopped)
+      {
+        epoll_event events[2];
+        const int count = epoll_wait(epoll, events, 2, -1);
+        if (count < 0 && errno != EINTR)
+        {
+          std::cerr << "Failed to wait for incoming connections. " << strerror(errno) << std::endl;
+          break;
+        }
+
+        for (int i = 0; i < count && !stopped; ++i)
+        {
+          if (events[i].data.fd == StopEvent)
+          {
+            stopped = true;
+            break;
+          }
+
+          // Take every pending connection with one wakeup.
+          while (true)
+          {
+            sockaddr_storage addr;
+            socklen_t addrLen = sizeof(addr);
+            const int sock = accept4(listenSocket, reinterpret_cast<sockaddr*>(&addr), &addrLen, SOCK_CLOEXEC);
+            if (sock >= 0)
+            {
+              if (!Admit(sock, addr))
+              {
+                stopped = true;
+                break;
+              }
+              continue;
+            }
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO)
+            {
+              continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+              break;
+            }
+            std::cerr << "Failed to accept connection. " << strerror(errno) << std::endl;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+              // Connection stays in backlog, do not spin while descriptors are exhausted.
+              std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            break;
+          }
+        }
+      }
+      close(epoll);
+    }
+
+    void ReactorConnectionListener::Work()
+    {
+      // Worker is counted as idle by the thread which starts it.
+      std::unique_lock<std::mutex> lock(Mutex);
+      while (true)
+      {
+        QueueChanged.wait(lock, [this]() { return Stopping || !Queue.empty(); });
+        if (Stopping)
+        {
+          return;
+        }
+        --IdleWorkers;
+        std::shared_ptr<SocketChannel> channel = Queue.front();
+        Queue.pop_front();
+        Processing.insert(channel);
+        lock.unlock();
+
+        try
+        {
+          Processor->Process(channel);
+        }
+        catch (const std::exception& exc)
+        {
+          std::cerr << "Failed to process incoming connection. " << exc.what() << std::endl;
+        }
+
+        lock.lock();
+        Processing.erase(channel);
+        ++IdleWorkers;
+      }
+    }
+
+    void ReactorConnectionListener::StartWorker()
+    {
+      // Thread is created without the lock, workers already started keep taking connections meanwhile.
+      Common::Thread::UniquePtr worker = Common::Thread::Create(std::bind(&ReactorConnectionListener::Work, this));
+      std::lock_guard<std::mutex> lock(Mutex);
+      Workers.push_back(std::move(worker));
+    }
+
+    bool ReactorConnectionListener::Admit(int sock, const sockaddr_storage& addr)
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+      if (Stopping)
+      {
+        close(sock);
+        return false;
+      }
+
+      const bool tooManyChannels = Params.MaxChannels && *Active >= Params.MaxChannels;
+      const bool queueFull = Queue.size() >= Params.MaxPendingConnections;
+      if (tooManyChannels || queueFull || IsRateExceeded(addr))
+      {
+        ++Rejected;
+        lock.unlock();
+        Reject(sock);
+        return true;
+      }
+
+      ++Accepted;
+      ++*Active;
+      std::shared_ptr<std::atomic<std::size_t>> active = Active;
+      Queue.push_back(std::shared_ptr<SocketChannel>(new SocketChannel(sock), [active](SocketChannel* channel)
+      {
+        delete channel;
+        --*active;
+      }));
+      // Every worker may be blocked in a session, connection must not wait for one of them.
+      // Above the limit of workers connections wait in the queue for sessions to end.
+      const bool startWorker = IdleWorkers < Queue.size() && StartedWorkers < Params.MaxWorkerThreads;
+      if (startWorker)
+      {
+        ++IdleWorkers;
+        ++StartedWorkers;
+      }
+      lock.unlock();
+      QueueChanged.notify_one();
+      if (startWorker)
+      {
+        StartWorker();
+      }
+      return true;
+    }
+
+    bool ReactorConnectionListener::IsRateExceeded(const sockaddr_storage& addr)
+    {
+      if (!Params.MaxConnectionsPerSecond || (addr.ss_family != AF_INET && addr.ss_family != AF_INET6))
+      {
+        return false;
+      }
+
+      // IPv6 clients get whole /64 networks, so they are limited by network prefix.
+      // IPv4 clients of dual stack sockets come as ::ffff:a.b.c.d and are limited by their IPv4 address.
+      std::string source;
+      if (addr.ss_family == AF_INET)
+      {
+        source.assign(reinterpret_cast<const char*>(&reinterpret_cast<const sockaddr_in&>(addr).sin_addr), sizeof(in_addr));
+      }
+      else
+      {
+        const in6_addr& addr6 = reinterpret_cast<const sockaddr_in6&>(addr).sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(&addr6))
+        {
+          source.assign(reinterpret_cast<const char*>(addr6.s6_addr) + sizeof(in6_addr) - sizeof(in_addr), sizeof(in_addr));
+        }
+        else
+        {
+          source.assign(reinterpret_cast<const char*>(addr6.s6_addr), sizeof(in6_addr) / 2);
+        }
+      }
+      const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      const double rate = Params.MaxConnectionsPerSecond;
+
+      // Token bucket refilled with rate tokens per second.
+      auto indexIt = SourceIndex.find(source);
+      if (indexIt != SourceIndex.end())
+      {
+        Sources.splice(Sources.begin(), Sources, indexIt->second);
+      }
+      else
+      {
+        if (Sources.size() >= MaxTrackedSources)
+        {
+          SourceIndex.erase(Sources.back().Source);
+          Sources.pop_back();
+        }
+        SourceRate bucket;
+        bucket.Source = source;
+        bucket.Tokens = rate;
+        bucket.Updated = now;
+        Sources.push_front(bucket);
+        SourceIndex[source] = Sources.begin();
+      }
+      SourceRate& bucket = Sources.front();
+      const double elapsed = std::chrono::duration<double>(now - bucket.Updated).count();
+      bucket.Tokens = std::min(rate, bucket.Tokens + elapsed * rate);
+      bucket.Updated = now;
+      if (bucket.Tokens < 1)
+      {
+        return true;
+      }
+      bucket.Tokens -= 1;
+      return false;
+    }
+
+    void ReactorConnectionListener::CloseSockets()
+    {
+      for (int sock : ListenSockets)
+      {
+        close(sock);
+      }
+      ListenSockets.clear();
+      if (StopEvent >= 0)
+      {
+        close(StopEvent);
+        StopEvent = -1;
+      }
+    }
+
+  } // namespace UaServer
+} // namespace OpcUa
@@ -0,0 +1,238 @@
+/// @brief Periodic sampling of monitored items.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/sampling_engine.h>
+
+namespace OpcUa
+{
+
+  SamplingEngine::SamplingEngine(Remote::Server::SharedPtr server, Common::TimerWheel& timers, SamplingSink::SharedPtr sink, std::size_t maxItemsPerRequest)
+    : Server(server)
+    , Timers(timers)
+    , Sink(sink)
+    , MaxItemsPerRequest(maxItemsPerRequest)
+    , Statistics(new Counters)
+    , Mutex(new std::mutex)
+    , LastID(0)
+  {
+    Statistics->Samples = 0;
+    Statistics->Changes = 0;
+    Statistics->Overruns = 0;
+  }
+
+  SamplingEngine::~SamplingEngine()
+  {
+    // Running samplings keep their buckets alive until they finish.
+    std::vector<Common::TimerID> timers;
+    {
+      std::lock_guard<std::mutex> lock(*Mutex);
+      for (const auto& bucket : Buckets)
+      {
+        timers.push_back(bucket.second->Timer);
+      }
+    }
+    for (Common::TimerID timer : timers)
+    {
+      Timers.Cancel(timer);
+    }
+  }
+
+  SampledItemID SamplingEngine::Add(IntegerID subscriptionId, IntegerID clientHandle, const AttributeValueID& attribute, std::chrono::milliseconds interval, const DeadbandFilter& filter)
+  {
+    std::lock_guard<std::mutex> lock(*Mutex);
+    std::shared_ptr<Bucket>& bucket = Buckets[interval.count()];
+    if (!bucket)
+    {
+      bucket.reset(new Bucket);
+      bucket->Mutex = Mutex;
+      bucket->Server = Server;
+      bucket->Sink = Sink;
+      bucket->MaxItemsPerRequest = MaxItemsPerRequest;
+      bucket->Statistics = Statistics;
+      std::weak_ptr<Bucket> weakBucket = bucket;
+      bucket->Timer = Timers.SchedulePeriodic(interval, [weakBucket]()
+      {
+        if (std::shared_ptr<Bucket> bucket = weakBucket.lock())
+        {
+          Sample(*bucket, false);
+        }
+      });
+    }
+
+    const SampledItemID id = ++LastID;
+    Location location;
+    location.Interval = interval.count();
+    location.Index = bucket->Ids.size();
+    Locations[id] = location;
+
+    bucket->Items.Request.AttributesToRead.push_back(attribute);
+    bucket->Items.Subscriptions.push_back(subscriptionId);
+    bucket->Items.ClientHandles.push_back(clientHandle);
+    bucket->Ids.push_back(id);
+    bucket->Snapshot.reset();
+
+    DetectorChange change;
+    change.Removed = false;
+    change.Index = location.Index;
+    change.Filter = filter;
+    bucket->DetectorChanges.push_back(change);
+    return id;
+  }
+
+  bool SamplingEngine::Remove(SampledItemID id)
+  {
+    std::unique_lock<std::mutex> lock(*Mutex);
+    auto locationIt = Locations.find(id);
+    if (locationIt == Locations.end())
+    {
+      return false;
+    }
+
+    const Location location = locationIt->second;
+    Locations.erase(locationIt);
+    auto bucketIt = Buckets.find(location.Interval);
+    Bucket& bucket = *bucketIt->second;
+    BucketItems& items = bucket.Items;
+
+    // Move the last item to the free place, arrays stay dense.
+    const std::size_t last = bucket.Ids.size() - 1;
+    if (location.Index != last)
+    {
+      items.Request.AttributesToRead[location.Index] = items.Request.AttributesToRead[last];
+      items.Subscriptions[location.Index] = items.Subscriptions[last];
+      items.ClientHandles[location.Index] = items.ClientHandles[last];
+      bucket.Ids[location.Index] = bucket.Ids[last];
+      Locations[bucket.Ids[location.Index]].Index = location.Index;
+    }
+    items.Request.AttributesToRead.pop_back();
+    items.Subscriptions.pop_back();
+    items.ClientHandles.pop_back();
+    bucket.Ids.pop_back();
+    bucket.Snapshot.reset();
+
+    DetectorChange change;
+    change.Removed = true;
+    change.Index = location.Index;
+    bucket.DetectorChanges.push_back(change);
+
+    if (bucket.Ids.empty())
+    {
+      const Common::TimerID timer = bucket.Timer;
+      Buckets.erase(bucketIt);
+      lock.unlock();
+      Timers.Cancel(timer);
+    }
+    return true;
+  }
+
+  std::size_t SamplingEngine::Size() const
+  {
+    std::lock_guard<std::mutex> lock(*Mutex);
+    return Locations.size();
+  }
+
+  void SamplingEngine::Sample(std::chrono::milliseconds interval)
+  {
+    std::shared_ptr<Bucket> bucket;
+    {
+      std::lock_guard<std::mutex> lock(*Mutex);
+      auto bucketIt = Buckets.find(interval.count());
+      if (bucketIt == Buckets.end())
+      {
+        return;
+      }
+      bucket = bucketIt->second;
+    }
+    Sample(*bucket, true);
+  }
+
+  SamplingStatistics SamplingEngine::GetStatistics() const
+  {
+    SamplingStatistics result;
+    result.Samples = Statistics->Samples;
+    result.Changes = Statistics->Changes;
+    result.Overruns = Statistics->Overruns;
+    return result;
+  }
+
+  void SamplingEngine::Sample(Bucket& bucket, bool wait)
+  {
+    std::unique_lock<std::mutex> sampling(bucket.SamplingMutex, std::defer_lock);
+    if (wait)
+    {
+      sampling.lock();
+    }
+    else if (!sampling.try_lock())
+    {
+      // Previous tick is still reading, skip this one instead of queueing ticks.
+      ++bucket.Statistics->Overruns;
+      return;
+    }
+
+    // Items are copied only after they changed, the engine lock is not held while server and sink are called.
+    std::shared_ptr<const BucketItems> items;
+    {
+      std::lock_guard<std::mutex> lock(*bucket.Mutex);
+      if (!bucket.Snapshot)
+      {
+        bucket.Snapshot.reset(new BucketItems(bucket.Items));
+      }
+      items = bucket.Snapshot;
+
+      // Detector follows items in the same order they were added and removed, so it matches the copy.
+      for (const DetectorChange& change : bucket.DetectorChanges)
+      {
+        if (change.Removed)
+        {
+          bucket.Detector.Remove(change.Index);
+        }
+        else
+        {
+          bucket.Detector.Add(change.Filter);
+        }
+      }
+      bucket.DetectorChanges.clear();
+    }
+
+    const std::size_t size = items->Request.AttributesToRead.size();
+    if (!size)
+    {
+      return;
+    }
+
+    std::vector<DataValue> values = bucket.MaxItemsPerRequest && bucket.MaxItemsPerRequest < size
+      ? ReadAttributes(bucket.Server, items->Request.AttributesToRead, bucket.MaxItemsPerRequest)
+      : bucket.Server->Attributes()->Read(items->Request);
+    // Items the server did not answer for keep their last values.
+    bucket.Detector.Detect(values, bucket.Changed);
+
+    std::vector<SampledChange> changes;
+    for (std::size_t word = 0; word < bucket.Changed.size(); ++word)
+    {
+      for (uint64_t bits = bucket.Changed[word]; bits; bits &= bits - 1)
+      {
+        const std::size_t i = word * 64 + __builtin_ctzll(bits);
+        SampledChange change;
+        change.SubscriptionID = items->Subscriptions[i];
+        change.Item.ClientHandle = items->ClientHandles[i];
+        change.Item.Value = values[i];
+        changes.push_back(change);
+      }
+    }
+
+    ++bucket.Statistics->Samples;
+    bucket.Statistics->Changes += changes.size();
+
+    // Sink is called under the sampling lock so changes of an item are never reordered.
+    if (!changes.empty())
+    {
+      bucket.Sink->OnDataChange(changes);
+    }
+  }
+
+} // namespace OpcUa
@@ -11,16 +11,31 @@
 #include <opc/ua/socket_channel.h>
 #include <opc/ua/errors.h>
 
+#include <algorithm>
+#include <cmath>
 #include <errno.h>
+#include <fcntl.h>
 #include <iostream>
+#include <limits.h>
+#include <poll.h>
 #include <stdexcept>
 #include <string.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 
 OpcUa::SocketChannel::SocketChannel(int sock)
   : Socket(sock)
+  , NonBlocking(false)
+  , State(std::make_shared<SendState>(this))
+  , HasPending(false)
+  , Batching(false)
+  , MaxBuffered(0)
+  , MaxDelay(0)
+  , Timers(nullptr)
+  , FlushTimer(0)
 {
   if (Socket < 0)
   {
@@ -30,6 +45,24 @@ OpcUa::SocketChannel::SocketChannel(int sock)
 
 OpcUa::SocketChannel::~SocketChannel()
 {
+  {
+    std::lock_guard<std::mutex> lock(State->Mutex);
+    try
+    {
+      FlushLocked();
+    }
+    catch (const std::exception& exc)
+    {
+      std::cerr << "Failed to send buffered data. " << exc.what() << std::endl;
+    }
+    // Flush timer which already started waits for the lock and then finds no channel.
+    State->Channel = nullptr;
+  }
+  if (Timers && FlushTimer)
+  {
+    Timers->Cancel(FlushTimer);
+  }
+
   int error = close(Socket);
   if (error < 0)
   {
@@ -39,38 +72,430 @@ OpcUa::SocketChannel::~SocketChannel()
 
 std::size_t OpcUa::SocketChannel::Receive(char* data, std::size_t size)
 {
-  int received = recv(Socket, data, size, MSG_WAITALL);
-  if (received < 0)
+  FlushBeforeReceive();
+  std::size_t total = 0;
+  while (total < size)
   {
-    THROW_OS_ERROR("Failed to receive data from host.");
+    int received = recv(Socket, data + total, size - total, NonBlocking ? 0 : MSG_WAITALL);
+    if (received < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        WaitFor(POLLIN);
+        continue;
+      }
+      THROW_OS_ERROR("Failed to receive data from host.");
+    }
+    if (received == 0)
+    {
+      THROW_OS_ERROR("Connection was closed by host.");
+    }
+    total += received;
   }
-  if (received == 0)
+  return size;
+}
+
+std::size_t OpcUa::SocketChannel::ReceiveSome(char* data, std::size_t size)
+{
+  FlushBeforeReceive();
+  while (true)
   {
-    THROW_OS_ERROR("Connection was closed by host.");
+    int received = recv(Socket, data, size, 0);
+    if (received < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        WaitFor(POLLIN);
+        continue;
+      }
+      THROW_OS_ERROR("Failed to receive data from host.");
+    }
+    if (received == 0)
+    {
+      THROW_OS_ERROR("Connection was closed by host.");
+    }
+    return received;
   }
-  return (std::size_t)size;
 }
 
 void OpcUa::SocketChannel::Send(const char* message, std::size_t size)
 {
-  int sent = send(Socket, message, size, 0);
-  if (sent != (int)size)
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  SendLocked(message, size);
+}
+
+void OpcUa::SocketChannel::SendLocked(const char* message, std::size_t size)
+{
+  if (Batching && Pending.size() + size <= MaxBuffered)
+  {
+    if (Pending.empty())
+    {
+      FirstPendingTime = std::chrono::steady_clock::now();
+      ScheduleFlushLocked();
+    }
+    Pending.insert(Pending.end(), message, message + size);
+    HasPending = true;
+    FlushExpiredLocked();
+    return;
+  }
+
+  iovec buffer;
+  buffer.iov_base = const_cast<char*>(message);
+  buffer.iov_len = size;
+  SendVLocked(&buffer, 1);
+}
+
+void OpcUa::SocketChannel::SendFile(int fd, off_t offset, std::size_t count)
+{
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  FlushLocked();
+  while (count)
+  {
+    ssize_t sent = sendfile(Socket, fd, &offset, count);
+    if (sent < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        WaitFor(POLLOUT);
+        continue;
+      }
+      THROW_OS_ERROR("Unable to send file to the host.");
+    }
+    if (sent == 0)
+    {
+      THROW_OS_ERROR("Unexpected end of file.");
+    }
+    count -= sent;
+  }
+}
+
+void OpcUa::SocketChannel::SendMapped(const char* data, std::size_t size)
+{
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  FlushLocked();
+
+  int pipes[2] = {-1, -1};
+  if (pipe(pipes) < 0)
+  {
+    SendLocked(data, size);
+    return;
+  }
+
+  std::size_t total = 0;
+  try
+  {
+    while (total < size)
+    {
+      iovec buffer;
+      buffer.iov_base = const_cast<char*>(data + total);
+      // Not more than default pipe capacity, so vmsplice never waits for a reader.
+      buffer.iov_len = std::min<std::size_t>(size - total, 64 * 1024);
+      ssize_t mapped = vmsplice(pipes[1], &buffer, 1, 0);
+      if (mapped < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        if (errno == EINVAL || errno == ENOSYS)
+        {
+          break;
+        }
+        THROW_OS_ERROR("Unable to map data into pipe.");
+      }
+
+      ssize_t rest = mapped;
+      while (rest > 0)
+      {
+        ssize_t sent = splice(pipes[0], NULL, Socket, NULL, rest, SPLICE_F_MOVE);
+        if (sent < 0)
+        {
+          if (errno == EINTR)
+          {
+            continue;
+          }
+          if (errno == EAGAIN)
+          {
+            WaitFor(POLLOUT);
+            continue;
+          }
+          THROW_OS_ERROR("Unable to send data to the host.");
+        }
+        rest -= sent;
+      }
+      total += mapped;
+    }
+  }
+  catch (...)
+  {
+    close(pipes[0]);
+    close(pipes[1]);
+    throw;
+  }
+  close(pipes[0]);
+  close(pipes[1]);
+
+  // Splicing is not supported, rest of data is copied as usual.
+  if (total < size)
+  {
+    SendLocked(data + total, size - total);
+  }
+}
+
+void OpcUa::SocketChannel::EnableWriteBatching(std::size_t maxBuffered, float maxDelay)
+{
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  Batching = true;
+  MaxBuffered = maxBuffered;
+  MaxDelay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(maxDelay));
+  Pending.reserve(maxBuffered);
+}
+
+void OpcUa::SocketChannel::EnableWriteBatching(std::size_t maxBuffered, float maxDelay, Common::TimerWheel& timers)
+{
+  EnableWriteBatching(maxBuffered, maxDelay);
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  Timers = &timers;
+}
+
+void OpcUa::SocketChannel::DisableWriteBatching()
+{
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  FlushLocked();
+  Batching = false;
+}
+
+void OpcUa::SocketChannel::Flush()
+{
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  FlushLocked();
+}
+
+void OpcUa::SocketChannel::FlushExpiredLocked()
+{
+  if (!Pending.empty() && MaxDelay.count() && std::chrono::steady_clock::now() - FirstPendingTime >= MaxDelay)
   {
-    THROW_OS_ERROR("unable to send data to the host. ");
+    FlushLocked();
   }
 }
 
+void OpcUa::SocketChannel::ScheduleFlushLocked()
+{
+  if (!Timers || !MaxDelay.count())
+  {
+    return;
+  }
+
+  // Timers of already sent batches are not cancelled, they find data younger than the delay
+  // and leave it to the timer of its own batch.
+  const std::shared_ptr<SendState> state = State;
+  const std::chrono::milliseconds delay = std::chrono::duration_cast<std::chrono::milliseconds>(MaxDelay) + std::chrono::milliseconds(1);
+  FlushTimer = Timers->Schedule(delay, [state]()
+  {
+    std::lock_guard<std::mutex> lock(state->Mutex);
+    if (state->Channel)
+    {
+      state->Channel->FlushExpiredLocked();
+    }
+  });
+}
+
+void OpcUa::SocketChannel::FlushLocked()
+{
+  if (Pending.empty())
+  {
+    return;
+  }
+
+  std::vector<iovec> buffers(1);
+  buffers[0].iov_base = &Pending[0];
+  buffers[0].iov_len = Pending.size();
+  SendAll(buffers);
+  Pending.clear();
+  HasPending = false;
+}
+
+void OpcUa::SocketChannel::FlushBeforeReceive()
+{
+  // Receiving does not take the send lock without buffered data, a send blocked
+  // by a full socket buffer must not stop reading of the data the peer waits for.
+  if (HasPending)
+  {
+    Flush();
+  }
+}
+
+namespace
+{
+  // Skip bytes already processed by a vectored call.
+  void Advance(std::vector<iovec>& buffers, std::size_t& first, std::size_t bytes)
+  {
+    while (bytes && first < buffers.size())
+    {
+      if (bytes < buffers[first].iov_len)
+      {
+        buffers[first].iov_base = static_cast<char*>(buffers[first].iov_base) + bytes;
+        buffers[first].iov_len -= bytes;
+        return;
+      }
+      bytes -= buffers[first].iov_len;
+      ++first;
+    }
+    // Skip empty buffers so loops end as soon as everything is processed.
+    while (first < buffers.size() && buffers[first].iov_len == 0)
+    {
+      ++first;
+    }
+  }
+}
+
+void OpcUa::SocketChannel::SendV(const iovec* buffers, std::size_t count)
+{
+  std::lock_guard<std::mutex> lock(State->Mutex);
+  SendVLocked(buffers, count);
+}
+
+void OpcUa::SocketChannel::SendVLocked(const iovec* buffers, std::size_t count)
+{
+  std::vector<iovec> rest;
+  rest.reserve(count + 1);
+  // Buffered messages go first in the same syscall.
+  if (!Pending.empty())
+  {
+    iovec pending;
+    pending.iov_base = &Pending[0];
+    pending.iov_len = Pending.size();
+    rest.push_back(pending);
+  }
+  rest.insert(rest.end(), buffers, buffers + count);
+  SendAll(rest);
+  Pending.clear();
+  HasPending = false;
+}
+
+void OpcUa::SocketChannel::SendAll(std::vector<iovec>& rest)
+{
+  std::size_t first = 0;
+  Advance(rest, first, 0);
+  while (first < rest.size())
+  {
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &rest[first];
+    message.msg_iovlen = std::min<std::size_t>(rest.size() - first, IOV_MAX);
+    ssize_t sent = sendmsg(Socket, &message, 0);
+    if (sent < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        WaitFor(POLLOUT);
+        continue;
+      }
+      THROW_OS_ERROR("unable to send data to the host. ");
+    }
+    Advance(rest, first, sent);
+  }
+}
+
+std::size_t OpcUa::SocketChannel::ReceiveV(const iovec* buffers, std::size_t count)
+{
+  FlushBeforeReceive();
+  std::vector<iovec> rest(buffers, buffers + count);
+  std::size_t first = 0;
+  std::size_t total = 0;
+  Advance(rest, first, 0);
+  while (first < rest.size())
+  {
+    ssize_t received = readv(Socket, &rest[first], std::min<std::size_t>(rest.size() - first, IOV_MAX));
+    if (received < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        WaitFor(POLLIN);
+        continue;
+      }
+      THROW_OS_ERROR("Failed to receive data from host.");
+    }
+    if (received == 0)
+    {
+      THROW_OS_ERROR("Connection was closed by host.");
+    }
+    total += received;
+    Advance(rest, first, received);
+  }
+  return total;
+}
+
 //Return 1 id data, 0 if timeout and <0 if error
 int OpcUa::SocketChannel::WaitForData(float second)
 {
-    fd_set          readSet;
-    struct timeval  timeout;
-    timeout.tv_sec = 0; 
-    timeout.tv_usec = second*1000000; 
+  FlushBeforeReceive();
+
+  // poll() has no FD_SETSIZE limit unlike select().
+  pollfd fd;
+  fd.fd = Socket;
+  fd.events = POLLIN;
+  fd.revents = 0;
+  // Timeout is rounded up, truncation would turn waits shorter than 1 ms into busy polling.
+  return poll(&fd, 1, second < 0 ? -1 : static_cast<int>(std::ceil(second * 1000)));
+}
+
+int OpcUa::SocketChannel::GetSocket() const
+{
+  return Socket;
+}
 
-    FD_ZERO(&readSet);
-    //FD_SET((unsigned int) Socket, &readSet);
-    FD_SET(Socket, &readSet);
+void OpcUa::SocketChannel::SetNonBlocking(bool nonBlocking)
+{
+  int flags = fcntl(Socket, F_GETFL, 0);
+  if (flags < 0)
+  {
+    THROW_OS_ERROR("Unable to get socket flags.");
+  }
+  flags = nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+  if (fcntl(Socket, F_SETFL, flags) < 0)
+  {
+    THROW_OS_ERROR("Unable to set socket flags.");
+  }
+  NonBlocking = nonBlocking;
+}
 
-    return select(Socket+1, &readSet, NULL, NULL, &timeout);
+bool OpcUa::SocketChannel::IsNonBlocking() const
+{
+  return NonBlocking;
+}
+
+void OpcUa::SocketChannel::WaitFor(short events)
+{
+  pollfd fd;
+  fd.fd = Socket;
+  fd.events = events;
+  fd.revents = 0;
+  while (poll(&fd, 1, -1) < 0)
+  {
+    if (errno != EINTR)
+    {
+      THROW_OS_ERROR("Failed to wait for socket.");
+    }
+  }
 }
@@ -0,0 +1,519 @@
+/// @brief Channel based on Linux io_uring.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/uring_channel.h>
+#include <opc/ua/errors.h>
+#include <opc/ua/socket_channel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+  template <typename T>
+  T* Offset(void* base, uint32_t offset)
+  {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+  }
+
+  unsigned LoadAcquire(const unsigned* value)
+  {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+  }
+
+  void StoreRelease(unsigned* value, unsigned newValue)
+  {
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+  }
+
+}
+
+namespace OpcUa
+{
+
+  struct Uring::Operation
+  {
+    Callback Completed;
+  };
+
+  Uring::Uring(unsigned entries)
+    : Ring(-1)
+    , SqRing(MAP_FAILED)
+    , SqRingSize(0)
+    , CqRing(MAP_FAILED)
+    , CqRingSize(0)
+    , Sqes(nullptr)
+    , SqesSize(0)
+    , Unsubmitted(0)
+  {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    Ring = syscall(__NR_io_uring_setup, entries, &params);
+    if (Ring < 0)
+    {
+      THROW_OS_ERROR("Unable to create io_uring.");
+    }
+
+    SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap)
+    {
+      SqRingSize = CqRingSize = std::max(SqRingSize, CqRingSize);
+    }
+
+    SqRing = mmap(nullptr, SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQ_RING);
+    CqRing = singleMap ? SqRing : mmap(nullptr, CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_CQ_RING);
+    SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQES);
+    if (SqRing == MAP_FAILED || CqRing == MAP_FAILED || sqes == MAP_FAILED)
+    {
+      const int error = errno;
+      if (sqes != MAP_FAILED)
+      {
+        munmap(sqes, SqesSize);
+      }
+      Unmap();
+      close(Ring);
+      errno = error;
+      THROW_OS_ERROR("Unable to map io_uring.");
+    }
+    Sqes = static_cast<io_uring_sqe*>(sqes);
+
+    SqHead = Offset<unsigned>(SqRing, params.sq_off.head);
+    SqTail = Offset<unsigned>(SqRing, params.sq_off.tail);
+    SqMask = Offset<unsigned>(SqRing, params.sq_off.ring_mask);
+    SqArray = Offset<unsigned>(SqRing, params.sq_off.array);
+    SqEntries = params.sq_entries;
+    CqHead = Offset<unsigned>(CqRing, params.cq_off.head);
+    CqTail = Offset<unsigned>(CqRing, params.cq_off.tail);
+    CqMask = Offset<unsigned>(CqRing, params.cq_off.ring_mask);
+    Cqes = Offset<io_uring_cqe>(CqRing, params.cq_off.cqes);
+
+    Reaper = std::thread([this]()
+    {
+      Reap();
+    });
+  }
+
+  Uring::~Uring()
+  {
+    // Operation without owner stops completion thread.
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+      io_uring_sqe* sqe = NextSqe(lock);
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = 0;
+      PushSqe();
+      SubmitQueued(lock);
+    }
+    Reaper.join();
+
+    // Kernel cancels operations in flight when ring is closed.
+    munmap(Sqes, SqesSize);
+    Unmap();
+    if (close(Ring) < 0)
+    {
+      std::cerr << "Failed to close io_uring. " << strerror(errno) << std::endl;
+    }
+    for (Operation* operation : Operations)
+    {
+      std::unique_ptr<Operation> owned(operation);
+      owned->Completed(-ECANCELED);
+    }
+  }
+
+  Uring::SharedPtr Uring::TryCreate(unsigned entries)
+  {
+    try
+    {
+      return Uring::SharedPtr(new Uring(entries));
+    }
+    catch (const std::exception&)
+    {
+      return Uring::SharedPtr();
+    }
+  }
+
+  void Uring::QueueReceive(int sock, char* data, std::size_t size, int flags, Callback callback)
+  {
+    Queue(IORING_OP_RECV, sock, data, size, flags, callback);
+  }
+
+  void Uring::QueueSend(int sock, const char* data, std::size_t size, int flags, Callback callback)
+  {
+    Queue(IORING_OP_SEND, sock, data, size, flags, callback);
+  }
+
+  void Uring::QueuePoll(int sock, short events, Callback callback)
+  {
+    Queue(IORING_OP_POLL_ADD, sock, nullptr, 0, events, callback);
+  }
+
+  unsigned Uring::Submit()
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    return SubmitQueued(lock);
+  }
+
+  int Uring::Receive(int sock, char* data, std::size_t size, int flags)
+  {
+    return Execute(IORING_OP_RECV, sock, data, size, flags);
+  }
+
+  int Uring::Send(int sock, const char* data, std::size_t size, int flags)
+  {
+    return Execute(IORING_OP_SEND, sock, data, size, flags);
+  }
+
+  int Uring::Poll(int sock, short events)
+  {
+    return Execute(IORING_OP_POLL_ADD, sock, nullptr, 0, events);
+  }
+
+  void Uring::Queue(uint8_t opcode, int sock, const char* data, std::size_t size, int flags, Callback callback)
+  {
+    std::unique_ptr<Operation> operation(new Operation);
+    operation->Completed = callback;
+
+    std::unique_lock<std::mutex> lock(Mutex);
+    io_uring_sqe* sqe = NextSqe(lock);
+    sqe->opcode = opcode;
+    sqe->fd = sock;
+    if (opcode == IORING_OP_POLL_ADD)
+    {
+      sqe->poll_events = flags;
+    }
+    else
+    {
+      sqe->addr = reinterpret_cast<uint64_t>(data);
+      sqe->len = size;
+      sqe->msg_flags = flags;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(operation.get());
+    PushSqe();
+    Operations.insert(operation.release());
+  }
+
+  io_uring_sqe* Uring::NextSqe(std::unique_lock<std::mutex>& lock)
+  {
+    // Ring is full, start queued operations to get free entries.
+    while (*SqTail - LoadAcquire(SqHead) >= SqEntries)
+    {
+      SubmitQueued(lock);
+    }
+
+    io_uring_sqe* sqe = &Sqes[*SqTail & *SqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  void Uring::PushSqe()
+  {
+    const unsigned tail = *SqTail;
+    // Entries are used in ring order, so index of entry is its position.
+    SqArray[tail & *SqMask] = tail & *SqMask;
+    StoreRelease(SqTail, tail + 1);
+    ++Unsubmitted;
+  }
+
+  int Uring::Execute(uint8_t opcode, int sock, const char* data, std::size_t size, int flags)
+  {
+    // State is shared with callback, so it stays valid whatever thread completes the operation.
+    struct Result
+    {
+      std::mutex Mutex;
+      std::condition_variable Ready;
+      bool Done;
+      int Value;
+    };
+    std::shared_ptr<Result> result(new Result);
+    result->Done = false;
+    result->Value = 0;
+
+    Queue(opcode, sock, data, size, flags, [result](int value)
+    {
+      std::lock_guard<std::mutex> lock(result->Mutex);
+      result->Value = value;
+      result->Done = true;
+      result->Ready.notify_one();
+    });
+    Submit();
+
+    std::unique_lock<std::mutex> lock(result->Mutex);
+    result->Ready.wait(lock, [&result]()
+    {
+      return result->Done;
+    });
+    return result->Value;
+  }
+
+  unsigned Uring::SubmitQueued(std::unique_lock<std::mutex>& lock)
+  {
+    unsigned submitted = 0;
+    while (Unsubmitted)
+    {
+      const int result = syscall(__NR_io_uring_enter, Ring, Unsubmitted, 0, 0, nullptr, 0);
+      if (result >= 0)
+      {
+        Unsubmitted -= result;
+        submitted += result;
+        continue;
+      }
+
+      const int error = errno;
+      if (error == EINTR)
+      {
+        continue;
+      }
+      // Too many operations in flight, wait until completion thread reaps some.
+      if ((error == EAGAIN || error == EBUSY) && Operations.size() > Unsubmitted)
+      {
+        Reaped.wait(lock);
+        continue;
+      }
+
+      // Kernel has not read the rest of the ring, take operations back and fail them.
+      std::vector<Operation*> failed;
+      const unsigned head = LoadAcquire(SqHead);
+      for (unsigned index = head; index != *SqTail; ++index)
+      {
+        Operation* operation = reinterpret_cast<Operation*>(Sqes[SqArray[index & *SqMask]].user_data);
+        if (operation)
+        {
+          Operations.erase(operation);
+          failed.push_back(operation);
+        }
+      }
+      StoreRelease(SqTail, head);
+      Unsubmitted = 0;
+
+      lock.unlock();
+      for (Operation* operation : failed)
+      {
+        std::unique_ptr<Operation> owned(operation);
+        owned->Completed(-error);
+      }
+      lock.lock();
+    }
+    return submitted;
+  }
+
+  void Uring::Reap()
+  {
+    std::vector<std::pair<Operation*, int>> completed;
+    bool stopping = false;
+    while (!stopping)
+    {
+      if (syscall(__NR_io_uring_enter, Ring, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+      {
+        std::cerr << "Failed to wait for io_uring completions. " << strerror(errno) << std::endl;
+        return;
+      }
+
+      completed.clear();
+      {
+        std::lock_guard<std::mutex> lock(Mutex);
+        unsigned head = *CqHead;
+        const unsigned tail = LoadAcquire(CqTail);
+        for (; head != tail; ++head)
+        {
+          const io_uring_cqe& cqe = Cqes[head & *CqMask];
+          Operation* operation = reinterpret_cast<Operation*>(cqe.user_data);
+          if (!operation)
+          {
+            stopping = true;
+            continue;
+          }
+          Operations.erase(operation);
+          completed.push_back(std::make_pair(operation, cqe.res));
+        }
+        StoreRelease(CqHead, head);
+        Reaped.notify_all();
+      }
+
+      // Callbacks run without lock, they can queue new operations.
+      for (const std::pair<Operation*, int>& completion : completed)
+      {
+        std::unique_ptr<Operation> operation(completion.first);
+        try
+        {
+          operation->Completed(completion.second);
+        }
+        catch (const std::exception& exc)
+        {
+          std::cerr << "Callback of io_uring operation failed. " << exc.what() << std::endl;
+        }
+      }
+    }
+  }
+
+  void Uring::Unmap()
+  {
+    if (CqRing != MAP_FAILED && CqRing != SqRing)
+    {
+      munmap(CqRing, CqRingSize);
+    }
+    if (SqRing != MAP_FAILED)
+    {
+      munmap(SqRing, SqRingSize);
+    }
+  }
+
+  UringChannel::UringChannel(int sock, Uring::SharedPtr ring)
+    : Socket(sock)
+    , Ring(ring)
+    , Fallback(false)
+  {
+    if (Socket < 0)
+    {
+      THROW_ERROR(CannotCreateChannelOnInvalidSocket);
+    }
+  }
+
+  UringChannel::~UringChannel()
+  {
+    if (close(Socket) < 0)
+    {
+      std::cerr << "Failed to close socket connection. " << strerror(errno) << std::endl;
+    }
+  }
+
+  std::size_t UringChannel::Receive(char* data, std::size_t size)
+  {
+    std::size_t total = 0;
+    while (total < size)
+    {
+      const bool fallback = Fallback;
+      int received = fallback ? recv(Socket, data + total, size - total, MSG_WAITALL) : Ring->Receive(Socket, data + total, size - total, MSG_WAITALL);
+      if (!fallback && received < 0)
+      {
+        errno = -received;
+        received = -1;
+      }
+      if (received < 0)
+      {
+        // Kernels older than 5.6 reject socket operations in io_uring.
+        if (errno == EINVAL && !fallback)
+        {
+          Fallback = true;
+          continue;
+        }
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+          WaitFor(POLLIN);
+          continue;
+        }
+        THROW_OS_ERROR("Failed to receive data from host.");
+      }
+      if (received == 0)
+      {
+        THROW_OS_ERROR("Connection was closed by host.");
+      }
+      total += received;
+    }
+    return size;
+  }
+
+  void UringChannel::Send(const char* message, std::size_t size)
+  {
+    std::size_t total = 0;
+    while (total < size)
+    {
+      const bool fallback = Fallback;
+      int sent = fallback ? send(Socket, message + total, size - total, 0) : Ring->Send(Socket, message + total, size - total, 0);
+      if (!fallback && sent < 0)
+      {
+        errno = -sent;
+        sent = -1;
+      }
+      if (sent < 0)
+      {
+        if (errno == EINVAL && !fallback)
+        {
+          Fallback = true;
+          continue;
+        }
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+          WaitFor(POLLOUT);
+          continue;
+        }
+        THROW_OS_ERROR("unable to send data to the host. ");
+      }
+      total += sent;
+    }
+  }
+
+  int UringChannel::WaitForData(float second)
+  {
+    pollfd fd;
+    fd.fd = Socket;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    return poll(&fd, 1, second < 0 ? -1 : static_cast<int>(std::ceil(second * 1000)));
+  }
+
+  void UringChannel::WaitFor(short events)
+  {
+    // Non blocking socket is not ready, wait for it instead of spinning on EAGAIN.
+    if (!Fallback)
+    {
+      const int result = Ring->Poll(Socket, events);
+      if (result >= 0 || result == -EINTR)
+      {
+        return;
+      }
+      if (result != -EINVAL)
+      {
+        errno = -result;
+        THROW_OS_ERROR("Failed to wait for socket.");
+      }
+      Fallback = true;
+    }
+
+    pollfd fd;
+    fd.fd = Socket;
+    fd.events = events;
+    fd.revents = 0;
+    if (poll(&fd, 1, -1) < 0 && errno != EINTR)
+    {
+      THROW_OS_ERROR("Failed to wait for socket.");
+    }
+  }
+
+  std::shared_ptr<IOChannel> CreateSocketChannel(int sock, Uring::SharedPtr ring)
+  {
+    if (ring)
+    {
+      return std::shared_ptr<IOChannel>(new UringChannel(sock, ring));
+    }
+    return std::shared_ptr<IOChannel>(new SocketChannel(sock));
+  }
+
+} // namespace OpcUa
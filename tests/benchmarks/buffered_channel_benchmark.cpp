@@ -0,0 +1,104 @@
+/// @brief Benchmark of OpcUa::BufferedChannel against small reads from OpcUa::SocketChannel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+/// Usage: buffered_channel_benchmark [megabytes] [field size] [buffer size]
+///
+/// Reader takes the stream field by field like a binary decoder does.
+/// Raw reads make a recv call per field, buffered reads make one per buffer fill.
+///
+
+#include <opc/ua/buffered_channel.h>
+#include <opc/ua/socket_channel.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+  struct Parameters
+  {
+    std::size_t Bytes;
+    std::size_t FieldSize;
+    std::size_t BufferSize;
+  };
+
+  // Writer sends the whole stream with large sends, so only reading differs between runs.
+  template <typename CreateReader>
+  void Run(const std::string& name, const Parameters& params, CreateReader create)
+  {
+    int fds[2] = {-1, -1};
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+      throw std::runtime_error("Unable to create socket pair.");
+    }
+    std::shared_ptr<OpcUa::SocketChannel> writer(new OpcUa::SocketChannel(fds[0]));
+    std::shared_ptr<OpcUa::SocketChannel> reader(new OpcUa::SocketChannel(fds[1]));
+
+    std::thread writerThread([writer, &params]()
+    {
+      const std::vector<char> block(64 * 1024, 'x');
+      for (std::size_t sent = 0; sent < params.Bytes; sent += block.size())
+      {
+        writer->Send(&block[0], std::min(block.size(), params.Bytes - sent));
+      }
+    });
+
+    std::shared_ptr<OpcUa::IOChannel> channel = create(reader);
+    const std::size_t fields = params.Bytes / params.FieldSize;
+    std::vector<char> field(params.FieldSize);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < fields; ++i)
+    {
+      channel->Receive(&field[0], field.size());
+    }
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+
+    // Rest of the stream which does not make a whole field.
+    std::vector<char> rest(params.Bytes - fields * params.FieldSize + 1);
+    channel->Receive(&rest[0], rest.size() - 1);
+    writerThread.join();
+
+    std::cout << name << ": " << seconds << " s, " << static_cast<uint64_t>(fields / seconds) << " fields/s, "
+              << static_cast<uint64_t>(params.Bytes / seconds / 1024 / 1024) << " MB/s";
+    if (const OpcUa::BufferedChannel* buffered = dynamic_cast<const OpcUa::BufferedChannel*>(channel.get()))
+    {
+      std::cout << ", " << buffered->GetFillCount() << " recv calls";
+    }
+    std::cout << std::endl;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  Parameters params;
+  params.Bytes = static_cast<std::size_t>(argc > 1 ? std::atoi(argv[1]) : 64) * 1024 * 1024;
+  params.FieldSize = argc > 2 ? std::atoi(argv[2]) : 4;
+  params.BufferSize = argc > 3 ? std::atoi(argv[3]) : 64 * 1024;
+  std::cout << params.Bytes / 1024 / 1024 << " MB, " << params.FieldSize << " bytes per field, "
+            << params.BufferSize << " bytes of buffer" << std::endl;
+
+  Run("SocketChannel", params, [](std::shared_ptr<OpcUa::SocketChannel> channel)
+  {
+    return std::shared_ptr<OpcUa::IOChannel>(channel);
+  });
+
+  Run("BufferedChannel", params, [&params](std::shared_ptr<OpcUa::SocketChannel> channel)
+  {
+    return std::shared_ptr<OpcUa::IOChannel>(new OpcUa::BufferedChannel(channel, params.BufferSize));
+  });
+  return 0;
+}
@@ -0,0 +1,156 @@
+/// @brief Benchmark of OpcUa::ChangeDetector against comparing sampled values as Variants.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+/// Usage: change_detector_benchmark [items] [rounds] [percent of changed items]
+///
+/// Items are doubles, 32 and 64 bit integers in turn, like sampled values of one bucket.
+/// Only comparison is timed, preparing the next round of values is not.
+///
+
+#include <opc/ua/change_detector.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+  typedef std::chrono::steady_clock Clock;
+
+  struct Parameters
+  {
+    std::size_t Items;
+    std::size_t Rounds;
+    std::size_t Percent;
+  };
+
+  // The way sampling engine compared values before: status and Variant of every item against the last one.
+  class VariantDetector
+  {
+  public:
+    explicit VariantDetector(std::size_t size)
+      : LastValues(size)
+      , Sampled(size, false)
+    {
+    }
+
+    void Detect(const std::vector<OpcUa::DataValue>& values, std::vector<uint64_t>& changed)
+    {
+      changed.assign((LastValues.size() + 63) / 64, 0);
+      for (std::size_t i = 0; i < values.size(); ++i)
+      {
+        const OpcUa::DataValue& value = values[i];
+        OpcUa::DataValue& last = LastValues[i];
+        if (Sampled[i] && value.Status == last.Status && value.Value == last.Value)
+        {
+          continue;
+        }
+        Sampled[i] = true;
+        last = value;
+        changed[i / 64] |= uint64_t(1) << (i % 64);
+      }
+    }
+
+  private:
+    std::vector<OpcUa::DataValue> LastValues;
+    std::vector<bool> Sampled;
+  };
+
+  class ColumnDetector
+  {
+  public:
+    explicit ColumnDetector(std::size_t size)
+    {
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        Detector.Add();
+      }
+    }
+
+    void Detect(const std::vector<OpcUa::DataValue>& values, std::vector<uint64_t>& changed)
+    {
+      Detector.Detect(values, changed);
+    }
+
+  private:
+    OpcUa::ChangeDetector Detector;
+  };
+
+  OpcUa::DataValue MakeValue(std::size_t item, std::size_t round)
+  {
+    switch (item % 3)
+    {
+      case 0: return OpcUa::DataValue(OpcUa::Variant(static_cast<double>(item) + round * 0.5));
+      case 1: return OpcUa::DataValue(OpcUa::Variant(static_cast<int32_t>(item + round)));
+      default: return OpcUa::DataValue(OpcUa::Variant(static_cast<int64_t>(item + round)));
+    }
+  }
+
+  template <typename Detector>
+  void Run(const std::string& name, const Parameters& params)
+  {
+    Detector detector(params.Items);
+    std::vector<OpcUa::DataValue> values(params.Items);
+    for (std::size_t i = 0; i < params.Items; ++i)
+    {
+      values[i] = MakeValue(i, 0);
+    }
+
+    std::vector<uint64_t> changed;
+    std::size_t changes = 0;
+    Clock::duration spent = Clock::duration::zero();
+    for (std::size_t round = 0; round <= params.Rounds; ++round)
+    {
+      // Round 0 reports every item and is not counted.
+      if (round > 0)
+      {
+        for (std::size_t i = round % 100; i < params.Items; i += 100)
+        {
+          for (std::size_t j = 0; j < params.Percent && i + j < params.Items; ++j)
+          {
+            values[i + j] = MakeValue(i + j, round);
+          }
+        }
+      }
+
+      const Clock::time_point start = Clock::now();
+      detector.Detect(values, changed);
+      if (round > 0)
+      {
+        spent += Clock::now() - start;
+        for (uint64_t word : changed)
+        {
+          changes += __builtin_popcountll(word);
+        }
+      }
+    }
+
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(spent).count();
+    const double items = static_cast<double>(params.Items) * params.Rounds;
+    std::cout << name << ": " << seconds << " s, " << static_cast<uint64_t>(items / seconds) << " items/s, "
+              << changes << " changes" << std::endl;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  Parameters params;
+  params.Items = argc > 1 ? std::atoi(argv[1]) : 100000;
+  params.Rounds = argc > 2 ? std::atoi(argv[2]) : 200;
+  params.Percent = argc > 3 ? std::atoi(argv[3]) : 1;
+  std::cout << params.Items << " items, " << params.Rounds << " rounds, "
+            << params.Percent << "% of items changed per round" << std::endl;
+
+  Run<VariantDetector>("Variant comparison", params);
+  Run<ColumnDetector>("ChangeDetector", params);
+  return 0;
+}
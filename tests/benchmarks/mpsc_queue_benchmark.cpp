@@ -0,0 +1,172 @@
+/// @brief Contention benchmark of Common::MpscQueue against a vector guarded by mutex.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+/// Usage: mpsc_queue_benchmark [producers] [messages per producer] [pause between messages ns]
+///
+/// Producers push timestamps and one consumer takes them like the publishing thread takes
+/// sampled changes. Reported are the time spent in push and the handoff latency
+/// from push to pop.
+///
+
+#include <opc/common/mpsc_queue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+  typedef std::chrono::steady_clock Clock;
+
+  struct Parameters
+  {
+    std::size_t Producers;
+    std::size_t Messages;
+    std::chrono::nanoseconds Pause;
+  };
+
+  // Busy wait is used because sleep is not precise for short pauses.
+  void Wait(std::chrono::nanoseconds pause)
+  {
+    const Clock::time_point end = Clock::now() + pause;
+    while (Clock::now() < end)
+    {
+    }
+  }
+
+  class LockFreeQueue
+  {
+  public:
+    void Push(Clock::time_point value)
+    {
+      Queue.Push(value);
+    }
+
+    void Pop(std::vector<Clock::time_point>& values)
+    {
+      Queue.Pop(values);
+    }
+
+  private:
+    Common::MpscQueue<Clock::time_point> Queue;
+  };
+
+  // The way changes were passed before: producers append under the lock, consumer swaps the vector.
+  class MutexQueue
+  {
+  public:
+    void Push(Clock::time_point value)
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Values.push_back(value);
+    }
+
+    void Pop(std::vector<Clock::time_point>& values)
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      values.swap(Values);
+    }
+
+  private:
+    std::mutex Mutex;
+    std::vector<Clock::time_point> Values;
+  };
+
+  int64_t Percentile(const std::vector<int64_t>& sorted, double percentile)
+  {
+    return sorted.empty() ? 0 : sorted[static_cast<std::size_t>(percentile * (sorted.size() - 1))];
+  }
+
+  template <typename Queue>
+  void Run(const std::string& name, const Parameters& params)
+  {
+    Queue queue;
+    std::atomic<std::size_t> started(0);
+    std::vector<std::vector<int64_t>> pushTimes(params.Producers);
+    std::vector<std::thread> producers;
+    for (std::size_t i = 0; i < params.Producers; ++i)
+    {
+      pushTimes[i].reserve(params.Messages);
+      producers.push_back(std::thread([&queue, &started, &params, &pushTimes, i]()
+      {
+        ++started;
+        while (started < params.Producers)
+        {
+          std::this_thread::yield();
+        }
+        for (std::size_t j = 0; j < params.Messages; ++j)
+        {
+          const Clock::time_point pushed = Clock::now();
+          queue.Push(pushed);
+          pushTimes[i].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - pushed).count());
+          Wait(params.Pause);
+        }
+      }));
+    }
+
+    const std::size_t total = params.Producers * params.Messages;
+    std::vector<int64_t> handoff;
+    handoff.reserve(total);
+    std::vector<Clock::time_point> values;
+    const Clock::time_point start = Clock::now();
+    while (handoff.size() < total)
+    {
+      values.clear();
+      queue.Pop(values);
+      if (values.empty())
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      const Clock::time_point popped = Clock::now();
+      for (const Clock::time_point& pushed : values)
+      {
+        handoff.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(popped - pushed).count());
+      }
+    }
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - start).count();
+    for (std::thread& producer : producers)
+    {
+      producer.join();
+    }
+
+    std::vector<int64_t> push;
+    push.reserve(total);
+    for (const std::vector<int64_t>& times : pushTimes)
+    {
+      push.insert(push.end(), times.begin(), times.end());
+    }
+    std::sort(push.begin(), push.end());
+    std::sort(handoff.begin(), handoff.end());
+    std::cout << name << ": " << static_cast<uint64_t>(total / seconds) << " messages/s, push p50 " << Percentile(push, 0.5)
+              << " ns, p99 " << Percentile(push, 0.99) << " ns, handoff p50 " << Percentile(handoff, 0.5)
+              << " ns, p99 " << Percentile(handoff, 0.99) << " ns" << std::endl;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  Parameters params;
+  params.Producers = argc > 1 ? std::atoi(argv[1]) : 8;
+  params.Messages = argc > 2 ? std::atoi(argv[2]) : 200000;
+  params.Pause = std::chrono::nanoseconds(argc > 3 ? std::atoi(argv[3]) : 1000);
+  std::cout << params.Producers << " producers, " << params.Messages << " messages each, "
+            << params.Pause.count() << " ns between messages" << std::endl;
+
+  Run<MutexQueue>("Mutex and vector", params);
+  Run<LockFreeQueue>("MpscQueue", params);
+  return 0;
+}
@@ -0,0 +1,220 @@
+/// @brief Benchmark of OpcUa::NodeBuilder against Node::AddVariable.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+/// Usage: node_builder_benchmark [variables] [node|builder]
+///
+/// Variables are added to an in-process address space. Without mode both modes
+/// are run in child processes, so peak memory of one does not hide the other.
+///
+
+#include <opc/ua/node.h>
+#include <opc/ua/node_builder.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+  // Minimal address space: attributes and forward references of nodes.
+  class AddressSpace : public OpcUa::Remote::NodeManagementServices
+  {
+  public:
+    AddressSpace()
+      : Calls(0)
+    {
+    }
+
+    virtual std::vector<OpcUa::AddNodesResult> AddNodes(const std::vector<OpcUa::AddNodesItem>& items)
+    {
+      ++Calls;
+      std::vector<OpcUa::AddNodesResult> results;
+      results.reserve(items.size());
+      for (const OpcUa::AddNodesItem& item : items)
+      {
+        Attributes[item.RequestedNewNodeID] = item.Attributes.Attributes;
+
+        OpcUa::ReferenceDescription parent;
+        parent.ReferenceTypeID = item.ReferenceTypeId;
+        parent.IsForward = true;
+        parent.TargetNodeID = item.RequestedNewNodeID;
+        parent.BrowseName = item.BrowseName;
+        parent.TargetNodeClass = item.Class;
+        parent.TargetNodeTypeDefinition = item.TypeDefinition;
+        References.insert(std::make_pair(item.ParentNodeId, parent));
+
+        OpcUa::ReferenceDescription type;
+        type.ReferenceTypeID = OpcUa::ReferenceID::HasTypeDefinition;
+        type.IsForward = true;
+        type.TargetNodeID = item.TypeDefinition;
+        References.insert(std::make_pair(item.RequestedNewNodeID, type));
+
+        OpcUa::AddNodesResult result;
+        result.Status = OpcUa::StatusCode::Good;
+        result.AddedNodeID = item.RequestedNewNodeID;
+        results.push_back(result);
+      }
+      return results;
+    }
+
+    virtual std::vector<OpcUa::StatusCode> AddReferences(const std::vector<OpcUa::AddReferencesItem>& items)
+    {
+      ++Calls;
+      for (const OpcUa::AddReferencesItem& item : items)
+      {
+        OpcUa::ReferenceDescription reference;
+        reference.ReferenceTypeID = item.ReferenceTypeId;
+        reference.IsForward = item.IsForward;
+        reference.TargetNodeID = item.TargetNodeID;
+        reference.TargetNodeClass = item.TargetNodeClass;
+        References.insert(std::make_pair(item.SourceNodeID, reference));
+      }
+      return std::vector<OpcUa::StatusCode>(items.size(), OpcUa::StatusCode::Good);
+    }
+
+    virtual void AddAttribute(const OpcUa::NodeID& node, OpcUa::AttributeID attribute, const OpcUa::Variant& value)
+    {
+      ++Calls;
+      Attributes[node][attribute] = value;
+    }
+
+    virtual void AddReference(const OpcUa::NodeID& sourceNode, const OpcUa::ReferenceDescription& reference)
+    {
+      ++Calls;
+      References.insert(std::make_pair(sourceNode, reference));
+    }
+
+  public:
+    std::size_t Calls;
+    std::map<OpcUa::NodeID, std::map<OpcUa::AttributeID, OpcUa::Variant>> Attributes;
+    std::multimap<OpcUa::NodeID, OpcUa::ReferenceDescription> References;
+  };
+
+  class AddressSpaceServer : public OpcUa::Remote::Server
+  {
+  public:
+    AddressSpaceServer()
+      : AddressSpaceImpl(new AddressSpace)
+    {
+    }
+
+    virtual void CreateSession(const OpcUa::Remote::SessionParameters&) { }
+    virtual void ActivateSession() { }
+    virtual void CloseSession() { }
+
+    virtual OpcUa::Remote::EndpointServices::SharedPtr Endpoints() const
+    {
+      return OpcUa::Remote::EndpointServices::SharedPtr();
+    }
+
+    virtual OpcUa::Remote::ViewServices::SharedPtr Views() const
+    {
+      return OpcUa::Remote::ViewServices::SharedPtr();
+    }
+
+    virtual OpcUa::Remote::NodeManagementServices::SharedPtr NodeManagement() const
+    {
+      return AddressSpaceImpl;
+    }
+
+    virtual OpcUa::Remote::AttributeServices::SharedPtr Attributes() const
+    {
+      return OpcUa::Remote::AttributeServices::SharedPtr();
+    }
+
+    virtual OpcUa::Remote::SubscriptionServices::SharedPtr Subscriptions() const
+    {
+      return OpcUa::Remote::SubscriptionServices::SharedPtr();
+    }
+
+  public:
+    const std::shared_ptr<AddressSpace> AddressSpaceImpl;
+  };
+
+  // Peak resident memory of the process in kilobytes.
+  long PeakMemory()
+  {
+    rusage usage = rusage();
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+  OpcUa::NodeID VariableID(std::size_t index)
+  {
+    return OpcUa::NumericNodeID(static_cast<uint32_t>(index + 1000), 2);
+  }
+
+  OpcUa::QualifiedName VariableName(std::size_t index)
+  {
+    return OpcUa::QualifiedName(2, "variable" + std::to_string(index));
+  }
+
+  void Run(const std::string& mode, std::size_t count)
+  {
+    std::shared_ptr<AddressSpaceServer> server(new AddressSpaceServer);
+    const OpcUa::NodeID folder = OpcUa::NumericNodeID(1, 2);
+    const long memoryBefore = PeakMemory();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (mode == "node")
+    {
+      OpcUa::Node parent(server, folder, OpcUa::QualifiedName(2, "folder"));
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        parent.AddVariable(VariableID(i), VariableName(i), static_cast<double>(i));
+      }
+    }
+    else
+    {
+      OpcUa::NodeBuilder builder(server);
+      builder.Reserve(count);
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        builder.AddVariable(folder, VariableID(i), VariableName(i), static_cast<double>(i));
+      }
+      builder.Commit();
+    }
+
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+    const long memoryAfter = PeakMemory();
+    std::cout << (mode == "node" ? "Node::AddVariable" : "NodeBuilder") << ": " << seconds << " s, "
+              << server->AddressSpaceImpl->Calls << " calls, peak memory " << memoryAfter << " KB (+"
+              << memoryAfter - memoryBefore << " KB)" << std::endl;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  const std::size_t count = argc > 1 ? std::atoi(argv[1]) : 100000;
+  if (argc > 2)
+  {
+    Run(argv[2], count);
+    return 0;
+  }
+
+  std::cout << count << " variables" << std::endl;
+  for (const std::string& mode : {std::string("node"), std::string("builder")})
+  {
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+      Run(mode, count);
+      return 0;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+  }
+  return 0;
+}
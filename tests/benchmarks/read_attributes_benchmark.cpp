@@ -0,0 +1,158 @@
+/// @brief Benchmark of OpcUa::ReadValues against reading nodes one by one.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+/// Usage: read_attributes_benchmark [nodes] [request latency us] [max items per request]
+///
+/// Server is simulated in process: every Read call costs the given latency,
+/// so the result shows how many round trips a cycle of reads needs.
+///
+
+#include <opc/ua/node.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+  // Busy wait is used because sleep is not precise for short latencies.
+  void Wait(std::chrono::microseconds latency)
+  {
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + latency;
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+  }
+
+  class LatencyAttributes : public OpcUa::Remote::AttributeServices
+  {
+  public:
+    explicit LatencyAttributes(std::chrono::microseconds latency)
+      : Latency(latency)
+      , Requests(0)
+    {
+    }
+
+    virtual std::vector<OpcUa::DataValue> Read(const OpcUa::ReadParameters& params) const
+    {
+      ++Requests;
+      Wait(Latency);
+      std::vector<OpcUa::DataValue> values;
+      values.reserve(params.AttributesToRead.size());
+      for (const OpcUa::AttributeValueID& attribute : params.AttributesToRead)
+      {
+        values.push_back(OpcUa::DataValue(static_cast<double>(attribute.Node.GetIntegerIdentifier())));
+      }
+      return values;
+    }
+
+    virtual std::vector<OpcUa::StatusCode> Write(const std::vector<OpcUa::WriteValue>& values)
+    {
+      ++Requests;
+      Wait(Latency);
+      return std::vector<OpcUa::StatusCode>(values.size(), OpcUa::StatusCode::Good);
+    }
+
+  public:
+    const std::chrono::microseconds Latency;
+    mutable std::atomic<std::size_t> Requests;
+  };
+
+  class LatencyServer : public OpcUa::Remote::Server
+  {
+  public:
+    explicit LatencyServer(std::chrono::microseconds latency)
+      : AttributesImpl(new LatencyAttributes(latency))
+    {
+    }
+
+    virtual void CreateSession(const OpcUa::Remote::SessionParameters&) { }
+    virtual void ActivateSession() { }
+    virtual void CloseSession() { }
+
+    virtual OpcUa::Remote::EndpointServices::SharedPtr Endpoints() const
+    {
+      return OpcUa::Remote::EndpointServices::SharedPtr();
+    }
+
+    virtual OpcUa::Remote::ViewServices::SharedPtr Views() const
+    {
+      return OpcUa::Remote::ViewServices::SharedPtr();
+    }
+
+    virtual OpcUa::Remote::NodeManagementServices::SharedPtr NodeManagement() const
+    {
+      return OpcUa::Remote::NodeManagementServices::SharedPtr();
+    }
+
+    virtual OpcUa::Remote::AttributeServices::SharedPtr Attributes() const
+    {
+      return AttributesImpl;
+    }
+
+    virtual OpcUa::Remote::SubscriptionServices::SharedPtr Subscriptions() const
+    {
+      return OpcUa::Remote::SubscriptionServices::SharedPtr();
+    }
+
+  public:
+    const std::shared_ptr<LatencyAttributes> AttributesImpl;
+  };
+
+  template <typename ReadFunction>
+  void Run(const std::string& name, const std::shared_ptr<LatencyServer>& server, const std::vector<OpcUa::Node>& nodes, ReadFunction read)
+  {
+    server->AttributesImpl->Requests = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::size_t count = read();
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+    if (count != nodes.size())
+    {
+      std::cerr << name << ": read " << count << " values of " << nodes.size() << " nodes." << std::endl;
+    }
+    std::cout << name << ": " << seconds << " s, " << server->AttributesImpl->Requests << " requests, "
+              << static_cast<uint64_t>(nodes.size() / seconds) << " values/s" << std::endl;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  const std::size_t count = argc > 1 ? std::atoi(argv[1]) : 40000;
+  const std::chrono::microseconds latency(argc > 2 ? std::atoi(argv[2]) : 50);
+  const std::size_t maxItemsPerRequest = argc > 3 ? std::atoi(argv[3]) : OpcUa::DefaultMaxItemsPerRequest;
+  std::cout << count << " nodes, " << latency.count() << " us per request, " << maxItemsPerRequest << " items per request" << std::endl;
+
+  std::shared_ptr<LatencyServer> server(new LatencyServer(latency));
+  std::vector<OpcUa::Node> nodes;
+  nodes.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    nodes.push_back(OpcUa::Node(server, OpcUa::NumericNodeID(static_cast<uint32_t>(i + 1), 2)));
+  }
+
+  Run("Node::GetValue", server, nodes, [&nodes]()
+  {
+    std::size_t read = 0;
+    for (const OpcUa::Node& node : nodes)
+    {
+      read += node.GetValue().IsNul() ? 0 : 1;
+    }
+    return read;
+  });
+
+  Run("ReadValues", server, nodes, [&server, &nodes, maxItemsPerRequest]()
+  {
+    return OpcUa::ReadValues(server, nodes, maxItemsPerRequest).size();
+  });
+
+  return 0;
+}
@@ -0,0 +1,235 @@
+/// @brief Loopback benchmark of OpcUa::UringChannel against OpcUa::SocketChannel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+/// Usage: uring_channel_benchmark [connections] [round trips] [message size]
+///
+
+#include <opc/ua/socket_channel.h>
+#include <opc/ua/uring_channel.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+  struct Parameters
+  {
+    std::size_t Connections;
+    std::size_t RoundTrips;
+    std::size_t MessageSize;
+  };
+
+  int Listen()
+  {
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock < 0 || bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(sock, SOMAXCONN) < 0)
+    {
+      throw std::runtime_error("Unable to listen on loopback.");
+    }
+    return sock;
+  }
+
+  // Connected loopback sockets: first is the client side, second is the server side.
+  std::vector<std::pair<int, int>> Connect(int listener, std::size_t count)
+  {
+    sockaddr_in addr = sockaddr_in();
+    socklen_t size = sizeof(addr);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &size);
+
+    std::vector<std::pair<int, int>> sockets;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const int client = socket(AF_INET, SOCK_STREAM, 0);
+      if (client < 0 || connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+      {
+        throw std::runtime_error("Unable to connect to loopback.");
+      }
+      const int server = accept(listener, nullptr, nullptr);
+      const int noDelay = 1;
+      setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+      setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+      sockets.push_back(std::make_pair(client, server));
+    }
+    return sockets;
+  }
+
+  // Server side of every connection sends back what it receives until client disconnects.
+  std::vector<std::thread> StartEcho(const std::vector<std::pair<int, int>>& sockets, std::size_t messageSize)
+  {
+    std::vector<std::thread> threads;
+    for (const std::pair<int, int>& pair : sockets)
+    {
+      const int sock = pair.second;
+      threads.push_back(std::thread([sock, messageSize]()
+      {
+        OpcUa::SocketChannel channel(sock);
+        std::vector<char> message(messageSize);
+        try
+        {
+          while (true)
+          {
+            channel.Receive(&message[0], message.size());
+            channel.Send(&message[0], message.size());
+          }
+        }
+        catch (const std::exception&)
+        {
+        }
+      }));
+    }
+    return threads;
+  }
+
+  void Report(const std::string& name, const Parameters& params, std::chrono::steady_clock::duration elapsed)
+  {
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+    const double roundTrips = static_cast<double>(params.Connections * params.RoundTrips);
+    std::cout << name << ": " << seconds << " s, " << static_cast<uint64_t>(roundTrips / seconds) << " round trips/s" << std::endl;
+  }
+
+  // Every connection has a client thread doing blocking round trips through its channel.
+  template <typename CreateChannel>
+  void RunBlocking(const std::string& name, int listener, const Parameters& params, CreateChannel create)
+  {
+    const std::vector<std::pair<int, int>> sockets = Connect(listener, params.Connections);
+    std::vector<std::thread> echo = StartEcho(sockets, params.MessageSize);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (const std::pair<int, int>& pair : sockets)
+    {
+      const int sock = pair.first;
+      clients.push_back(std::thread([sock, &params, &create]()
+      {
+        std::shared_ptr<OpcUa::IOChannel> channel = create(sock);
+        std::vector<char> message(params.MessageSize, 'x');
+        for (std::size_t i = 0; i < params.RoundTrips; ++i)
+        {
+          channel->Send(&message[0], message.size());
+          channel->Receive(&message[0], message.size());
+        }
+      }));
+    }
+    for (std::thread& client : clients)
+    {
+      client.join();
+    }
+    Report(name, params, std::chrono::steady_clock::now() - start);
+
+    for (std::thread& thread : echo)
+    {
+      thread.join();
+    }
+  }
+
+  // One thread drives all connections: sends and receives of every round are queued
+  // for all connections and started with a single Submit.
+  void RunBatched(OpcUa::Uring::SharedPtr ring, int listener, const Parameters& params)
+  {
+    const std::vector<std::pair<int, int>> sockets = Connect(listener, params.Connections);
+    std::vector<std::thread> echo = StartEcho(sockets, params.MessageSize);
+
+    std::vector<std::vector<char>> messages(sockets.size(), std::vector<char>(params.MessageSize, 'x'));
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t completed = 0;
+    bool failed = false;
+    const OpcUa::Uring::Callback onComplete = [&](int result)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      failed = failed || result != static_cast<int>(params.MessageSize);
+      if (++completed == 2 * sockets.size())
+      {
+        done.notify_one();
+      }
+    };
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t round = 0; round < params.RoundTrips && !failed; ++round)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed = 0;
+      }
+      for (std::size_t i = 0; i < sockets.size(); ++i)
+      {
+        ring->QueueSend(sockets[i].first, &messages[i][0], params.MessageSize, 0, onComplete);
+        ring->QueueReceive(sockets[i].first, &messages[i][0], params.MessageSize, MSG_WAITALL, onComplete);
+      }
+      ring->Submit();
+
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [&]()
+      {
+        return completed == 2 * sockets.size();
+      });
+    }
+    Report("Uring batched", params, std::chrono::steady_clock::now() - start);
+    if (failed)
+    {
+      std::cerr << "Some batched operations failed." << std::endl;
+    }
+
+    for (const std::pair<int, int>& pair : sockets)
+    {
+      close(pair.first);
+    }
+    for (std::thread& thread : echo)
+    {
+      thread.join();
+    }
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  Parameters params;
+  params.Connections = argc > 1 ? std::atoi(argv[1]) : 32;
+  params.RoundTrips = argc > 2 ? std::atoi(argv[2]) : 10000;
+  params.MessageSize = argc > 3 ? std::atoi(argv[3]) : 64;
+  std::cout << params.Connections << " connections, " << params.RoundTrips << " round trips of " << params.MessageSize << " bytes" << std::endl;
+
+  const int listener = Listen();
+  RunBlocking("SocketChannel", listener, params, [](int sock)
+  {
+    return std::shared_ptr<OpcUa::IOChannel>(new OpcUa::SocketChannel(sock));
+  });
+
+  OpcUa::Uring::SharedPtr ring = OpcUa::Uring::TryCreate(4 * params.Connections);
+  if (!ring)
+  {
+    std::cout << "Kernel does not support io_uring." << std::endl;
+    close(listener);
+    return 0;
+  }
+  RunBlocking("UringChannel", listener, params, [ring](int sock)
+  {
+    return std::shared_ptr<OpcUa::IOChannel>(new OpcUa::UringChannel(sock, ring));
+  });
+  RunBatched(ring, listener, params);
+
+  close(listener);
+  return 0;
+}
@@ -0,0 +1,170 @@
+/// @brief Benchmark of SocketChannel::SendFile and SendMapped against reading a file and sending it.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+/// Usage: zero_copy_send_benchmark [file megabytes] [repeats] [chunk kilobytes]
+///
+/// A temporary file is sent to a loopback TCP connection, the receiver drops the data.
+/// File stays in page cache, so the difference is the copying through user space.
+///
+
+#include <opc/ua/socket_channel.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+  struct Parameters
+  {
+    std::size_t FileSize;
+    std::size_t Repeats;
+    std::size_t ChunkSize;
+  };
+
+  // Connected loopback sockets: first is the sending side, second is the receiving side.
+  std::pair<int, int> Connect()
+  {
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(addr);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener, 1) < 0
+      || getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &size) < 0)
+    {
+      throw std::runtime_error("Unable to listen on loopback.");
+    }
+    const int client = socket(AF_INET, SOCK_STREAM, 0);
+    if (client < 0 || connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+      throw std::runtime_error("Unable to connect to loopback.");
+    }
+    const int server = accept(listener, nullptr, nullptr);
+    close(listener);
+    return std::make_pair(client, server);
+  }
+
+  int CreateFile(std::size_t size)
+  {
+    char name[] = "/tmp/zero_copy_send_benchmark_XXXXXX";
+    const int fd = mkstemp(name);
+    if (fd < 0)
+    {
+      throw std::runtime_error("Unable to create temporary file.");
+    }
+    unlink(name);
+    const std::vector<char> block(1024 * 1024, 'x');
+    for (std::size_t written = 0; written < size; written += block.size())
+    {
+      if (write(fd, &block[0], std::min(block.size(), size - written)) < 0)
+      {
+        throw std::runtime_error("Unable to write temporary file.");
+      }
+    }
+    return fd;
+  }
+
+  double CpuSeconds()
+  {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+  }
+
+  template <typename SendFunction>
+  void Run(const std::string& name, const Parameters& params, SendFunction send)
+  {
+    const std::pair<int, int> sockets = Connect();
+    std::thread receiver([&sockets]()
+    {
+      std::vector<char> buffer(256 * 1024);
+      while (recv(sockets.second, &buffer[0], buffer.size(), 0) > 0)
+      {
+      }
+      close(sockets.second);
+    });
+
+    const double cpuStart = CpuSeconds();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+      OpcUa::SocketChannel channel(sockets.first);
+      for (std::size_t i = 0; i < params.Repeats; ++i)
+      {
+        send(channel);
+      }
+    }
+    receiver.join();
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+    const double cpu = CpuSeconds() - cpuStart;
+
+    const double megabytes = static_cast<double>(params.FileSize) * params.Repeats / 1024 / 1024;
+    std::cout << name << ": " << seconds << " s, " << static_cast<uint64_t>(megabytes / seconds) << " MB/s, "
+              << cpu << " s of CPU including receiver" << std::endl;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  Parameters params;
+  params.FileSize = static_cast<std::size_t>(argc > 1 ? std::atoi(argv[1]) : 64) * 1024 * 1024;
+  params.Repeats = argc > 2 ? std::atoi(argv[2]) : 16;
+  params.ChunkSize = static_cast<std::size_t>(argc > 3 ? std::atoi(argv[3]) : 64) * 1024;
+  std::cout << params.FileSize / 1024 / 1024 << " MB file sent " << params.Repeats << " times, "
+            << params.ChunkSize / 1024 << " KB chunks for read and Send" << std::endl;
+
+  const int fd = CreateFile(params.FileSize);
+  void* mapped = mmap(nullptr, params.FileSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED)
+  {
+    std::cerr << "Unable to map temporary file." << std::endl;
+    return 1;
+  }
+
+  Run("pread and Send", params, [&params, fd](OpcUa::SocketChannel& channel)
+  {
+    std::vector<char> chunk(params.ChunkSize);
+    for (std::size_t offset = 0; offset < params.FileSize;)
+    {
+      const ssize_t size = pread(fd, &chunk[0], chunk.size(), offset);
+      if (size <= 0)
+      {
+        throw std::runtime_error("Unable to read temporary file.");
+      }
+      channel.Send(&chunk[0], size);
+      offset += size;
+    }
+  });
+
+  Run("SendFile", params, [&params, fd](OpcUa::SocketChannel& channel)
+  {
+    channel.SendFile(fd, 0, params.FileSize);
+  });
+
+  Run("SendMapped", params, [&params, mapped](OpcUa::SocketChannel& channel)
+  {
+    channel.SendMapped(static_cast<const char*>(mapped), params.FileSize);
+  });
+
+  munmap(mapped, params.FileSize);
+  close(fd);
+  return 0;
+}
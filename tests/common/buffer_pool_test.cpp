@@ -0,0 +1,92 @@
+/// @brief Test of Common::BufferPool.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/common/buffer_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(BufferPool, ReusesReleasedBuffers)
+{
+  Common::BufferPool pool;
+  std::shared_ptr<Common::BufferPool::Buffer> buffer = pool.Acquire();
+  buffer->resize(100);
+  const char* data = buffer->data();
+  std::shared_ptr<Common::BufferPool::Buffer> copy = buffer;
+  buffer.reset();
+  ASSERT_EQ(pool.GetFreeCount(), 0u);
+  copy.reset();
+  ASSERT_EQ(pool.GetFreeCount(), 1u);
+
+  buffer = pool.Acquire();
+  ASSERT_TRUE(buffer->empty());
+  ASSERT_GE(buffer->capacity(), 100u);
+  ASSERT_EQ(buffer->data(), data);
+  ASSERT_EQ(pool.GetFreeCount(), 0u);
+}
+
+TEST(BufferPool, DropsBuffersAboveLimits)
+{
+  Common::BufferPool pool(1, 1024);
+  std::shared_ptr<Common::BufferPool::Buffer> big = pool.Acquire();
+  big->resize(2048);
+  big.reset();
+  ASSERT_EQ(pool.GetFreeCount(), 0u);
+
+  std::shared_ptr<Common::BufferPool::Buffer> first = pool.Acquire();
+  std::shared_ptr<Common::BufferPool::Buffer> second = pool.Acquire();
+  first.reset();
+  second.reset();
+  ASSERT_EQ(pool.GetFreeCount(), 1u);
+}
+
+TEST(BufferPool, BuffersOutliveThePool)
+{
+  std::shared_ptr<Common::BufferPool::Buffer> buffer;
+  {
+    Common::BufferPool pool;
+    buffer = pool.Acquire();
+  }
+  buffer->push_back('a');
+  buffer.reset();
+}
+
+TEST(BufferPool, SharesBuffersBetweenThreads)
+{
+  Common::BufferPool pool(8);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.push_back(std::thread([&pool, i]()
+    {
+      std::vector<std::shared_ptr<Common::BufferPool::Buffer>> buffers;
+      for (int j = 0; j < 10000; ++j)
+      {
+        buffers.push_back(pool.Acquire());
+        ASSERT_TRUE(buffers.back()->empty());
+        buffers.back()->assign(16, static_cast<char>(i));
+        if (buffers.size() == 4)
+        {
+          for (const std::shared_ptr<Common::BufferPool::Buffer>& buffer : buffers)
+          {
+            ASSERT_EQ(*buffer, Common::BufferPool::Buffer(16, static_cast<char>(i)));
+          }
+          buffers.clear();
+        }
+      }
+    }));
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  ASSERT_LE(pool.GetFreeCount(), 8u);
+  ASSERT_GT(pool.GetFreeCount(), 0u);
+}
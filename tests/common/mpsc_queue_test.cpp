@@ -0,0 +1,84 @@
+/// @brief Test of Common::MpscQueue.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/common/mpsc_queue.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+TEST(MpscQueue, PopsInPushOrder)
+{
+  Common::MpscQueue<int> queue;
+  ASSERT_TRUE(queue.Empty());
+  queue.Push(1);
+  queue.Push(2);
+  queue.Push(3);
+  ASSERT_FALSE(queue.Empty());
+
+  int value = 0;
+  ASSERT_TRUE(queue.Pop(value));
+  ASSERT_EQ(value, 1);
+
+  std::vector<int> values;
+  ASSERT_EQ(queue.Pop(values), 2u);
+  ASSERT_EQ(values, std::vector<int>({2, 3}));
+  ASSERT_FALSE(queue.Pop(value));
+  ASSERT_TRUE(queue.Empty());
+}
+
+TEST(MpscQueue, DestroysNotPoppedElements)
+{
+  std::shared_ptr<int> value(new int(1));
+  {
+    Common::MpscQueue<std::shared_ptr<int>> queue;
+    queue.Push(value);
+    queue.Push(value);
+    ASSERT_EQ(value.use_count(), 3);
+  }
+  ASSERT_EQ(value.use_count(), 1);
+}
+
+TEST(MpscQueue, KeepsOrderOfEveryProducerUnderContention)
+{
+  const unsigned producers = 8;
+  const unsigned perProducer = 100000;
+  Common::MpscQueue<std::pair<unsigned, unsigned>> queue;
+
+  std::vector<std::thread> threads;
+  for (unsigned producer = 0; producer < producers; ++producer)
+  {
+    threads.push_back(std::thread([&queue, producer, perProducer]()
+    {
+      for (unsigned i = 0; i < perProducer; ++i)
+      {
+        queue.Push(std::make_pair(producer, i));
+      }
+    }));
+  }
+
+  std::vector<unsigned> next(producers, 0);
+  std::vector<std::pair<unsigned, unsigned>> batch;
+  unsigned received = 0;
+  while (received < producers * perProducer)
+  {
+    batch.clear();
+    received += queue.Pop(batch, 256);
+    for (const std::pair<unsigned, unsigned>& value : batch)
+    {
+      ASSERT_EQ(value.second, next[value.first]);
+      ++next[value.first];
+    }
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  ASSERT_TRUE(queue.Empty());
+}
@@ -0,0 +1,172 @@
+/// @brief Test of Common::ThreadPool.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/common/thread_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+
+namespace
+{
+
+  class TestThreadObserver : public Common::ThreadObserver
+  {
+  public:
+    TestThreadObserver()
+      : OnErrorCallCount(0)
+    {
+    }
+
+    virtual void OnSuccess() override
+    {
+    }
+
+    virtual void OnError(const std::exception& exc) override
+    {
+      ++OnErrorCallCount;
+    }
+
+  public:
+    std::atomic<unsigned> OnErrorCallCount;
+  };
+
+}
+
+TEST(ThreadPool, ExecutesAllPostedTasksBeforeDestruction)
+{
+  std::atomic<unsigned> executed(0);
+  {
+    Common::ThreadPool pool(4);
+    ASSERT_EQ(pool.Size(), 4u);
+    for (unsigned i = 0; i < 10000; ++i)
+    {
+      pool.Post([&executed]()
+      {
+        ++executed;
+      });
+    }
+  }
+  ASSERT_EQ(executed, 10000u);
+}
+
+TEST(ThreadPool, TasksCanPostTasks)
+{
+  std::atomic<unsigned> executed(0);
+  {
+    Common::ThreadPool pool(2);
+    for (unsigned i = 0; i < 100; ++i)
+    {
+      pool.Post([&pool, &executed]()
+      {
+        for (unsigned j = 0; j < 10; ++j)
+        {
+          pool.Post([&executed]()
+          {
+            ++executed;
+          });
+        }
+      });
+    }
+  }
+  ASSERT_EQ(executed, 1000u);
+}
+
+TEST(ThreadPool, SubmitReturnsResultAndException)
+{
+  Common::ThreadPool pool(2);
+  std::future<int> result = pool.Submit([]()
+  {
+    return 42;
+  });
+  std::future<void> error = pool.Submit([]()
+  {
+    throw std::logic_error("oppps!");
+  });
+  ASSERT_EQ(result.get(), 42);
+  ASSERT_THROW(error.get(), std::logic_error);
+}
+
+TEST(ThreadPool, ReportsErrorsOfPostedTasksToObserver)
+{
+  TestThreadObserver observer;
+  {
+    Common::ThreadPool pool(2, &observer);
+    pool.Post([]()
+    {
+      throw std::logic_error("oppps!");
+    });
+  }
+  ASSERT_EQ(observer.OnErrorCallCount, 1u);
+}
+
+TEST(ThreadPool, ReportsExceptionsOfOtherTypesToObserver)
+{
+  TestThreadObserver observer;
+  std::atomic<int> executed(0);
+  {
+    Common::ThreadPool pool(1, &observer);
+    pool.Post([]()
+    {
+      throw 1;
+    });
+    // Worker survives and runs next task.
+    pool.Post([&executed]()
+    {
+      ++executed;
+    });
+  }
+  ASSERT_EQ(observer.OnErrorCallCount, 1u);
+  ASSERT_EQ(executed, 1);
+}
+
+TEST(ThreadPool, ParallelForVisitsEveryIndexOnce)
+{
+  Common::ThreadPool pool(4);
+  std::vector<std::atomic<unsigned>> visits(10007);
+  for (std::atomic<unsigned>& visit : visits)
+  {
+    visit = 0;
+  }
+  pool.ParallelFor(0, visits.size(), [&visits](std::size_t i)
+  {
+    ++visits[i];
+  });
+  for (const std::atomic<unsigned>& visit : visits)
+  {
+    ASSERT_EQ(visit, 1u);
+  }
+}
+
+TEST(ThreadPool, ParallelForFromWorkerDoesNotDeadlock)
+{
+  Common::ThreadPool pool(1);
+  std::future<std::size_t> result = pool.Submit([&pool]()
+  {
+    std::atomic<std::size_t> sum(0);
+    pool.ParallelFor(0, 100, [&sum](std::size_t i)
+    {
+      sum += i;
+    });
+    return sum.load();
+  });
+  ASSERT_EQ(result.get(), 4950u);
+}
+
+TEST(ThreadPool, ParallelForRethrowsException)
+{
+  Common::ThreadPool pool(2);
+  ASSERT_THROW(pool.ParallelFor(0, 100, [](std::size_t i)
+  {
+    if (i == 50)
+    {
+      throw std::logic_error("oppps!");
+    }
+  }), std::logic_error);
+}
@@ -0,0 +1,163 @@
+/// @brief Test of Common::TimerWheel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/common/timer_wheel.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace
+{
+
+  template <typename Predicate>
+  bool WaitFor(Predicate predicate, milliseconds timeout = milliseconds(2000))
+  {
+    const steady_clock::time_point deadline = steady_clock::now() + timeout;
+    while (!predicate() && steady_clock::now() < deadline)
+    {
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    return predicate();
+  }
+
+}
+
+TEST(TimerWheel, CallsTimerOnceAfterDelay)
+{
+  Common::TimerWheel wheel;
+  std::atomic<unsigned> calls(0);
+  const steady_clock::time_point scheduled = steady_clock::now();
+  std::atomic<int64_t> elapsed(0);
+  wheel.Schedule(milliseconds(100), [&]()
+  {
+    elapsed = duration_cast<milliseconds>(steady_clock::now() - scheduled).count();
+    ++calls;
+  });
+  ASSERT_EQ(wheel.Size(), 1u);
+
+  ASSERT_TRUE(WaitFor([&]() { return calls == 1; }));
+  ASSERT_GE(elapsed, 100);
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_EQ(calls, 1u);
+  ASSERT_EQ(wheel.Size(), 0u);
+}
+
+TEST(TimerWheel, CancelledTimerIsNotCalled)
+{
+  Common::TimerWheel wheel;
+  std::atomic<unsigned> calls(0);
+  const Common::TimerID id = wheel.Schedule(milliseconds(20), [&]() { ++calls; });
+  ASSERT_TRUE(wheel.Cancel(id));
+  ASSERT_FALSE(wheel.Cancel(id));
+  std::this_thread::sleep_for(milliseconds(50));
+  ASSERT_EQ(calls, 0u);
+}
+
+TEST(TimerWheel, PeriodicTimersWithEqualIntervalsExpireTogether)
+{
+  std::shared_ptr<Common::ThreadPool> pool(new Common::ThreadPool(2));
+  Common::TimerWheel wheel(pool);
+  std::atomic<unsigned> first(0);
+  std::atomic<unsigned> second(0);
+  std::atomic<std::thread::id> firstThread;
+  std::atomic<std::thread::id> secondThread;
+  const Common::TimerID id = wheel.SchedulePeriodic(milliseconds(20), [&]()
+  {
+    firstThread = std::this_thread::get_id();
+    ++first;
+  });
+  std::this_thread::sleep_for(milliseconds(7));
+  wheel.SchedulePeriodic(milliseconds(20), [&]()
+  {
+    // Coalesced callbacks run one after another in the same task.
+    secondThread = std::this_thread::get_id();
+    ++second;
+  });
+
+  ASSERT_TRUE(WaitFor([&]() { return first >= 3 && second >= 3; }));
+  ASSERT_EQ(firstThread.load(), secondThread.load());
+  ASSERT_TRUE(wheel.Cancel(id));
+  ASSERT_EQ(wheel.Size(), 1u);
+}
+
+TEST(TimerWheel, ManyTimersFireAcrossLevels)
+{
+  Common::TimerWheel wheel;
+  const unsigned count = 10000;
+  std::atomic<unsigned> calls(0);
+  std::vector<Common::TimerID> ids;
+  for (unsigned i = 0; i < count; ++i)
+  {
+    // Delays from 50 to 350 ms reach the second level with 1 ms resolution.
+    ids.push_back(wheel.Schedule(milliseconds(50 + i % 300), [&]() { ++calls; }));
+  }
+  for (unsigned i = 0; i < count; i += 2)
+  {
+    ASSERT_TRUE(wheel.Cancel(ids[i]));
+  }
+  ASSERT_TRUE(WaitFor([&]() { return calls == count / 2; }));
+  ASSERT_EQ(wheel.Size(), 0u);
+}
+
+TEST(TimerWheel, CancelledPeriodicTimerSkipsDispatchedCallbacks)
+{
+  std::shared_ptr<Common::ThreadPool> pool(new Common::ThreadPool(1));
+  Common::TimerWheel wheel(pool);
+  std::atomic<bool> release(false);
+  std::atomic<bool> blocked(false);
+  pool->Post([&]()
+  {
+    blocked = true;
+    while (!release)
+    {
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+  });
+  ASSERT_TRUE(WaitFor([&]() { return blocked.load(); }));
+
+  // Expirations are queued in the pool behind the blocked task.
+  std::atomic<unsigned> calls(0);
+  const Common::TimerID id = wheel.SchedulePeriodic(milliseconds(2), [&]() { ++calls; });
+  std::this_thread::sleep_for(milliseconds(30));
+  ASSERT_TRUE(wheel.Cancel(id));
+  release = true;
+
+  std::this_thread::sleep_for(milliseconds(30));
+  ASSERT_EQ(calls, 0u);
+}
+
+TEST(TimerWheel, DelayIsNotShortenedWhileCallbackRuns)
+{
+  Common::TimerWheel wheel;
+  // Wheel with scheduled timers is advanced only by timer thread.
+  wheel.Schedule(milliseconds(1000), []() {});
+  std::atomic<bool> started(false);
+  wheel.Schedule(milliseconds(1), [&]()
+  {
+    // Timer thread does not advance the wheel while callback runs.
+    started = true;
+    std::this_thread::sleep_for(milliseconds(60));
+  });
+  ASSERT_TRUE(WaitFor([&]() { return started.load(); }));
+  std::this_thread::sleep_for(milliseconds(30));
+
+  std::atomic<unsigned> calls(0);
+  std::atomic<int64_t> elapsed(0);
+  const steady_clock::time_point scheduled = steady_clock::now();
+  wheel.Schedule(milliseconds(50), [&]()
+  {
+    elapsed = duration_cast<milliseconds>(steady_clock::now() - scheduled).count();
+    ++calls;
+  });
+  ASSERT_TRUE(WaitFor([&]() { return calls == 1; }));
+  ASSERT_GE(elapsed, 50);
+}
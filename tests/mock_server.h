@@ -0,0 +1,104 @@
+/// @brief Mock of remote server services for tests of node layer.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#ifndef TEST_MOCK_SERVER_H
+#define TEST_MOCK_SERVER_H
+
+#include <opc/ua/server.h>
+
+#include <gmock/gmock.h>
+
+namespace OpcCoreTests
+{
+
+  class MockViewServices : public OpcUa::Remote::ViewServices
+  {
+  public:
+    DEFINE_CLASS_POINTERS(MockViewServices);
+
+  public:
+    MOCK_CONST_METHOD1(Browse, std::vector<OpcUa::ReferenceDescription>(const OpcUa::NodesQuery& query));
+    MOCK_CONST_METHOD0(BrowseNext, std::vector<OpcUa::ReferenceDescription>());
+    MOCK_CONST_METHOD1(TranslateBrowsePathsToNodeIds, std::vector<OpcUa::BrowsePathResult>(const OpcUa::TranslateBrowsePathsParameters& params));
+    MOCK_CONST_METHOD1(BrowseNodes, std::vector<std::vector<OpcUa::ReferenceDescription>>(const OpcUa::NodesQuery& query));
+  };
+
+  class MockAttributeServices : public OpcUa::Remote::AttributeServices
+  {
+  public:
+    DEFINE_CLASS_POINTERS(MockAttributeServices);
+
+  public:
+    MOCK_CONST_METHOD1(Read, std::vector<OpcUa::DataValue>(const OpcUa::ReadParameters& filter));
+    MOCK_METHOD1(Write, std::vector<OpcUa::StatusCode>(const std::vector<OpcUa::WriteValue>& filter));
+  };
+
+  class MockNodeManagementServices : public OpcUa::Remote::NodeManagementServices
+  {
+  public:
+    DEFINE_CLASS_POINTERS(MockNodeManagementServices);
+
+  public:
+    MOCK_METHOD1(AddNodes, std::vector<OpcUa::AddNodesResult>(const std::vector<OpcUa::AddNodesItem>& items));
+    MOCK_METHOD1(AddReferences, std::vector<OpcUa::StatusCode>(const std::vector<OpcUa::AddReferencesItem>& items));
+    MOCK_METHOD3(AddAttribute, void(const OpcUa::NodeID& node, OpcUa::AttributeID attribute, const OpcUa::Variant& value));
+    MOCK_METHOD2(AddReference, void(const OpcUa::NodeID& sourceNode, const OpcUa::ReferenceDescription& reference));
+  };
+
+  /// @brief Server which forwards services to strict mocks, so unexpected calls fail tests.
+  class MockServer : public OpcUa::Remote::Server
+  {
+  public:
+    DEFINE_CLASS_POINTERS(MockServer);
+
+  public:
+    MockServer()
+      : ViewsMock(new testing::StrictMock<MockViewServices>)
+      , AttributesMock(new testing::StrictMock<MockAttributeServices>)
+      , NodeManagementMock(new testing::StrictMock<MockNodeManagementServices>)
+    {
+    }
+
+    virtual void CreateSession(const OpcUa::Remote::SessionParameters&) { }
+    virtual void ActivateSession() { }
+    virtual void CloseSession() { }
+
+    virtual OpcUa::Remote::EndpointServices::SharedPtr Endpoints() const
+    {
+      return OpcUa::Remote::EndpointServices::SharedPtr();
+    }
+
+    virtual OpcUa::Remote::ViewServices::SharedPtr Views() const
+    {
+      return ViewsMock;
+    }
+
+    virtual OpcUa::Remote::NodeManagementServices::SharedPtr NodeManagement() const
+    {
+      return NodeManagementMock;
+    }
+
+    virtual OpcUa::Remote::AttributeServices::SharedPtr Attributes() const
+    {
+      return AttributesMock;
+    }
+
+    virtual OpcUa::Remote::SubscriptionServices::SharedPtr Subscriptions() const
+    {
+      return OpcUa::Remote::SubscriptionServices::SharedPtr();
+    }
+
+  public:
+    const std::shared_ptr<testing::StrictMock<MockViewServices>> ViewsMock;
+    const std::shared_ptr<testing::StrictMock<MockAttributeServices>> AttributesMock;
+    const std::shared_ptr<testing::StrictMock<MockNodeManagementServices>> NodeManagementMock;
+  };
+
+}
+
+#endif // TEST_MOCK_SERVER_H
@@ -0,0 +1,223 @@
+/// @brief Tests of OpcUa::AsyncSocketChannel and OpcUa::EventLoop.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/async_channel.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <sys/socket.h>
+#include <thread>
+
+namespace
+{
+
+  std::pair<std::shared_ptr<OpcUa::SocketChannel>, std::shared_ptr<OpcUa::SocketChannel>> CreateChannels()
+  {
+    int fds[2] = {-1, -1};
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+      throw std::runtime_error("socketpair failed");
+    }
+    return std::make_pair(std::make_shared<OpcUa::SocketChannel>(fds[0]), std::make_shared<OpcUa::SocketChannel>(fds[1]));
+  }
+
+}
+
+TEST(AsyncSocketChannel, CompletesOperationsInLoop)
+{
+  auto channels = CreateChannels();
+  OpcUa::EventLoop loop;
+  OpcUa::AsyncSocketChannel::SharedPtr channel = OpcUa::AsyncSocketChannel::Create(channels.first, loop);
+
+  int sendError = -1;
+  int receiveError = -1;
+  std::size_t received = 0;
+  char data[5] = {0};
+  channel->AsyncSend("hello", 5, [&](int error, std::size_t)
+  {
+    sendError = error;
+  });
+  channel->AsyncReceive(data, sizeof(data), [&](int error, std::size_t bytes)
+  {
+    receiveError = error;
+    received = bytes;
+    loop.Stop();
+  });
+
+  std::thread peer([&]()
+  {
+    char request[5] = {0};
+    channels.second->Receive(request, sizeof(request));
+    channels.second->Send("wor", 3);
+    channels.second->Send("ld", 2);
+  });
+  loop.Run();
+  peer.join();
+
+  ASSERT_EQ(sendError, 0);
+  ASSERT_EQ(receiveError, 0);
+  ASSERT_EQ(received, sizeof(data));
+  ASSERT_EQ(std::string(data, sizeof(data)), "world");
+}
+
+TEST(AsyncSocketChannel, CancelCompletesWithECANCELED)
+{
+  auto channels = CreateChannels();
+  OpcUa::EventLoop loop;
+  OpcUa::AsyncSocketChannel::SharedPtr channel = OpcUa::AsyncSocketChannel::Create(channels.first, loop);
+
+  int receiveError = 0;
+  char data[5] = {0};
+  channel->AsyncReceive(data, sizeof(data), [&](int error, std::size_t)
+  {
+    receiveError = error;
+  });
+  ASSERT_EQ(loop.RunOnce(0.01), 0u);
+
+  channel->Cancel();
+  ASSERT_EQ(receiveError, 0);
+  ASSERT_EQ(loop.RunOnce(1), 1u);
+  ASSERT_EQ(receiveError, ECANCELED);
+}
+
+TEST(AsyncSocketChannel, ClosedPeerCompletesWithECONNRESET)
+{
+  auto channels = CreateChannels();
+  OpcUa::EventLoop loop;
+  OpcUa::AsyncSocketChannel::SharedPtr channel = OpcUa::AsyncSocketChannel::Create(channels.first, loop);
+
+  int receiveError = 0;
+  std::size_t received = 0;
+  char data[5] = {0};
+  channel->AsyncReceive(data, sizeof(data), [&](int error, std::size_t bytes)
+  {
+    receiveError = error;
+    received = bytes;
+  });
+  channels.second->Send("he", 2);
+  channels.second.reset();
+  loop.RunOnce(1);
+
+  ASSERT_EQ(receiveError, ECONNRESET);
+  ASSERT_EQ(received, 2u);
+}
+
+TEST(AsyncSocketChannel, OneThreadServesManyChannels)
+{
+  const std::size_t count = 200;
+  OpcUa::EventLoop loop;
+  std::vector<std::shared_ptr<OpcUa::SocketChannel>> peers;
+  std::vector<OpcUa::AsyncSocketChannel::SharedPtr> servers;
+  std::vector<char> buffers(count);
+  std::size_t echoed = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    auto channels = CreateChannels();
+    peers.push_back(channels.second);
+    servers.push_back(OpcUa::AsyncSocketChannel::Create(channels.first, loop));
+  }
+
+  // Echo one byte back on every channel.
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    OpcUa::AsyncSocketChannel::SharedPtr server = servers[i];
+    char* buffer = &buffers[i];
+    server->AsyncReceive(buffer, 1, [&, server, buffer](int error, std::size_t)
+    {
+      ASSERT_EQ(error, 0);
+      server->AsyncSend(buffer, 1, [&](int error, std::size_t)
+      {
+        ASSERT_EQ(error, 0);
+        if (++echoed == count)
+        {
+          loop.Stop();
+        }
+      });
+    });
+  }
+
+  std::thread runner([&loop]()
+  {
+    loop.Run();
+  });
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const char value = static_cast<char>(i);
+    peers[i]->Send(&value, 1);
+  }
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    char value = 0;
+    peers[i]->Receive(&value, 1);
+    ASSERT_EQ(value, static_cast<char>(i));
+  }
+  runner.join();
+  ASSERT_EQ(echoed, count);
+}
+
+TEST(AsyncSocketChannel, CompletesInOrderWithManyLoopThreads)
+{
+  const std::size_t count = 500;
+  auto channels = CreateChannels();
+  OpcUa::EventLoop loop;
+  OpcUa::AsyncSocketChannel::SharedPtr channel = OpcUa::AsyncSocketChannel::Create(channels.first, loop);
+
+  std::vector<char> buffers(count);
+  std::vector<std::size_t> order;
+  std::atomic<bool> inCompletion(false);
+  std::atomic<bool> overlapped(false);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    channel->AsyncReceive(&buffers[i], 1, [&, i](int error, std::size_t)
+    {
+      ASSERT_EQ(error, 0);
+      if (inCompletion.exchange(true))
+      {
+        overlapped = true;
+      }
+      order.push_back(i);
+      // Give other loop threads time to handle the next readiness.
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      inCompletion = false;
+      if (order.size() == count)
+      {
+        loop.Stop();
+      }
+    });
+  }
+
+  std::vector<std::thread> runners;
+  for (int i = 0; i < 4; ++i)
+  {
+    runners.push_back(std::thread([&loop]()
+    {
+      loop.Run();
+    }));
+  }
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const char value = static_cast<char>(i);
+    channels.second->Send(&value, 1);
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+  for (std::thread& runner : runners)
+  {
+    runner.join();
+  }
+
+  ASSERT_FALSE(overlapped);
+  ASSERT_EQ(order.size(), count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    ASSERT_EQ(order[i], i);
+    ASSERT_EQ(buffers[i], static_cast<char>(i));
+  }
+}
@@ -0,0 +1,265 @@
+/// @brief Tests of OpcUa::AttributeCache and server reading through it.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include "mock_server.h"
+
+#include <opc/ua/attribute_cache.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace testing;
+using namespace OpcCoreTests;
+
+namespace
+{
+
+  OpcUa::DataValue MakeValue(int32_t value)
+  {
+    OpcUa::DataValue result(value);
+    result.Status = OpcUa::StatusCode::Good;
+    return result;
+  }
+
+  OpcUa::ReadParameters MakeRead(const std::vector<std::pair<OpcUa::NodeID, OpcUa::AttributeID>>& attributes)
+  {
+    OpcUa::ReadParameters params;
+    for (const auto& attribute : attributes)
+    {
+      OpcUa::AttributeValueID id;
+      id.Node = attribute.first;
+      id.Attribute = attribute.second;
+      params.AttributesToRead.push_back(id);
+    }
+    return params;
+  }
+
+  std::vector<OpcUa::DataValue> ReadFromServer(const OpcUa::ReadParameters& params)
+  {
+    std::vector<OpcUa::DataValue> values;
+    for (const OpcUa::AttributeValueID& attribute : params.AttributesToRead)
+    {
+      values.push_back(MakeValue(attribute.Node.GetIntegerIdentifier() * 100 + static_cast<int32_t>(attribute.Attribute)));
+    }
+    return values;
+  }
+
+}
+
+TEST(AttributeCache, CountsHitsAndMisses)
+{
+  OpcUa::AttributeCache cache;
+  const OpcUa::NodeID node = OpcUa::NumericNodeID(1, 1);
+  OpcUa::DataValue value;
+
+  ASSERT_FALSE(cache.Get(node, OpcUa::AttributeID::BROWSE_NAME, value));
+  cache.Put(node, OpcUa::AttributeID::BROWSE_NAME, MakeValue(5));
+  ASSERT_TRUE(cache.Get(node, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_EQ(value.Value, OpcUa::Variant(int32_t(5)));
+  ASSERT_FALSE(cache.Get(node, OpcUa::AttributeID::DISPLAY_NAME, value));
+
+  const OpcUa::AttributeCacheStatistics statistics = cache.GetStatistics();
+  ASSERT_EQ(statistics.Hits, 1u);
+  ASSERT_EQ(statistics.Misses, 2u);
+  ASSERT_EQ(statistics.Size, 1u);
+}
+
+TEST(AttributeCache, EvictsLeastRecentlyUsed)
+{
+  OpcUa::AttributeCacheParameters params;
+  params.MaxEntries = 2;
+  OpcUa::AttributeCache cache(params);
+  const OpcUa::NodeID first = OpcUa::NumericNodeID(1, 1);
+  const OpcUa::NodeID second = OpcUa::NumericNodeID(2, 1);
+  const OpcUa::NodeID third = OpcUa::NumericNodeID(3, 1);
+  OpcUa::DataValue value;
+
+  cache.Put(first, OpcUa::AttributeID::BROWSE_NAME, MakeValue(1));
+  cache.Put(second, OpcUa::AttributeID::BROWSE_NAME, MakeValue(2));
+  // Using the first one makes the second least recently used.
+  ASSERT_TRUE(cache.Get(first, OpcUa::AttributeID::BROWSE_NAME, value));
+  cache.Put(third, OpcUa::AttributeID::BROWSE_NAME, MakeValue(3));
+
+  ASSERT_TRUE(cache.Get(first, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_FALSE(cache.Get(second, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_TRUE(cache.Get(third, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_EQ(cache.GetStatistics().Evictions, 1u);
+  ASSERT_EQ(cache.GetStatistics().Size, 2u);
+}
+
+TEST(AttributeCache, ExpiresValuesAfterTimeToLive)
+{
+  OpcUa::AttributeCacheParameters params;
+  params.TimeToLive = std::chrono::milliseconds(20);
+  OpcUa::AttributeCache cache(params);
+  const OpcUa::NodeID node = OpcUa::NumericNodeID(1, 1);
+  OpcUa::DataValue value;
+
+  cache.Put(node, OpcUa::AttributeID::BROWSE_NAME, MakeValue(1));
+  ASSERT_TRUE(cache.Get(node, OpcUa::AttributeID::BROWSE_NAME, value));
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  ASSERT_FALSE(cache.Get(node, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_EQ(cache.GetStatistics().Size, 0u);
+}
+
+TEST(AttributeCache, InvalidatesAttributesOfNode)
+{
+  OpcUa::AttributeCache cache;
+  const OpcUa::NodeID node = OpcUa::NumericNodeID(1, 1);
+  const OpcUa::NodeID other = OpcUa::NumericNodeID(2, 1);
+  OpcUa::DataValue value;
+
+  cache.Put(node, OpcUa::AttributeID::BROWSE_NAME, MakeValue(1));
+  cache.Put(node, OpcUa::AttributeID::DISPLAY_NAME, MakeValue(2));
+  cache.Put(other, OpcUa::AttributeID::BROWSE_NAME, MakeValue(3));
+
+  cache.Invalidate(node, OpcUa::AttributeID::DISPLAY_NAME);
+  ASSERT_TRUE(cache.Get(node, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_FALSE(cache.Get(node, OpcUa::AttributeID::DISPLAY_NAME, value));
+
+  cache.Invalidate(node);
+  ASSERT_FALSE(cache.Get(node, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_TRUE(cache.Get(other, OpcUa::AttributeID::BROWSE_NAME, value));
+
+  cache.Clear();
+  ASSERT_EQ(cache.GetStatistics().Size, 0u);
+}
+
+TEST(CachedServer, ReadsOnlyMissedCacheableAttributesFromServer)
+{
+  MockServer::SharedPtr server(new MockServer);
+  OpcUa::AttributeCache::SharedPtr cache(new OpcUa::AttributeCache);
+  OpcUa::Remote::Server::SharedPtr cached = OpcUa::CreateCachedServer(server, cache);
+  const OpcUa::NodeID node = OpcUa::NumericNodeID(1, 1);
+
+  std::vector<OpcUa::ReadParameters> reads;
+  EXPECT_CALL(*server->AttributesMock, Read(_))
+    .Times(2)
+    .WillRepeatedly(Invoke([&reads](const OpcUa::ReadParameters& params)
+    {
+      reads.push_back(params);
+      return ReadFromServer(params);
+    }));
+
+  const OpcUa::ReadParameters params = MakeRead({{node, OpcUa::AttributeID::BROWSE_NAME}, {node, OpcUa::AttributeID::VALUE}});
+  const std::vector<OpcUa::DataValue> first = cached->Attributes()->Read(params);
+  const std::vector<OpcUa::DataValue> second = cached->Attributes()->Read(params);
+
+  ASSERT_EQ(reads[0].AttributesToRead.size(), 2u);
+  // Value is not cacheable by default, browse name is taken from cache.
+  ASSERT_EQ(reads[1].AttributesToRead.size(), 1u);
+  ASSERT_EQ(reads[1].AttributesToRead[0].Attribute, OpcUa::AttributeID::VALUE);
+  ASSERT_EQ(second.size(), 2u);
+  ASSERT_EQ(second[0].Value, first[0].Value);
+  ASSERT_EQ(second[1].Value, first[1].Value);
+}
+
+TEST(CachedServer, DoesNotCacheBadValues)
+{
+  MockServer::SharedPtr server(new MockServer);
+  OpcUa::AttributeCache::SharedPtr cache(new OpcUa::AttributeCache);
+  OpcUa::Remote::Server::SharedPtr cached = OpcUa::CreateCachedServer(server, cache);
+
+  OpcUa::DataValue bad;
+  bad.Status = OpcUa::StatusCode::BadNodeIdUnknown;
+  EXPECT_CALL(*server->AttributesMock, Read(_))
+    .Times(2)
+    .WillRepeatedly(Return(std::vector<OpcUa::DataValue>(1, bad)));
+
+  const OpcUa::ReadParameters params = MakeRead({{OpcUa::NumericNodeID(1, 1), OpcUa::AttributeID::BROWSE_NAME}});
+  cached->Attributes()->Read(params);
+  ASSERT_EQ(cached->Attributes()->Read(params)[0].Status, OpcUa::StatusCode::BadNodeIdUnknown);
+  ASSERT_EQ(cache->GetStatistics().Size, 0u);
+}
+
+TEST(CachedServer, InvalidatesWrittenAttributesAfterWrite)
+{
+  MockServer::SharedPtr server(new MockServer);
+  OpcUa::AttributeCache::SharedPtr cache(new OpcUa::AttributeCache);
+  OpcUa::Remote::Server::SharedPtr cached = OpcUa::CreateCachedServer(server, cache);
+  const OpcUa::NodeID node = OpcUa::NumericNodeID(1, 1);
+  const OpcUa::ReadParameters params = MakeRead({{node, OpcUa::AttributeID::DISPLAY_NAME}});
+
+  EXPECT_CALL(*server->AttributesMock, Read(_))
+    .Times(2)
+    .WillRepeatedly(Invoke(ReadFromServer));
+  EXPECT_CALL(*server->AttributesMock, Write(_))
+    .WillOnce(Invoke([&cached, &params](const std::vector<OpcUa::WriteValue>& values)
+    {
+      // Read made while server applies the write puts old value into the cache.
+      cached->Attributes()->Read(params);
+      return std::vector<OpcUa::StatusCode>(values.size(), OpcUa::StatusCode::Good);
+    }));
+
+  OpcUa::WriteValue value;
+  value.Node = node;
+  value.Attribute = OpcUa::AttributeID::DISPLAY_NAME;
+  value.Data = MakeValue(1);
+  cached->Attributes()->Write(std::vector<OpcUa::WriteValue>(1, value));
+
+  // Written attribute is read from the server again.
+  cached->Attributes()->Read(params);
+}
+
+TEST(AttributeCache, DropsValuesReadBeforeInvalidation)
+{
+  OpcUa::AttributeCache cache;
+  const OpcUa::NodeID node = OpcUa::NumericNodeID(1, 1);
+  const OpcUa::NodeID other = OpcUa::NumericNodeID(2, 1);
+  OpcUa::DataValue value;
+
+  const uint64_t generation = cache.StartRead();
+  cache.Invalidate(node, OpcUa::AttributeID::DISPLAY_NAME);
+  cache.Put(node, OpcUa::AttributeID::DISPLAY_NAME, MakeValue(1), generation);
+  cache.Put(node, OpcUa::AttributeID::BROWSE_NAME, MakeValue(2), generation);
+  cache.Invalidate(other);
+  cache.Put(other, OpcUa::AttributeID::BROWSE_NAME, MakeValue(3), generation);
+  cache.FinishRead();
+
+  ASSERT_FALSE(cache.Get(node, OpcUa::AttributeID::DISPLAY_NAME, value));
+  ASSERT_TRUE(cache.Get(node, OpcUa::AttributeID::BROWSE_NAME, value));
+  ASSERT_FALSE(cache.Get(other, OpcUa::AttributeID::BROWSE_NAME, value));
+
+  // Read started after invalidation puts its value.
+  const uint64_t next = cache.StartRead();
+  cache.Put(node, OpcUa::AttributeID::DISPLAY_NAME, MakeValue(1), next);
+  cache.FinishRead();
+  ASSERT_TRUE(cache.Get(node, OpcUa::AttributeID::DISPLAY_NAME, value));
+}
+
+TEST(CachedServer, DoesNotCacheValuesReadDuringWrite)
+{
+  MockServer::SharedPtr server(new MockServer);
+  OpcUa::AttributeCache::SharedPtr cache(new OpcUa::AttributeCache);
+  OpcUa::Remote::Server::SharedPtr cached = OpcUa::CreateCachedServer(server, cache);
+  const OpcUa::NodeID node = OpcUa::NumericNodeID(1, 1);
+  const OpcUa::ReadParameters params = MakeRead({{node, OpcUa::AttributeID::DISPLAY_NAME}});
+
+  OpcUa::WriteValue value;
+  value.Node = node;
+  value.Attribute = OpcUa::AttributeID::DISPLAY_NAME;
+  value.Data = MakeValue(1);
+  EXPECT_CALL(*server->AttributesMock, Write(_))
+    .WillOnce(Return(std::vector<OpcUa::StatusCode>(1, OpcUa::StatusCode::Good)));
+  EXPECT_CALL(*server->AttributesMock, Read(_))
+    .Times(2)
+    .WillOnce(Invoke([&cached, &value](const OpcUa::ReadParameters& params)
+    {
+      // Server answers with the old value, the whole write completes before the answer arrives.
+      const std::vector<OpcUa::DataValue> values = ReadFromServer(params);
+      cached->Attributes()->Write(std::vector<OpcUa::WriteValue>(1, value));
+      return values;
+    }))
+    .WillOnce(Invoke(ReadFromServer));
+
+  cached->Attributes()->Read(params);
+  // Old value was not cached, written attribute is read from the server again.
+  cached->Attributes()->Read(params);
+  ASSERT_EQ(cache->GetStatistics().Size, 1u);
+}
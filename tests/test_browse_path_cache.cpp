@@ -0,0 +1,249 @@
+/// @brief Tests of OpcUa::BrowsePathCache.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include "mock_server.h"
+
+#include <opc/ua/browse_path_cache.h>
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace OpcCoreTests;
+
+namespace
+{
+
+  typedef std::vector<OpcUa::QualifiedName> Path;
+
+  Path MakePath(const std::vector<std::string>& names)
+  {
+    Path path;
+    for (const std::string& name : names)
+    {
+      path.push_back(OpcUa::QualifiedName(1, name));
+    }
+    return path;
+  }
+
+  // Address space where every node has children 'a', 'b' and 'c' and ids encode the path from node 1,
+  // for example path a/b has id 1 * 10 + 1 then * 10 + 2 = 112.
+  std::vector<OpcUa::BrowsePathResult> Translate(const OpcUa::TranslateBrowsePathsParameters& params)
+  {
+    std::vector<OpcUa::BrowsePathResult> results;
+    for (const OpcUa::BrowsePath& path : params.BrowsePaths)
+    {
+      OpcUa::BrowsePathResult result;
+      result.Status = OpcUa::StatusCode::Good;
+      uint32_t id = path.StartingNode.GetIntegerIdentifier();
+      for (const OpcUa::RelativePathElement& element : path.Path.Elements)
+      {
+        if (element.TargetName.Name.size() != 1 || element.TargetName.Name[0] < 'a' || element.TargetName.Name[0] > 'c')
+        {
+          result.Status = OpcUa::StatusCode::BadNoMatch;
+          break;
+        }
+        id = id * 10 + (element.TargetName.Name[0] - 'a' + 1);
+      }
+      if (result.Status == OpcUa::StatusCode::Good)
+      {
+        OpcUa::BrowsePathTarget target;
+        target.Node = OpcUa::NumericNodeID(id, 1);
+        target.RemainingPathIndex = ~uint32_t();
+        result.Targets.push_back(target);
+      }
+      results.push_back(result);
+    }
+    return results;
+  }
+
+  std::vector<std::string> Names(const OpcUa::BrowsePath& path)
+  {
+    std::vector<std::string> names;
+    for (const OpcUa::RelativePathElement& element : path.Path.Elements)
+    {
+      names.push_back(element.TargetName.Name);
+    }
+    return names;
+  }
+
+}
+
+class BrowsePathCacheTest : public Test
+{
+protected:
+  virtual void SetUp()
+  {
+    Server.reset(new MockServer);
+    Start = OpcUa::NumericNodeID(1, 1);
+  }
+
+  // Translate paths and remember requests.
+  void ExpectTranslations(std::size_t calls)
+  {
+    EXPECT_CALL(*Server->ViewsMock, TranslateBrowsePathsToNodeIds(_))
+      .Times(calls)
+      .WillRepeatedly(Invoke([this](const OpcUa::TranslateBrowsePathsParameters& params)
+      {
+        Requests.push_back(params);
+        return Translate(params);
+      }));
+  }
+
+protected:
+  MockServer::SharedPtr Server;
+  OpcUa::NodeID Start;
+  std::vector<OpcUa::TranslateBrowsePathsParameters> Requests;
+};
+
+TEST_F(BrowsePathCacheTest, TranslatesWholePathAndItsPrefixesWithOneCall)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  ExpectTranslations(1);
+
+  const OpcUa::Node node = cache.Resolve(Start, MakePath({"a", "b", "c"}));
+  ASSERT_EQ(node.GetId(), OpcUa::NumericNodeID(1123, 1));
+  ASSERT_EQ(Requests.size(), 1u);
+  ASSERT_EQ(Requests[0].BrowsePaths.size(), 3u);
+  ASSERT_EQ(Requests[0].BrowsePaths[2].StartingNode, Start);
+  ASSERT_EQ(Names(Requests[0].BrowsePaths[0]), std::vector<std::string>({"a"}));
+  ASSERT_EQ(Names(Requests[0].BrowsePaths[1]), std::vector<std::string>({"a", "b"}));
+  ASSERT_EQ(Names(Requests[0].BrowsePaths[2]), std::vector<std::string>({"a", "b", "c"}));
+
+  // Second time the path and its prefixes are taken from cache.
+  ASSERT_EQ(cache.Resolve(Start, MakePath({"a", "b", "c"})).GetId(), OpcUa::NumericNodeID(1123, 1));
+  ASSERT_EQ(cache.Resolve(Start, MakePath({"a", "b"})).GetId(), OpcUa::NumericNodeID(112, 1));
+  ASSERT_EQ(cache.Size(), 3u);
+}
+
+TEST_F(BrowsePathCacheTest, TranslatesSuffixFromDeepestCachedNode)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  ExpectTranslations(2);
+
+  cache.Resolve(Start, MakePath({"a"}));
+  const OpcUa::Node node = cache.Resolve(Start, MakePath({"a", "b", "c"}));
+
+  ASSERT_EQ(node.GetId(), OpcUa::NumericNodeID(1123, 1));
+  ASSERT_EQ(Requests.size(), 2u);
+  ASSERT_EQ(Requests[1].BrowsePaths.size(), 2u);
+  ASSERT_EQ(Requests[1].BrowsePaths[1].StartingNode, OpcUa::NumericNodeID(11, 1));
+  ASSERT_EQ(Names(Requests[1].BrowsePaths[1]), std::vector<std::string>({"b", "c"}));
+  ASSERT_EQ(cache.Size(), 3u);
+}
+
+TEST_F(BrowsePathCacheTest, TranslatesFromPrefixResolvedWithOtherPath)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  ExpectTranslations(2);
+
+  cache.Resolve(Start, MakePath({"a", "b", "c"}));
+  const OpcUa::Node node = cache.Resolve(Start, MakePath({"a", "b", "a"}));
+
+  // Shared prefix a/b was resolved by the first call.
+  ASSERT_EQ(node.GetId(), OpcUa::NumericNodeID(1121, 1));
+  ASSERT_EQ(Requests[1].BrowsePaths.size(), 1u);
+  ASSERT_EQ(Requests[1].BrowsePaths[0].StartingNode, OpcUa::NumericNodeID(112, 1));
+  ASSERT_EQ(Names(Requests[1].BrowsePaths[0]), std::vector<std::string>({"a"}));
+  ASSERT_EQ(cache.Size(), 4u);
+}
+
+TEST_F(BrowsePathCacheTest, TranslatesSamePathsOnce)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  ExpectTranslations(1);
+
+  const std::vector<OpcUa::ChildSearchResult> results = cache.Resolve(Start, {MakePath({"a", "b"}), MakePath({"a", "c"}), MakePath({"a", "b"}), Path()});
+
+  // Prefix a is shared by both paths.
+  ASSERT_EQ(Requests[0].BrowsePaths.size(), 3u);
+  ASSERT_EQ(results.size(), 4u);
+  ASSERT_EQ(results[0].Target.GetId(), OpcUa::NumericNodeID(112, 1));
+  ASSERT_EQ(results[1].Target.GetId(), OpcUa::NumericNodeID(113, 1));
+  ASSERT_EQ(results[2].Target.GetId(), OpcUa::NumericNodeID(112, 1));
+  ASSERT_EQ(results[3].Status, OpcUa::StatusCode::Good);
+  ASSERT_EQ(results[3].Target.GetId(), Start);
+}
+
+TEST_F(BrowsePathCacheTest, SplitsRequestsIntoChunks)
+{
+  OpcUa::BrowsePathCache cache(Server, 2);
+  ExpectTranslations(3);
+
+  const std::vector<OpcUa::ChildSearchResult> results = cache.Resolve(Start, {MakePath({"a"}), MakePath({"b"}), MakePath({"c"}), MakePath({"a", "a"}), MakePath({"x"})});
+
+  ASSERT_EQ(Requests[0].BrowsePaths.size(), 2u);
+  ASSERT_EQ(Requests[1].BrowsePaths.size(), 2u);
+  ASSERT_EQ(Requests[2].BrowsePaths.size(), 1u);
+  ASSERT_EQ(results[3].Target.GetId(), OpcUa::NumericNodeID(111, 1));
+  ASSERT_EQ(results[4].Status, OpcUa::StatusCode::BadNoMatch);
+}
+
+TEST_F(BrowsePathCacheTest, DoesNotCacheNotFoundPaths)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  ExpectTranslations(2);
+
+  ASSERT_EQ(cache.Resolve(Start, std::vector<Path>(1, MakePath({"a", "x"}))).front().Status, OpcUa::StatusCode::BadNoMatch);
+  ASSERT_THROW(cache.Resolve(Start, MakePath({"a", "x"})), OpcUa::NodeNotFoundException);
+  // Only the found prefix is cached.
+  ASSERT_EQ(cache.Size(), 1u);
+}
+
+TEST_F(BrowsePathCacheTest, InvalidatesPrefix)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  ExpectTranslations(4);
+
+  cache.Resolve(Start, {MakePath({"a"}), MakePath({"b"})});
+  cache.Resolve(Start, MakePath({"a", "b"}));
+  cache.Resolve(Start, MakePath({"b", "c"}));
+  ASSERT_EQ(cache.Size(), 4u);
+
+  cache.Invalidate(Start, MakePath({"a"}));
+  ASSERT_EQ(cache.Size(), 2u);
+
+  // Path under the invalidated prefix is translated again from the starting node.
+  cache.Resolve(Start, {MakePath({"a", "b"}), MakePath({"b", "c"})});
+  ASSERT_EQ(Requests[3].BrowsePaths.size(), 2u);
+  ASSERT_EQ(Requests[3].BrowsePaths[1].StartingNode, Start);
+  ASSERT_EQ(Names(Requests[3].BrowsePaths[1]), std::vector<std::string>({"a", "b"}));
+}
+
+TEST_F(BrowsePathCacheTest, InvalidatesStartingNodeAndClears)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  ExpectTranslations(2);
+
+  const OpcUa::NodeID other = OpcUa::NumericNodeID(2, 1);
+  cache.Resolve(Start, MakePath({"a"}));
+  cache.Resolve(other, MakePath({"a"}));
+  ASSERT_EQ(cache.Size(), 2u);
+
+  cache.Invalidate(Start);
+  ASSERT_EQ(cache.Size(), 1u);
+  cache.Clear();
+  ASSERT_EQ(cache.Size(), 0u);
+}
+
+TEST_F(BrowsePathCacheTest, DoesNotCacheTranslationsStartedBeforeInvalidation)
+{
+  OpcUa::BrowsePathCache cache(Server);
+  EXPECT_CALL(*Server->ViewsMock, TranslateBrowsePathsToNodeIds(_))
+    .WillOnce(Invoke([&cache, this](const OpcUa::TranslateBrowsePathsParameters& params)
+    {
+      // Cache is not locked while server is called.
+      cache.Invalidate(Start);
+      return Translate(params);
+    }))
+    .WillOnce(Invoke(Translate));
+
+  ASSERT_EQ(cache.Resolve(Start, MakePath({"a"})).GetId(), OpcUa::NumericNodeID(11, 1));
+  ASSERT_EQ(cache.Size(), 0u);
+  ASSERT_EQ(cache.Resolve(Start, MakePath({"a"})).GetId(), OpcUa::NumericNodeID(11, 1));
+  ASSERT_EQ(cache.Size(), 1u);
+}
@@ -0,0 +1,82 @@
+/// @brief Tests of OpcUa::BufferedChannel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/buffered_channel.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <sys/socket.h>
+
+namespace
+{
+
+  class BufferedChannelTest : public ::testing::Test
+  {
+  protected:
+    virtual void SetUp()
+    {
+      int fds[2] = {-1, -1};
+      ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+      Client.reset(new OpcUa::SocketChannel(fds[0]));
+      Server.reset(new OpcUa::BufferedChannel(std::make_shared<OpcUa::SocketChannel>(fds[1]), 16));
+    }
+
+  protected:
+    std::unique_ptr<OpcUa::SocketChannel> Client;
+    std::unique_ptr<OpcUa::BufferedChannel> Server;
+  };
+
+}
+
+TEST_F(BufferedChannelTest, SmallReadsAreServedFromBuffer)
+{
+  Client->Send("0123456789", 10);
+
+  char data[2] = {0};
+  for (int i = 0; i < 5; ++i)
+  {
+    ASSERT_EQ(Server->Receive(data, sizeof(data)), sizeof(data));
+    ASSERT_EQ(data[0], '0' + 2 * i);
+    ASSERT_EQ(data[1], '1' + 2 * i);
+  }
+  ASSERT_EQ(Server->GetFillCount(), 1u);
+  ASSERT_EQ(Server->Available(), 0u);
+}
+
+TEST_F(BufferedChannelTest, BigReadsBypassBuffer)
+{
+  const std::string message = "ab" + std::string(100, 'x');
+  Client->Send(message.data(), message.size());
+
+  char head[2] = {0};
+  Server->Receive(head, sizeof(head));
+  std::string rest(message.size() - 2, 0);
+  Server->Receive(&rest[0], rest.size());
+  ASSERT_EQ(std::string(head, 2) + rest, message);
+}
+
+TEST_F(BufferedChannelTest, PeekDoesNotConsume)
+{
+  Client->Send("abcdef", 6);
+
+  ASSERT_EQ(std::string(Server->Peek(3), 3), "abc");
+  ASSERT_EQ(std::string(Server->Peek(3), 3), "abc");
+  Server->Consume(3);
+  ASSERT_EQ(std::string(Server->Peek(3), 3), "def");
+  ASSERT_THROW(Server->Peek(17), std::length_error);
+}
+
+TEST_F(BufferedChannelTest, PeekMovesTailToKeepDataContiguous)
+{
+  Client->Send("0123456789abcdef", 16);
+  Server->Peek(16);
+  Server->Consume(12);
+  Client->Send("ghij", 4);
+  ASSERT_EQ(std::string(Server->Peek(8), 8), "cdefghij");
+}
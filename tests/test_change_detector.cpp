@@ -0,0 +1,211 @@
+/// @brief Tests of change detection kernels.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/change_detector.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace
+{
+
+  bool IsSet(const std::vector<uint64_t>& bitmap, std::size_t i)
+  {
+    return bitmap[i / 64] & (uint64_t(1) << (i % 64));
+  }
+
+}
+
+TEST(ChangeDetection, DoubleKernelMatchesScalarComparison)
+{
+  const std::size_t count = 1001;
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> values(-10, 10);
+  std::vector<double> last(count);
+  std::vector<double> current(count);
+  std::vector<double> thresholds(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    last[i] = values(random);
+    current[i] = i % 3 ? last[i] + values(random) / 10 : last[i];
+    thresholds[i] = i % 2 ? 0 : 0.5;
+  }
+  last[10] = std::numeric_limits<double>::quiet_NaN();
+  current[11] = std::numeric_limits<double>::quiet_NaN();
+  last[12] = current[12] = std::numeric_limits<double>::quiet_NaN();
+
+  std::vector<uint64_t> bitmap((count + 63) / 64, 0);
+  OpcUa::DetectChanges(last.data(), current.data(), thresholds.data(), count, bitmap.data());
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const bool nanChanged = std::isnan(last[i]) != std::isnan(current[i]);
+    const bool expected = nanChanged || std::fabs(current[i] - last[i]) > thresholds[i];
+    ASSERT_EQ(IsSet(bitmap, i), expected) << "item " << i;
+  }
+  ASSERT_TRUE(IsSet(bitmap, 10));
+  ASSERT_TRUE(IsSet(bitmap, 11));
+  ASSERT_FALSE(IsSet(bitmap, 12));
+  // Bits after the last item are not touched.
+  ASSERT_EQ(bitmap.back() >> (count % 64), 0u);
+}
+
+TEST(ChangeDetection, IntegerKernelDetectsChangesBeyondDoublePrecision)
+{
+  const int64_t big = int64_t(1) << 60;
+  const std::vector<int64_t> last = {big, 5, 5, std::numeric_limits<int64_t>::min(), 7};
+  const std::vector<int64_t> current = {big + 1, 5, 9, std::numeric_limits<int64_t>::max(), 8};
+  const std::vector<double> thresholds = {0, 0, 3, 0, 1};
+
+  std::vector<uint64_t> bitmap(1, 0);
+  OpcUa::DetectChanges(last.data(), current.data(), thresholds.data(), last.size(), bitmap.data());
+
+  ASSERT_TRUE(IsSet(bitmap, 0));
+  ASSERT_FALSE(IsSet(bitmap, 1));
+  ASSERT_TRUE(IsSet(bitmap, 2));
+  ASSERT_TRUE(IsSet(bitmap, 3));
+  ASSERT_FALSE(IsSet(bitmap, 4));
+}
+
+TEST(ChangeDetection, UnsignedKernelComputesDifferenceAcrossSignBit)
+{
+  const uint64_t middle = uint64_t(1) << 63;
+  const std::vector<uint64_t> last = {middle - 1, middle - 1, 0, std::numeric_limits<uint64_t>::max()};
+  const std::vector<uint64_t> current = {middle, middle + 1, std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max()};
+  const std::vector<double> thresholds = {0, 5, 0, 0};
+
+  std::vector<uint64_t> bitmap(1, 0);
+  OpcUa::DetectChanges(last.data(), current.data(), thresholds.data(), last.size(), bitmap.data());
+
+  ASSERT_TRUE(IsSet(bitmap, 0));
+  ASSERT_FALSE(IsSet(bitmap, 1));
+  ASSERT_TRUE(IsSet(bitmap, 2));
+  ASSERT_FALSE(IsSet(bitmap, 3));
+}
+
+namespace
+{
+
+  OpcUa::DataValue MakeValue(const OpcUa::Variant& value, OpcUa::StatusCode status = OpcUa::StatusCode::Good)
+  {
+    OpcUa::DataValue result(value);
+    result.Status = status;
+    return result;
+  }
+
+  // Detect one value per item and return indexes of changed items.
+  std::vector<std::size_t> Detect(OpcUa::ChangeDetector& detector, const std::vector<OpcUa::DataValue>& values)
+  {
+    std::vector<uint64_t> bitmap;
+    detector.Detect(values, bitmap);
+    std::vector<std::size_t> changed;
+    for (std::size_t i = 0; i < detector.Size(); ++i)
+    {
+      if (IsSet(bitmap, i))
+      {
+        changed.push_back(i);
+      }
+    }
+    return changed;
+  }
+
+  typedef std::vector<std::size_t> Indexes;
+
+}
+
+TEST(ChangeDetector, ReportsFirstValueAndStatusChanges)
+{
+  OpcUa::ChangeDetector detector;
+  detector.Add();
+  detector.Add();
+
+  ASSERT_EQ(Detect(detector, {MakeValue(1.0), MakeValue(std::string("a"))}), Indexes({0, 1}));
+  ASSERT_EQ(Detect(detector, {MakeValue(1.0), MakeValue(std::string("a"))}), Indexes());
+  ASSERT_EQ(Detect(detector, {MakeValue(1.0), MakeValue(std::string("b"))}), Indexes({1}));
+  ASSERT_EQ(Detect(detector, {MakeValue(1.0, OpcUa::StatusCode::BadNodeIdUnknown), MakeValue(std::string("b"))}), Indexes({0}));
+  // Items the server did not answer for are not changed.
+  ASSERT_EQ(Detect(detector, {MakeValue(1.0)}), Indexes({0}));
+}
+
+TEST(ChangeDetector, AbsoluteDeadbandKeepsBaseValue)
+{
+  OpcUa::DeadbandFilter filter;
+  filter.Type = OpcUa::DeadbandType::Absolute;
+  filter.Value = 1;
+  OpcUa::ChangeDetector detector;
+  detector.Add(filter);
+  detector.Add(filter);
+
+  ASSERT_EQ(Detect(detector, {MakeValue(10.0), MakeValue(int64_t(10))}), Indexes({0, 1}));
+  ASSERT_EQ(Detect(detector, {MakeValue(10.6), MakeValue(int64_t(11))}), Indexes());
+  // Changes inside deadband do not move the base, so small steps add up.
+  ASSERT_EQ(Detect(detector, {MakeValue(11.2), MakeValue(int64_t(12))}), Indexes({0, 1}));
+  ASSERT_EQ(Detect(detector, {MakeValue(10.5), MakeValue(int64_t(11))}), Indexes());
+}
+
+TEST(ChangeDetector, PercentDeadbandUsesEngineeringRange)
+{
+  OpcUa::DeadbandFilter filter;
+  filter.Type = OpcUa::DeadbandType::Percent;
+  filter.Value = 10;
+  filter.Low = -100;
+  filter.High = 100;
+  OpcUa::ChangeDetector detector;
+  detector.Add(filter);
+
+  ASSERT_EQ(Detect(detector, {MakeValue(int32_t(0))}), Indexes({0}));
+  ASSERT_EQ(Detect(detector, {MakeValue(int32_t(20))}), Indexes());
+  ASSERT_EQ(Detect(detector, {MakeValue(int32_t(21))}), Indexes({0}));
+}
+
+TEST(ChangeDetector, ReportsTypeChanges)
+{
+  OpcUa::ChangeDetector detector;
+  detector.Add();
+  detector.Add();
+  detector.Add();
+
+  ASSERT_EQ(Detect(detector, {MakeValue(int32_t(5)), MakeValue(int64_t(5)), MakeValue(std::string("5"))}), Indexes({0, 1, 2}));
+  ASSERT_EQ(Detect(detector, {MakeValue(5.0), MakeValue(uint64_t(5)), MakeValue(int32_t(5))}), Indexes({0, 1, 2}));
+  ASSERT_EQ(Detect(detector, {MakeValue(5.0), MakeValue(uint64_t(5)), MakeValue(int32_t(5))}), Indexes());
+}
+
+TEST(ChangeDetector, ComparesUnsignedValuesAcrossSignBit)
+{
+  OpcUa::DeadbandFilter filter;
+  filter.Type = OpcUa::DeadbandType::Absolute;
+  filter.Value = 5;
+  OpcUa::ChangeDetector detector;
+  detector.Add(filter);
+  detector.Add();
+
+  const uint64_t middle = uint64_t(1) << 63;
+  ASSERT_EQ(Detect(detector, {MakeValue(middle - 1), MakeValue(middle - 1)}), Indexes({0, 1}));
+  ASSERT_EQ(Detect(detector, {MakeValue(middle + 1), MakeValue(middle - 1)}), Indexes());
+  ASSERT_EQ(Detect(detector, {MakeValue(middle + 10), MakeValue(middle)}), Indexes({0, 1}));
+}
+
+TEST(ChangeDetector, RemoveMovesLastItem)
+{
+  OpcUa::DeadbandFilter filter;
+  filter.Type = OpcUa::DeadbandType::Absolute;
+  filter.Value = 100;
+  OpcUa::ChangeDetector detector;
+  detector.Add();
+  detector.Add(filter);
+  Detect(detector, {MakeValue(1.0), MakeValue(1.0)});
+
+  detector.Remove(0);
+  ASSERT_EQ(detector.Size(), 1u);
+  // The moved item keeps its deadband and last value.
+  ASSERT_EQ(Detect(detector, {MakeValue(50.0)}), Indexes());
+  ASSERT_EQ(Detect(detector, {MakeValue(102.0)}), Indexes({0}));
+}
@@ -0,0 +1,386 @@
+/// @brief Tests of OpcUa::Node and batch helpers of node layer.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include "mock_server.h"
+
+#include <opc/ua/browse_path_cache.h>
+#include <opc/ua/node.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+using namespace testing;
+using namespace OpcCoreTests;
+
+namespace
+{
+
+  OpcUa::NodeID MakeID(uint32_t id)
+  {
+    return OpcUa::NumericNodeID(id, 1);
+  }
+
+  OpcUa::ReferenceDescription MakeReference(uint32_t target)
+  {
+    OpcUa::ReferenceDescription ref;
+    ref.ReferenceTypeID = OpcUa::ReferenceID::Organizes;
+    ref.IsForward = true;
+    ref.TargetNodeID = MakeID(target);
+    ref.BrowseName = OpcUa::QualifiedName(1, std::to_string(target));
+    ref.TargetNodeClass = OpcUa::NodeClass::Object;
+    ref.TargetNodeTypeDefinition = OpcUa::ObjectID::FolderType;
+    return ref;
+  }
+
+  // Address space of numeric nodes: node -> children.
+  typedef std::map<uint32_t, std::vector<uint32_t>> Tree;
+
+  std::vector<std::vector<OpcUa::ReferenceDescription>> BrowseTree(const Tree& tree, const OpcUa::NodesQuery& query)
+  {
+    std::vector<std::vector<OpcUa::ReferenceDescription>> result;
+    for (const OpcUa::BrowseDescription& description : query.NodesToBrowse)
+    {
+      std::vector<OpcUa::ReferenceDescription> refs;
+      const Tree::const_iterator nodeIt = tree.find(description.NodeToBrowse.GetIntegerIdentifier());
+      if (nodeIt != tree.end())
+      {
+        for (uint32_t child : nodeIt->second)
+        {
+          refs.push_back(MakeReference(child));
+        }
+      }
+      result.push_back(refs);
+    }
+    return result;
+  }
+
+  std::vector<uint32_t> BrowsedNodes(const OpcUa::NodesQuery& query)
+  {
+    std::vector<uint32_t> nodes;
+    for (const OpcUa::BrowseDescription& description : query.NodesToBrowse)
+    {
+      nodes.push_back(description.NodeToBrowse.GetIntegerIdentifier());
+    }
+    return nodes;
+  }
+
+}
+
+class NodeTest : public Test
+{
+protected:
+  virtual void SetUp()
+  {
+    Server.reset(new MockServer);
+  }
+
+protected:
+  MockServer::SharedPtr Server;
+};
+
+TEST_F(NodeTest, BrowsesWholeLevelWithOneRequest)
+{
+  const Tree tree = {{1, {11, 12}}, {11, {111, 1}}, {12, {111, 121}}, {111, {1111}}};
+  std::vector<OpcUa::NodesQuery> queries;
+  EXPECT_CALL(*Server->ViewsMock, BrowseNodes(_))
+    .Times(2)
+    .WillRepeatedly(Invoke([&](const OpcUa::NodesQuery& query)
+    {
+      queries.push_back(query);
+      return BrowseTree(tree, query);
+    }));
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .WillOnce(Return(std::vector<OpcUa::DataValue>(1, OpcUa::DataValue(static_cast<int32_t>(OpcUa::NodeClass::Object)))));
+
+  const OpcUa::Node root(Server, MakeID(1), OpcUa::QualifiedName(1, "1"));
+  const OpcUa::AddressSpaceSnapshot snapshot = root.BrowseRecursive(2);
+
+  ASSERT_EQ(BrowsedNodes(queries[0]), std::vector<uint32_t>({1}));
+  ASSERT_EQ(BrowsedNodes(queries[1]), std::vector<uint32_t>({11, 12}));
+
+  // Nodes are in breadth first order, every node once. Nodes of the last level are not browsed.
+  std::vector<uint32_t> nodes;
+  for (const OpcUa::AddressSpaceSnapshot::NodeData& node : snapshot.Nodes)
+  {
+    nodes.push_back(node.Id.GetIntegerIdentifier());
+  }
+  ASSERT_EQ(nodes, std::vector<uint32_t>({1, 11, 12, 111, 121}));
+  ASSERT_EQ(snapshot.Nodes[0].Class, OpcUa::NodeClass::Object);
+  ASSERT_EQ(snapshot.Nodes[2].BrowseName, OpcUa::QualifiedName(1, "12"));
+  ASSERT_EQ(snapshot.Nodes[2].Class, OpcUa::NodeClass::Object);
+  ASSERT_EQ(snapshot.Nodes[4].Depth, 2u);
+
+  // References of 11 are: 11 -> 111 and the loop 11 -> 1.
+  ASSERT_EQ(snapshot.References.size(), 6u);
+  ASSERT_EQ(snapshot.References[2].Source, 1u);
+  ASSERT_EQ(snapshot.References[2].Target, 3u);
+  ASSERT_EQ(snapshot.References[3].Source, 1u);
+  ASSERT_EQ(snapshot.References[3].Target, 0u);
+  ASSERT_EQ(snapshot.References[4].Source, 2u);
+  ASSERT_EQ(snapshot.References[4].Target, 3u);
+}
+
+TEST_F(NodeTest, ChildrenHaveNamesFromReferences)
+{
+  const Tree tree = {{1, {11, 12}}};
+  EXPECT_CALL(*Server->ViewsMock, BrowseNodes(_))
+    .WillOnce(Invoke([&](const OpcUa::NodesQuery& query)
+    {
+      return BrowseTree(tree, query);
+    }));
+
+  // Strict mock fails the test if names are read from the server.
+  const std::vector<OpcUa::Node> children = OpcUa::Node(Server, MakeID(1)).GetChildren();
+  ASSERT_EQ(children.size(), 2u);
+  ASSERT_EQ(children[1].GetId(), MakeID(12));
+  ASSERT_EQ(children[1].GetName(), OpcUa::QualifiedName(1, "12"));
+}
+
+TEST_F(NodeTest, DefaultBrowseNodesFollowsContinuationOfEveryNode)
+{
+  InSequence sequence;
+  EXPECT_CALL(*Server->ViewsMock, Browse(_))
+    .WillOnce(Invoke([](const OpcUa::NodesQuery& query)
+    {
+      EXPECT_EQ(BrowsedNodes(query), std::vector<uint32_t>({1}));
+      return std::vector<OpcUa::ReferenceDescription>({MakeReference(11), MakeReference(12)});
+    }));
+  EXPECT_CALL(*Server->ViewsMock, BrowseNext())
+    .WillOnce(Return(std::vector<OpcUa::ReferenceDescription>({MakeReference(13)})));
+  EXPECT_CALL(*Server->ViewsMock, BrowseNext())
+    .WillOnce(Return(std::vector<OpcUa::ReferenceDescription>()));
+  EXPECT_CALL(*Server->ViewsMock, Browse(_))
+    .WillOnce(Invoke([](const OpcUa::NodesQuery& query)
+    {
+      EXPECT_EQ(BrowsedNodes(query), std::vector<uint32_t>({2}));
+      return std::vector<OpcUa::ReferenceDescription>();
+    }));
+
+  OpcUa::NodesQuery query;
+  query.NodesToBrowse.resize(2);
+  query.NodesToBrowse[0].NodeToBrowse = MakeID(1);
+  query.NodesToBrowse[1].NodeToBrowse = MakeID(2);
+  const std::vector<std::vector<OpcUa::ReferenceDescription>> refs = Server->ViewsMock->OpcUa::Remote::ViewServices::BrowseNodes(query);
+
+  ASSERT_EQ(refs.size(), 2u);
+  ASSERT_EQ(refs[0].size(), 3u);
+  ASSERT_EQ(refs[0][2].TargetNodeID, MakeID(13));
+  ASSERT_TRUE(refs[1].empty());
+}
+
+TEST_F(NodeTest, ResolvesStringPathsWithNamespaceOfParent)
+{
+  std::vector<OpcUa::TranslateBrowsePathsParameters> requests;
+  EXPECT_CALL(*Server->ViewsMock, TranslateBrowsePathsToNodeIds(_))
+    .Times(2)
+    .WillRepeatedly(Invoke([&requests](const OpcUa::TranslateBrowsePathsParameters& params)
+    {
+      requests.push_back(params);
+      return std::vector<OpcUa::BrowsePathResult>(params.BrowsePaths.size());
+    }));
+
+  const OpcUa::Node node(Server, MakeID(1), OpcUa::QualifiedName(3, "1"));
+  const std::vector<OpcUa::ChildSearchResult> results = node.GetChildren({{"a", "2:b", "c"}, {"d"}, {"e"}}, 2);
+
+  ASSERT_EQ(results.size(), 3u);
+  ASSERT_EQ(requests[0].BrowsePaths.size(), 2u);
+  ASSERT_EQ(requests[1].BrowsePaths.size(), 1u);
+  // Elements without namespace inherit namespace of the previous element.
+  const std::vector<OpcUa::RelativePathElement>& elements = requests[0].BrowsePaths[0].Path.Elements;
+  ASSERT_EQ(elements[0].TargetName, OpcUa::QualifiedName(3, "a"));
+  ASSERT_EQ(elements[1].TargetName, OpcUa::QualifiedName(2, "b"));
+  ASSERT_EQ(elements[2].TargetName, OpcUa::QualifiedName(2, "c"));
+}
+
+TEST_F(NodeTest, ResolvesParsedPathsThroughCache)
+{
+  EXPECT_CALL(*Server->ViewsMock, TranslateBrowsePathsToNodeIds(_))
+    .WillOnce(Invoke([](const OpcUa::TranslateBrowsePathsParameters& params)
+    {
+      std::vector<OpcUa::BrowsePathResult> results(params.BrowsePaths.size());
+      for (OpcUa::BrowsePathResult& result : results)
+      {
+        result.Status = OpcUa::StatusCode::Good;
+        result.Targets.resize(1);
+        result.Targets[0].Node = MakeID(2);
+      }
+      return results;
+    }));
+
+  OpcUa::BrowsePathCache cache(Server);
+  // Node without name: namespace is not needed for parsed paths, so the name is not read.
+  const OpcUa::Node node(Server, MakeID(1));
+  const std::vector<std::vector<OpcUa::QualifiedName>> paths(1, std::vector<OpcUa::QualifiedName>(1, OpcUa::QualifiedName(1, "a")));
+
+  ASSERT_EQ(node.GetChildren(paths, cache)[0].Target.GetId(), MakeID(2));
+  ASSERT_EQ(node.GetChildren(paths, cache)[0].Target.GetId(), MakeID(2));
+}
+
+TEST_F(NodeTest, ReadsNameOnce)
+{
+  OpcUa::DataValue name(OpcUa::QualifiedName(2, "name"));
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .WillOnce(Return(std::vector<OpcUa::DataValue>(1, name)));
+
+  const OpcUa::Node node(Server, MakeID(1));
+  ASSERT_EQ(node.GetName(), OpcUa::QualifiedName(2, "name"));
+  ASSERT_EQ(node.GetName(), OpcUa::QualifiedName(2, "name"));
+
+  // Copies keep resolved name.
+  OpcUa::Node copy(Server, MakeID(2));
+  copy = node;
+  ASSERT_EQ(OpcUa::Node(node).GetName(), OpcUa::QualifiedName(2, "name"));
+  ASSERT_EQ(copy.GetName(), OpcUa::QualifiedName(2, "name"));
+}
+
+TEST_F(NodeTest, ResolvesNameFromSeveralThreads)
+{
+  OpcUa::DataValue name(OpcUa::QualifiedName(2, "name"));
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .Times(Between(1, 4))
+    .WillRepeatedly(Return(std::vector<OpcUa::DataValue>(1, name)));
+
+  const OpcUa::Node node(Server, MakeID(1));
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < 4; ++i)
+  {
+    threads.push_back(std::thread([&node]()
+    {
+      EXPECT_EQ(node.GetName(), OpcUa::QualifiedName(2, "name"));
+    }));
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+}
+
+TEST_F(NodeTest, ReadsAttributesInChunks)
+{
+  std::vector<OpcUa::ReadParameters> reads;
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .Times(3)
+    .WillRepeatedly(Invoke([&reads](const OpcUa::ReadParameters& params)
+    {
+      reads.push_back(params);
+      std::vector<OpcUa::DataValue> values;
+      for (const OpcUa::AttributeValueID& attribute : params.AttributesToRead)
+      {
+        values.push_back(OpcUa::DataValue(static_cast<int32_t>(attribute.Node.GetIntegerIdentifier())));
+      }
+      return values;
+    }));
+
+  std::vector<OpcUa::Node> nodes;
+  for (uint32_t id = 1; id <= 5; ++id)
+  {
+    nodes.push_back(OpcUa::Node(Server, MakeID(id)));
+  }
+  const std::vector<OpcUa::DataValue> values = OpcUa::ReadAttributes(Server, nodes, OpcUa::AttributeID::DISPLAY_NAME, 2);
+
+  ASSERT_EQ(reads[0].AttributesToRead.size(), 2u);
+  ASSERT_EQ(reads[1].AttributesToRead.size(), 2u);
+  ASSERT_EQ(reads[2].AttributesToRead.size(), 1u);
+  ASSERT_EQ(reads[2].AttributesToRead[0].Node, MakeID(5));
+  ASSERT_EQ(reads[2].AttributesToRead[0].Attribute, OpcUa::AttributeID::DISPLAY_NAME);
+  ASSERT_EQ(values.size(), 5u);
+  for (uint32_t i = 0; i < values.size(); ++i)
+  {
+    ASSERT_EQ(values[i].Value, OpcUa::Variant(static_cast<int32_t>(i + 1)));
+  }
+}
+
+TEST_F(NodeTest, PadsMissingReadValuesWithError)
+{
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .WillOnce(Return(std::vector<OpcUa::DataValue>(1, OpcUa::DataValue(int32_t(1)))))
+    .WillOnce(Return(std::vector<OpcUa::DataValue>()));
+
+  const std::vector<OpcUa::Node> nodes = {OpcUa::Node(Server, MakeID(1)), OpcUa::Node(Server, MakeID(2)), OpcUa::Node(Server, MakeID(3))};
+  const std::vector<OpcUa::DataValue> values = OpcUa::ReadValues(Server, nodes, 2);
+
+  // Results stay aligned with nodes even if the server answered with less values,
+  // and a missing value is not mistaken for a good empty one.
+  ASSERT_EQ(values.size(), 3u);
+  ASSERT_EQ(values[0].Value, OpcUa::Variant(int32_t(1)));
+  for (std::size_t i = 1; i < values.size(); ++i)
+  {
+    ASSERT_EQ(values[i].Encoding, OpcUa::DATA_VALUE_STATUS_CODE);
+    ASSERT_EQ(values[i].Status, OpcUa::StatusCode::BadUnexpectedError);
+    ASSERT_EQ(values[i].Value.Type, OpcUa::VariantType::NUL);
+  }
+}
+
+TEST_F(NodeTest, ReadsAttributeOfNodeWithOneRequest)
+{
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .WillOnce(Return(std::vector<OpcUa::DataValue>(1, OpcUa::DataValue(int32_t(7)))));
+
+  ASSERT_EQ(OpcUa::Node(Server, MakeID(1)).GetValue(), OpcUa::Variant(int32_t(7)));
+}
+
+TEST_F(NodeTest, WritesAttributesInChunksAndPadsMissingStatuses)
+{
+  std::vector<std::vector<OpcUa::WriteValue>> writes;
+  EXPECT_CALL(*Server->AttributesMock, Write(_))
+    .WillOnce(Invoke([&writes](const std::vector<OpcUa::WriteValue>& values)
+    {
+      writes.push_back(values);
+      return std::vector<OpcUa::StatusCode>(values.size(), OpcUa::StatusCode::Good);
+    }))
+    .WillOnce(Invoke([&writes](const std::vector<OpcUa::WriteValue>& values)
+    {
+      writes.push_back(values);
+      return std::vector<OpcUa::StatusCode>();
+    }));
+
+  const std::vector<OpcUa::NodeAttributeValue> values = {
+    OpcUa::NodeAttributeValue(OpcUa::Node(Server, MakeID(1)), OpcUa::AttributeID::VALUE, int32_t(1)),
+    OpcUa::NodeAttributeValue(OpcUa::Node(Server, MakeID(2)), OpcUa::AttributeID::DISPLAY_NAME, int32_t(2)),
+    OpcUa::NodeAttributeValue(OpcUa::Node(Server, MakeID(3)), OpcUa::AttributeID::VALUE, int32_t(3))
+  };
+  const std::vector<OpcUa::StatusCode> codes = OpcUa::WriteAttributes(Server, values, 2);
+
+  ASSERT_EQ(writes[0].size(), 2u);
+  ASSERT_EQ(writes[0][1].Node, MakeID(2));
+  ASSERT_EQ(writes[0][1].Attribute, OpcUa::AttributeID::DISPLAY_NAME);
+  ASSERT_EQ(writes[0][1].Data.Value, OpcUa::Variant(int32_t(2)));
+  ASSERT_EQ(writes[1].size(), 1u);
+  // Items the server did not answer for are reported as not written.
+  ASSERT_EQ(codes, std::vector<OpcUa::StatusCode>({OpcUa::StatusCode::Good, OpcUa::StatusCode::Good, OpcUa::StatusCode::BadUnexpectedError}));
+}
+
+TEST_F(NodeTest, WritesValuesOfNodes)
+{
+  std::vector<OpcUa::WriteValue> written;
+  EXPECT_CALL(*Server->AttributesMock, Write(_))
+    .WillOnce(Invoke([&written](const std::vector<OpcUa::WriteValue>& values)
+    {
+      written = values;
+      return std::vector<OpcUa::StatusCode>(values.size(), OpcUa::StatusCode::Good);
+    }));
+
+  const std::vector<OpcUa::Node> nodes = {OpcUa::Node(Server, MakeID(1)), OpcUa::Node(Server, MakeID(2))};
+  const std::vector<OpcUa::StatusCode> codes = OpcUa::WriteValues(Server, nodes, {OpcUa::Variant(int32_t(10)), OpcUa::Variant(int32_t(20))});
+
+  ASSERT_EQ(codes.size(), 2u);
+  ASSERT_EQ(written.size(), 2u);
+  ASSERT_EQ(written[1].Node, MakeID(2));
+  ASSERT_EQ(written[1].Attribute, OpcUa::AttributeID::VALUE);
+  ASSERT_EQ(written[1].Data.Value, OpcUa::Variant(int32_t(20)));
+}
+
+TEST_F(NodeTest, DoesNotWriteValuesOfDifferentCount)
+{
+  // Strict mock fails the test if anything is written.
+  const std::vector<OpcUa::Node> nodes = {OpcUa::Node(Server, MakeID(1)), OpcUa::Node(Server, MakeID(2))};
+  ASSERT_THROW(OpcUa::WriteValues(Server, nodes, {OpcUa::Variant(int32_t(10))}), std::invalid_argument);
+}
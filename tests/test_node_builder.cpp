@@ -0,0 +1,200 @@
+/// @brief Tests of OpcUa::NodeBuilder.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include "mock_server.h"
+
+#include <opc/ua/node_builder.h>
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace OpcCoreTests;
+
+namespace
+{
+
+  std::vector<OpcUa::AddNodesResult> AddAll(const std::vector<OpcUa::AddNodesItem>& items)
+  {
+    std::vector<OpcUa::AddNodesResult> results(items.size());
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+      results[i].Status = OpcUa::StatusCode::Good;
+      results[i].AddedNodeID = items[i].RequestedNewNodeID;
+    }
+    return results;
+  }
+
+  OpcUa::AddReferencesItem MakeReference(uint32_t source, uint32_t target)
+  {
+    OpcUa::AddReferencesItem item;
+    item.SourceNodeID = OpcUa::NumericNodeID(source, 1);
+    item.ReferenceTypeId = OpcUa::ReferenceID::Organizes;
+    item.IsForward = true;
+    item.TargetNodeID = OpcUa::NumericNodeID(target, 1);
+    item.TargetNodeClass = OpcUa::NodeClass::Object;
+    return item;
+  }
+
+}
+
+class NodeBuilderTest : public Test
+{
+protected:
+  virtual void SetUp()
+  {
+    Server.reset(new MockServer);
+    Parent = OpcUa::NumericNodeID(1, 1);
+  }
+
+  void ExpectAddNodes(std::size_t calls)
+  {
+    EXPECT_CALL(*Server->NodeManagementMock, AddNodes(_))
+      .Times(calls)
+      .WillRepeatedly(Invoke([this](const std::vector<OpcUa::AddNodesItem>& items)
+      {
+        Nodes.push_back(items);
+        return AddAll(items);
+      }));
+  }
+
+protected:
+  MockServer::SharedPtr Server;
+  OpcUa::NodeID Parent;
+  std::vector<std::vector<OpcUa::AddNodesItem>> Nodes;
+};
+
+TEST_F(NodeBuilderTest, AddsNodesInChunks)
+{
+  OpcUa::NodeBuilder builder(Server, 2);
+  ExpectAddNodes(3);
+
+  const OpcUa::NodeID folder = builder.AddFolder(Parent, OpcUa::NumericNodeID(10, 1), OpcUa::QualifiedName(1, "folder"));
+  builder.AddVariable(folder, OpcUa::NumericNodeID(11, 1), OpcUa::QualifiedName(1, "first"), int32_t(1));
+  builder.AddVariable(folder, OpcUa::NumericNodeID(12, 1), OpcUa::QualifiedName(1, "second"), int32_t(2));
+  const OpcUa::NodeID property = builder.AddProperty(folder, OpcUa::QualifiedName(1, "property"), std::string("value"));
+  builder.AddVariable(folder, OpcUa::NumericNodeID(13, 1), OpcUa::QualifiedName(1, "third"), int32_t(3));
+
+  // Full chunks are sent at once, builder keeps only the rest.
+  ASSERT_EQ(Nodes.size(), 2u);
+  ASSERT_EQ(Nodes[0].size(), 2u);
+  ASSERT_EQ(Nodes[1].size(), 2u);
+  ASSERT_EQ(builder.Size(), 1u);
+
+  const OpcUa::NodeBuilderResult result = builder.Commit();
+  ASSERT_EQ(Nodes[2].size(), 1u);
+  ASSERT_EQ(result.Nodes.size(), 5u);
+  ASSERT_EQ(result.Nodes[3].AddedNodeID, property);
+  ASSERT_TRUE(result.References.empty());
+  ASSERT_EQ(builder.Size(), 0u);
+
+  // Generated ids are in the namespace of parent.
+  ASSERT_EQ(property.GetNamespaceIndex(), 1);
+}
+
+TEST_F(NodeBuilderTest, CreatesItemsWithAttributesOfNodeClass)
+{
+  OpcUa::NodeBuilder builder(Server);
+  ExpectAddNodes(1);
+
+  const OpcUa::NodeID folder = builder.AddFolder(Parent, OpcUa::NumericNodeID(10, 1), OpcUa::QualifiedName(1, "folder"));
+  builder.AddVariable(folder, OpcUa::NumericNodeID(11, 1), OpcUa::QualifiedName(1, "variable"), int32_t(5));
+  builder.AddProperty(folder, OpcUa::NumericNodeID(12, 1), OpcUa::QualifiedName(1, "property"), int32_t(6));
+  builder.Commit();
+
+  const OpcUa::AddNodesItem& folderItem = Nodes[0][0];
+  ASSERT_EQ(folderItem.ParentNodeId, Parent);
+  ASSERT_EQ(folderItem.ReferenceTypeId, OpcUa::NodeID(OpcUa::ReferenceID::Organizes));
+  ASSERT_EQ(folderItem.Class, OpcUa::NodeClass::Object);
+  ASSERT_EQ(folderItem.TypeDefinition, OpcUa::NodeID(OpcUa::ObjectID::FolderType));
+  ASSERT_EQ(folderItem.Attributes.Attributes.count(OpcUa::AttributeID::VALUE), 0u);
+
+  const OpcUa::AddNodesItem& variableItem = Nodes[0][1];
+  ASSERT_EQ(variableItem.ParentNodeId, folder);
+  ASSERT_EQ(variableItem.ReferenceTypeId, OpcUa::NodeID(OpcUa::ReferenceID::HasComponent));
+  ASSERT_EQ(variableItem.Class, OpcUa::NodeClass::Variable);
+  ASSERT_EQ(variableItem.TypeDefinition, OpcUa::NodeID(OpcUa::ObjectID::BaseDataVariableType));
+  ASSERT_EQ(variableItem.Attributes.Attributes.at(OpcUa::AttributeID::VALUE), OpcUa::Variant(int32_t(5)));
+  ASSERT_EQ(variableItem.Attributes.Attributes.at(OpcUa::AttributeID::BROWSE_NAME), OpcUa::Variant(OpcUa::QualifiedName(1, "variable")));
+
+  const OpcUa::AddNodesItem& propertyItem = Nodes[0][2];
+  ASSERT_EQ(propertyItem.ReferenceTypeId, OpcUa::NodeID(OpcUa::ReferenceID::HasProperty));
+  ASSERT_EQ(propertyItem.TypeDefinition, OpcUa::NodeID(OpcUa::ObjectID::PropertyType));
+  ASSERT_EQ(propertyItem.Attributes.Attributes.at(OpcUa::AttributeID::VALUE), OpcUa::Variant(int32_t(6)));
+}
+
+TEST_F(NodeBuilderTest, AddsReferencesAfterNodes)
+{
+  OpcUa::NodeBuilder builder(Server, 2);
+  std::vector<std::vector<OpcUa::AddReferencesItem>> references;
+  {
+    InSequence sequence;
+    EXPECT_CALL(*Server->NodeManagementMock, AddNodes(_))
+      .WillOnce(Invoke(AddAll));
+    EXPECT_CALL(*Server->NodeManagementMock, AddReferences(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&references](const std::vector<OpcUa::AddReferencesItem>& items)
+      {
+        references.push_back(items);
+        return std::vector<OpcUa::StatusCode>(items.size(), OpcUa::StatusCode::Good);
+      }));
+  }
+
+  builder.AddFolder(Parent, OpcUa::NumericNodeID(10, 1), OpcUa::QualifiedName(1, "folder"));
+  builder.AddReference(MakeReference(10, 2));
+  builder.AddReference(MakeReference(10, 3));
+  builder.AddReference(MakeReference(10, 4));
+  const OpcUa::NodeBuilderResult result = builder.Commit();
+
+  ASSERT_EQ(references[0].size(), 2u);
+  ASSERT_EQ(references[1].size(), 1u);
+  ASSERT_EQ(references[1][0].TargetNodeID, OpcUa::NumericNodeID(4, 1));
+  ASSERT_EQ(result.References.size(), 3u);
+}
+
+TEST_F(NodeBuilderTest, PadsMissingResults)
+{
+  OpcUa::NodeBuilder builder(Server, 2);
+  EXPECT_CALL(*Server->NodeManagementMock, AddNodes(_))
+    .WillOnce(Return(std::vector<OpcUa::AddNodesResult>()))
+    .WillOnce(Invoke(AddAll));
+
+  builder.AddFolder(Parent, OpcUa::NumericNodeID(10, 1), OpcUa::QualifiedName(1, "first"));
+  builder.AddFolder(Parent, OpcUa::NumericNodeID(11, 1), OpcUa::QualifiedName(1, "second"));
+  builder.AddFolder(Parent, OpcUa::NumericNodeID(12, 1), OpcUa::QualifiedName(1, "third"));
+  const OpcUa::NodeBuilderResult result = builder.Commit();
+
+  // Results stay aligned with nodes even if the server answered with less results.
+  ASSERT_EQ(result.Nodes.size(), 3u);
+  ASSERT_EQ(result.Nodes[0].Status, OpcUa::StatusCode::BadUnexpectedError);
+  ASSERT_EQ(result.Nodes[1].Status, OpcUa::StatusCode::BadUnexpectedError);
+  ASSERT_EQ(result.Nodes[2].AddedNodeID, OpcUa::NumericNodeID(12, 1));
+}
+
+TEST_F(NodeBuilderTest, PadsMissingReferenceResults)
+{
+  OpcUa::NodeBuilder builder(Server, 2);
+  EXPECT_CALL(*Server->NodeManagementMock, AddReferences(_))
+    .WillOnce(Return(std::vector<OpcUa::StatusCode>(1, OpcUa::StatusCode::Good)))
+    .WillOnce(Return(std::vector<OpcUa::StatusCode>()));
+
+  builder.AddReference(MakeReference(10, 2));
+  builder.AddReference(MakeReference(10, 3));
+  builder.AddReference(MakeReference(10, 4));
+  const OpcUa::NodeBuilderResult result = builder.Commit();
+
+  ASSERT_EQ(result.References, std::vector<OpcUa::StatusCode>({OpcUa::StatusCode::Good, OpcUa::StatusCode::BadUnexpectedError, OpcUa::StatusCode::BadUnexpectedError}));
+}
+
+TEST_F(NodeBuilderTest, DoesNotCallServerWhenEmpty)
+{
+  // Strict mock fails the test if server is called.
+  OpcUa::NodeBuilder builder(Server);
+  const OpcUa::NodeBuilderResult result = builder.Commit();
+  ASSERT_TRUE(result.Nodes.empty());
+  ASSERT_TRUE(result.References.empty());
+}
@@ -0,0 +1,236 @@
+/// @brief Tests of OpcUa::NodeTemplate.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include "mock_server.h"
+
+#include <opc/ua/node_template.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <stdexcept>
+
+using namespace testing;
+using namespace OpcCoreTests;
+
+namespace
+{
+
+  OpcUa::NodeID MakeID(uint32_t id)
+  {
+    return OpcUa::NumericNodeID(id, 1);
+  }
+
+  struct TestNode
+  {
+    OpcUa::NodeClass Class;
+    OpcUa::ReferenceID Reference;
+    std::vector<uint32_t> Children;
+  };
+
+  // Address space of numeric nodes, variables have their id as value.
+  typedef std::map<uint32_t, TestNode> AddressSpace;
+
+  std::vector<std::vector<OpcUa::ReferenceDescription>> Browse(const AddressSpace& space, const OpcUa::NodesQuery& query)
+  {
+    std::vector<std::vector<OpcUa::ReferenceDescription>> result;
+    for (const OpcUa::BrowseDescription& description : query.NodesToBrowse)
+    {
+      std::vector<OpcUa::ReferenceDescription> refs;
+      for (uint32_t child : space.at(description.NodeToBrowse.GetIntegerIdentifier()).Children)
+      {
+        const TestNode& node = space.at(child);
+        OpcUa::ReferenceDescription ref;
+        ref.ReferenceTypeID = node.Reference;
+        ref.IsForward = true;
+        ref.TargetNodeID = MakeID(child);
+        ref.BrowseName = OpcUa::QualifiedName(1, std::to_string(child));
+        ref.TargetNodeClass = node.Class;
+        refs.push_back(ref);
+      }
+      result.push_back(refs);
+    }
+    return result;
+  }
+
+  std::vector<OpcUa::DataValue> Read(const AddressSpace& space, const OpcUa::ReadParameters& params)
+  {
+    std::vector<OpcUa::DataValue> values;
+    for (const OpcUa::AttributeValueID& attribute : params.AttributesToRead)
+    {
+      const uint32_t id = attribute.Node.GetIntegerIdentifier();
+      values.push_back(attribute.Attribute == OpcUa::AttributeID::NODE_CLASS
+        ? OpcUa::DataValue(static_cast<int32_t>(space.at(id).Class))
+        : OpcUa::DataValue(static_cast<int32_t>(id)));
+    }
+    return values;
+  }
+
+  std::vector<OpcUa::AddNodesResult> AddAll(const std::vector<OpcUa::AddNodesItem>& items)
+  {
+    std::vector<OpcUa::AddNodesResult> results(items.size());
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+      results[i].Status = OpcUa::StatusCode::Good;
+      results[i].AddedNodeID = items[i].RequestedNewNodeID;
+    }
+    return results;
+  }
+
+}
+
+class NodeTemplateTest : public Test
+{
+protected:
+  virtual void SetUp()
+  {
+    Server.reset(new MockServer);
+    Parent = OpcUa::NumericNodeID(1000, 2);
+  }
+
+  void ExpectAddressSpace(const AddressSpace& space)
+  {
+    EXPECT_CALL(*Server->ViewsMock, BrowseNodes(_))
+      .WillRepeatedly(Invoke([space](const OpcUa::NodesQuery& query)
+      {
+        return Browse(space, query);
+      }));
+    EXPECT_CALL(*Server->AttributesMock, Read(_))
+      .WillRepeatedly(Invoke([space](const OpcUa::ReadParameters& params)
+      {
+        return Read(space, params);
+      }));
+  }
+
+  void ExpectAddNodes()
+  {
+    EXPECT_CALL(*Server->NodeManagementMock, AddNodes(_))
+      .WillRepeatedly(Invoke([this](const std::vector<OpcUa::AddNodesItem>& items)
+      {
+        Nodes.insert(Nodes.end(), items.begin(), items.end());
+        return AddAll(items);
+      }));
+  }
+
+protected:
+  MockServer::SharedPtr Server;
+  OpcUa::NodeID Parent;
+  std::vector<OpcUa::AddNodesItem> Nodes;
+};
+
+TEST_F(NodeTemplateTest, CapturesObjectsAndVariables)
+{
+  const AddressSpace space = {
+    {1, {OpcUa::NodeClass::Object, OpcUa::ReferenceID::Organizes, {11, 12, 13, 14}}},
+    {11, {OpcUa::NodeClass::Variable, OpcUa::ReferenceID::HasComponent, {}}},
+    {12, {OpcUa::NodeClass::Variable, OpcUa::ReferenceID::HasProperty, {}}},
+    {13, {OpcUa::NodeClass::Object, OpcUa::ReferenceID::Organizes, {131}}},
+    {131, {OpcUa::NodeClass::Variable, OpcUa::ReferenceID::HasComponent, {}}},
+    // Method is not captured together with its subtree.
+    {14, {OpcUa::NodeClass::Method, OpcUa::ReferenceID::HasComponent, {141}}},
+    {141, {OpcUa::NodeClass::Variable, OpcUa::ReferenceID::HasProperty, {}}},
+  };
+  ExpectAddressSpace(space);
+
+  const OpcUa::Node root(Server, MakeID(1), OpcUa::QualifiedName(1, "1"));
+  const OpcUa::NodeTemplate nodeTemplate = OpcUa::NodeTemplate::Capture(root, 2);
+  ASSERT_EQ(nodeTemplate.Size(), 5u);
+
+  ExpectAddNodes();
+  const std::vector<OpcUa::NodeID> roots = nodeTemplate.Instantiate(Server, Parent, std::vector<OpcUa::QualifiedName>(1, OpcUa::QualifiedName(2, "instance")));
+  ASSERT_EQ(roots.size(), 1u);
+  ASSERT_EQ(Nodes.size(), 5u);
+
+  ASSERT_EQ(Nodes[0].Class, OpcUa::NodeClass::Object);
+  ASSERT_EQ(Nodes[0].BrowseName, OpcUa::QualifiedName(2, "instance"));
+  ASSERT_EQ(Nodes[1].BrowseName, OpcUa::QualifiedName(1, "11"));
+  ASSERT_EQ(Nodes[1].ReferenceTypeId, OpcUa::NodeID(OpcUa::ReferenceID::HasComponent));
+  ASSERT_EQ(Nodes[1].Attributes.Attributes.at(OpcUa::AttributeID::VALUE), OpcUa::Variant(int32_t(11)));
+  ASSERT_EQ(Nodes[2].ReferenceTypeId, OpcUa::NodeID(OpcUa::ReferenceID::HasProperty));
+  ASSERT_EQ(Nodes[2].Attributes.Attributes.at(OpcUa::AttributeID::VALUE), OpcUa::Variant(int32_t(12)));
+  ASSERT_EQ(Nodes[3].Class, OpcUa::NodeClass::Object);
+  ASSERT_EQ(Nodes[4].BrowseName, OpcUa::QualifiedName(1, "131"));
+  ASSERT_EQ(Nodes[4].ParentNodeId, Nodes[3].RequestedNewNodeID);
+  ASSERT_EQ(Nodes[4].Attributes.Attributes.at(OpcUa::AttributeID::VALUE), OpcUa::Variant(int32_t(131)));
+}
+
+TEST_F(NodeTemplateTest, CapturesVariableRootWithValue)
+{
+  const AddressSpace space = {
+    {1, {OpcUa::NodeClass::Variable, OpcUa::ReferenceID::Organizes, {11}}},
+    {11, {OpcUa::NodeClass::Variable, OpcUa::ReferenceID::HasProperty, {}}},
+  };
+  ExpectAddressSpace(space);
+
+  const OpcUa::Node root(Server, MakeID(1), OpcUa::QualifiedName(1, "1"));
+  const OpcUa::NodeTemplate nodeTemplate = OpcUa::NodeTemplate::Capture(root, 1);
+
+  ExpectAddNodes();
+  nodeTemplate.Instantiate(Server, Parent, std::vector<OpcUa::QualifiedName>(1, OpcUa::QualifiedName(2, "instance")));
+  ASSERT_EQ(Nodes.size(), 2u);
+  ASSERT_EQ(Nodes[0].Class, OpcUa::NodeClass::Variable);
+  ASSERT_EQ(Nodes[0].Attributes.Attributes.at(OpcUa::AttributeID::VALUE), OpcUa::Variant(int32_t(1)));
+  ASSERT_EQ(Nodes[1].Attributes.Attributes.at(OpcUa::AttributeID::VALUE), OpcUa::Variant(int32_t(11)));
+}
+
+TEST_F(NodeTemplateTest, DoesNotCaptureMethods)
+{
+  const AddressSpace space = {
+    {1, {OpcUa::NodeClass::Method, OpcUa::ReferenceID::Organizes, {}}},
+  };
+  ExpectAddressSpace(space);
+
+  const OpcUa::Node root(Server, MakeID(1), OpcUa::QualifiedName(1, "1"));
+  ASSERT_THROW(OpcUa::NodeTemplate::Capture(root, 1), std::invalid_argument);
+}
+
+TEST_F(NodeTemplateTest, InstantiatesTemplateForEveryName)
+{
+  OpcUa::NodeTemplate nodeTemplate(OpcUa::QualifiedName(2, "root"));
+  const OpcUa::NodeTemplate::Handle folder = nodeTemplate.AddFolder(OpcUa::NodeTemplate::Root, OpcUa::QualifiedName(2, "folder"));
+  nodeTemplate.AddVariable(folder, OpcUa::QualifiedName(2, "variable"), int32_t(5));
+  ASSERT_EQ(nodeTemplate.Size(), 3u);
+
+  ExpectAddNodes();
+  std::vector<OpcUa::QualifiedName> names;
+  names.push_back(OpcUa::QualifiedName(2, "first"));
+  names.push_back(OpcUa::QualifiedName(2, "second"));
+  const std::vector<OpcUa::NodeID> roots = nodeTemplate.Instantiate(Server, Parent, names);
+
+  ASSERT_EQ(roots.size(), 2u);
+  ASSERT_EQ(Nodes.size(), 6u);
+  for (std::size_t instance = 0; instance < 2; ++instance)
+  {
+    const OpcUa::AddNodesItem& root = Nodes[instance * 3];
+    ASSERT_EQ(root.RequestedNewNodeID, roots[instance]);
+    ASSERT_EQ(root.ParentNodeId, Parent);
+    ASSERT_EQ(root.BrowseName, names[instance]);
+    ASSERT_EQ(Nodes[instance * 3 + 1].ParentNodeId, root.RequestedNewNodeID);
+    ASSERT_EQ(Nodes[instance * 3 + 2].ParentNodeId, Nodes[instance * 3 + 1].RequestedNewNodeID);
+    ASSERT_EQ(Nodes[instance * 3 + 2].BrowseName, OpcUa::QualifiedName(2, "variable"));
+    // Generated ids are in the namespace of parent.
+    ASSERT_EQ(root.RequestedNewNodeID.GetNamespaceIndex(), 2);
+  }
+  ASSERT_NE(roots[0], roots[1]);
+}
+
+TEST_F(NodeTemplateTest, ThrowsIfNodeWasNotAdded)
+{
+  OpcUa::NodeTemplate nodeTemplate(OpcUa::QualifiedName(2, "root"));
+  nodeTemplate.AddFolder(OpcUa::NodeTemplate::Root, OpcUa::QualifiedName(2, "folder"));
+
+  EXPECT_CALL(*Server->NodeManagementMock, AddNodes(_))
+    .WillOnce(Invoke([](const std::vector<OpcUa::AddNodesItem>& items)
+    {
+      std::vector<OpcUa::AddNodesResult> results = AddAll(items);
+      results[1].Status = OpcUa::StatusCode::BadBrowseNameDuplicated;
+      return results;
+    }));
+
+  ASSERT_THROW(nodeTemplate.Instantiate(Server, Parent, std::vector<OpcUa::QualifiedName>(1, OpcUa::QualifiedName(2, "instance"))), std::runtime_error);
+}
@@ -0,0 +1,289 @@
+/// @brief Tests of OpcUa::NotificationQueue.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/notification_queue.h>
+#include <opc/ua/protocol/binary/stream.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+
+  OpcUa::MonitoredItems CreateItem(OpcUa::IntegerID clientHandle, OpcUa::StatusCode status = OpcUa::StatusCode::Good)
+  {
+    OpcUa::MonitoredItems item;
+    item.ClientHandle = clientHandle;
+    item.Value.Status = status;
+    return item;
+  }
+
+  OpcUa::MonitoredItems CreateValueItem(OpcUa::IntegerID clientHandle, int32_t value, OpcUa::StatusCode status)
+  {
+    OpcUa::MonitoredItems item;
+    item.ClientHandle = clientHandle;
+    item.Value = OpcUa::DataValue(value);
+    item.Value.Status = status;
+    item.Value.Encoding |= OpcUa::DATA_VALUE_STATUS_CODE;
+    return item;
+  }
+
+  // Reads parts of encoded result one after another like the receiving side of SendV.
+  class PartsSupplier : public OpcUa::Binary::DataSupplier
+  {
+  public:
+    explicit PartsSupplier(const std::vector<iovec>& parts)
+      : Position(0)
+    {
+      for (const iovec& part : parts)
+      {
+        const char* data = static_cast<const char*>(part.iov_base);
+        Data.insert(Data.end(), data, data + part.iov_len);
+      }
+    }
+
+    virtual std::size_t Read(char* buffer, std::size_t size)
+    {
+      size = std::min(size, Data.size() - Position);
+      std::copy(Data.begin() + Position, Data.begin() + Position + size, buffer);
+      Position += size;
+      return size;
+    }
+
+    std::size_t GetRest() const
+    {
+      return Data.size() - Position;
+    }
+
+  private:
+    std::vector<char> Data;
+    std::size_t Position;
+  };
+
+  std::vector<OpcUa::IntegerID> GetHandles(const std::vector<OpcUa::MonitoredItems>& items)
+  {
+    std::vector<OpcUa::IntegerID> handles;
+    for (const OpcUa::MonitoredItems& item : items)
+    {
+      handles.push_back(item.ClientHandle);
+    }
+    return handles;
+  }
+
+}
+
+TEST(NotificationQueue, DiscardsOldestWhenFull)
+{
+  OpcUa::NotificationQueue queue(3);
+  for (OpcUa::IntegerID handle = 1; handle <= 5; ++handle)
+  {
+    queue.Push(CreateItem(handle));
+  }
+  ASSERT_EQ(queue.Size(), 3u);
+  ASSERT_EQ(queue.GetDiscarded(), 2u);
+
+  std::vector<OpcUa::MonitoredItems> items;
+  ASSERT_EQ(queue.Pop(items), 3u);
+  ASSERT_EQ(GetHandles(items), std::vector<OpcUa::IntegerID>({3, 4, 5}));
+  ASSERT_EQ(queue.Size(), 0u);
+}
+
+TEST(NotificationQueue, DiscardsNewestWhenFull)
+{
+  OpcUa::NotificationQueue queue(3, OpcUa::QueueOverflowPolicy::DiscardNewest);
+  for (OpcUa::IntegerID handle = 1; handle <= 5; ++handle)
+  {
+    queue.Push(CreateItem(handle));
+  }
+  ASSERT_EQ(queue.GetDiscarded(), 2u);
+
+  std::vector<OpcUa::MonitoredItems> items;
+  queue.Pop(items);
+  ASSERT_EQ(GetHandles(items), std::vector<OpcUa::IntegerID>({1, 2, 3}));
+}
+
+TEST(NotificationQueue, MergesNotificationsOfTheSameItem)
+{
+  OpcUa::NotificationQueue queue(2);
+  queue.Push(CreateItem(1));
+  queue.Push(CreateItem(2));
+  queue.Push(CreateItem(1, OpcUa::StatusCode::BadNodeIdUnknown));
+  ASSERT_EQ(queue.Size(), 2u);
+  ASSERT_EQ(queue.GetDiscarded(), 0u);
+
+  std::vector<OpcUa::MonitoredItems> items;
+  ASSERT_EQ(queue.Pop(items, 1), 1u);
+  ASSERT_EQ(items.front().ClientHandle, 1u);
+  ASSERT_EQ(items.front().Value.Status, OpcUa::StatusCode::BadNodeIdUnknown);
+
+  // Popped item is queued again as a new notification.
+  queue.Push(CreateItem(1));
+  items.clear();
+  queue.Pop(items);
+  ASSERT_EQ(GetHandles(items), std::vector<OpcUa::IntegerID>({2, 1}));
+}
+
+TEST(NotificationQueues, CollectsChangesFromManySamplingThreads)
+{
+  const unsigned producers = 8;
+  const unsigned perProducer = 1000;
+  OpcUa::NotificationQueues queues;
+  queues.AddSubscription(1, producers * perProducer);
+
+  std::vector<std::thread> threads;
+  for (unsigned producer = 0; producer < producers; ++producer)
+  {
+    threads.push_back(std::thread([&queues, producer, perProducer]()
+    {
+      for (unsigned i = 0; i < perProducer; ++i)
+      {
+        std::vector<OpcUa::SampledChange> changes(1);
+        changes.front().SubscriptionID = 1;
+        changes.front().Item = CreateItem(producer * perProducer + i);
+        queues.OnDataChange(changes);
+      }
+    }));
+  }
+
+  std::size_t received = 0;
+  while (received < producers * perProducer)
+  {
+    for (const OpcUa::PublishResult& result : queues.PopPublishResults(std::vector<OpcUa::IntegerID>(1, 1)))
+    {
+      received += result.Message.Data.front().DataChange.Notification.size();
+    }
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  ASSERT_EQ(received, producers * perProducer);
+  ASSERT_TRUE(queues.PopPublishResults(std::vector<OpcUa::IntegerID>(1, 1)).empty());
+}
+
+TEST(NotificationQueues, EncodesNotificationsIntoPooledBuffers)
+{
+  Common::BufferPool::SharedPtr pool(new Common::BufferPool);
+  OpcUa::NotificationQueues queues(pool);
+  queues.AddSubscription(1, 10);
+
+  std::vector<OpcUa::SampledChange> changes(2);
+  changes[0].SubscriptionID = 1;
+  changes[0].Item = CreateItem(5);
+  changes[1].SubscriptionID = 1;
+  changes[1].Item = CreateItem(6, OpcUa::StatusCode::BadNodeIdUnknown);
+  queues.OnDataChange(changes);
+  ASSERT_TRUE(changes.empty());
+  ASSERT_TRUE(queues.PopPublishResults(std::vector<OpcUa::IntegerID>(1, 1)).empty());
+
+  std::vector<OpcUa::EncodedPublishResult> results = queues.PopEncodedPublishResults(std::vector<OpcUa::IntegerID>(1, 1), 1);
+  ASSERT_EQ(results.size(), 1u);
+  const OpcUa::EncodedPublishResult& result = results.front();
+  ASSERT_EQ(result.SubscriptionID, 1u);
+  ASSERT_EQ(result.SequenceID, 1u);
+  ASSERT_TRUE(result.MoreNotifications);
+  // Head, client handle, value and tail.
+  ASSERT_EQ(result.Parts.size(), 4u);
+  ASSERT_EQ(result.Parts[1].iov_len, sizeof(uint32_t));
+  ASSERT_EQ(*static_cast<const uint32_t*>(result.Parts[1].iov_base), 5u);
+  ASSERT_EQ(result.Parts[2].iov_base, result.Buffers.front()->data());
+  ASSERT_EQ(*static_cast<const uint32_t*>(result.Parts[0].iov_base), 1u);
+
+  std::size_t size = 0;
+  for (const iovec& part : result.Parts)
+  {
+    size += part.iov_len;
+  }
+  ASSERT_EQ(result.GetSize(), size);
+
+  results = queues.PopEncodedPublishResults(std::vector<OpcUa::IntegerID>(1, 1));
+  ASSERT_EQ(results.size(), 1u);
+  ASSERT_EQ(results.front().SequenceID, 2u);
+  ASSERT_FALSE(results.front().MoreNotifications);
+  ASSERT_EQ(*static_cast<const uint32_t*>(results.front().Parts[1].iov_base), 6u);
+
+  // Released buffers return to the pool.
+  results.clear();
+  ASSERT_EQ(pool->GetFreeCount(), 4u);
+}
+
+TEST(NotificationQueues, SharesEncodedValueBetweenSubscriptions)
+{
+  Common::BufferPool::SharedPtr pool(new Common::BufferPool);
+  OpcUa::NotificationQueues queues(pool);
+  std::vector<OpcUa::NotificationTarget> targets;
+  for (OpcUa::IntegerID id = 1; id <= 3; ++id)
+  {
+    queues.AddSubscription(id, 10);
+    OpcUa::NotificationTarget target;
+    target.SubscriptionID = id;
+    target.ClientHandle = id * 10;
+    targets.push_back(target);
+  }
+
+  queues.OnDataChange(OpcUa::DataValue(), targets);
+  const std::vector<OpcUa::EncodedPublishResult> results = queues.PopEncodedPublishResults(std::vector<OpcUa::IntegerID>({1, 2, 3}));
+  ASSERT_EQ(results.size(), 3u);
+  for (const OpcUa::EncodedPublishResult& result : results)
+  {
+    ASSERT_EQ(result.Parts[2].iov_base, results.front().Parts[2].iov_base);
+    ASSERT_EQ(*static_cast<const uint32_t*>(result.Parts[1].iov_base), result.SubscriptionID * 10);
+  }
+}
+
+TEST(NotificationQueues, EncodedResultsDecodeToTheSameResults)
+{
+  Common::BufferPool::SharedPtr pool(new Common::BufferPool);
+  OpcUa::NotificationQueues encodedQueues(pool);
+  OpcUa::NotificationQueues queues;
+  encodedQueues.AddSubscription(1, 10);
+  queues.AddSubscription(1, 10);
+
+  std::vector<OpcUa::SampledChange> changes(3);
+  for (std::size_t i = 0; i < changes.size(); ++i)
+  {
+    changes[i].SubscriptionID = 1;
+    changes[i].Item = CreateValueItem(i + 5, i * 100, i == 1 ? OpcUa::StatusCode::BadNodeIdUnknown : OpcUa::StatusCode::Good);
+  }
+  std::vector<OpcUa::SampledChange> copy = changes;
+  encodedQueues.OnDataChange(copy);
+  queues.OnDataChange(changes);
+
+  // First publish takes two notifications and leaves one for the second.
+  for (std::size_t maxNotifications : {2, 0})
+  {
+    const std::vector<OpcUa::EncodedPublishResult> encoded = encodedQueues.PopEncodedPublishResults(std::vector<OpcUa::IntegerID>(1, 1), maxNotifications);
+    const std::vector<OpcUa::PublishResult> expected = queues.PopPublishResults(std::vector<OpcUa::IntegerID>(1, 1), maxNotifications);
+    ASSERT_EQ(encoded.size(), 1u);
+    ASSERT_EQ(expected.size(), 1u);
+
+    PartsSupplier supplier(encoded.front().Parts);
+    OpcUa::Binary::DataDeserializer deserializer(supplier);
+    OpcUa::PublishResult decoded;
+    deserializer >> decoded;
+    ASSERT_EQ(supplier.GetRest(), 0u);
+
+    ASSERT_EQ(decoded.SubscriptionID, expected.front().SubscriptionID);
+    ASSERT_EQ(decoded.AvailableSequenceNumber, expected.front().AvailableSequenceNumber);
+    ASSERT_EQ(decoded.MoreNotifications, expected.front().MoreNotifications);
+    ASSERT_EQ(decoded.Message.SequenceID, expected.front().Message.SequenceID);
+    ASSERT_TRUE(decoded.Statuses.empty());
+    ASSERT_EQ(decoded.Message.Data.size(), 1u);
+
+    const std::vector<OpcUa::MonitoredItems>& items = decoded.Message.Data.front().DataChange.Notification;
+    const std::vector<OpcUa::MonitoredItems>& expectedItems = expected.front().Message.Data.front().DataChange.Notification;
+    ASSERT_EQ(GetHandles(items), GetHandles(expectedItems));
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+      ASSERT_EQ(items[i].Value.Status, expectedItems[i].Value.Status);
+      ASSERT_EQ(items[i].Value.Value, expectedItems[i].Value.Value);
+    }
+  }
+}
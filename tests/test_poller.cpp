@@ -0,0 +1,75 @@
+/// @brief Tests of OpcUa::Poller.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/poller.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sys/socket.h>
+
+namespace
+{
+
+  std::pair<std::shared_ptr<OpcUa::SocketChannel>, std::shared_ptr<OpcUa::SocketChannel>> CreateChannels()
+  {
+    int fds[2] = {-1, -1};
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+      throw std::runtime_error("socketpair failed");
+    }
+    return std::make_pair(std::make_shared<OpcUa::SocketChannel>(fds[0]), std::make_shared<OpcUa::SocketChannel>(fds[1]));
+  }
+
+}
+
+TEST(Poller, ReturnsOnlyReadyChannels)
+{
+  auto first = CreateChannels();
+  auto second = CreateChannels();
+
+  OpcUa::Poller poller;
+  poller.Add(first.first);
+  poller.Add(second.first);
+  ASSERT_EQ(poller.Size(), 2u);
+  ASSERT_TRUE(poller.Wait(0.01).empty());
+
+  second.second->Send("hello", 5);
+  const std::vector<std::shared_ptr<OpcUa::SocketChannel>> ready = poller.Wait(1);
+  ASSERT_EQ(ready.size(), 1u);
+  ASSERT_EQ(ready.front(), second.first);
+
+  char data[5] = {0};
+  ASSERT_EQ(ready.front()->Receive(data, sizeof(data)), sizeof(data));
+  ASSERT_EQ(std::string(data, sizeof(data)), "hello");
+  ASSERT_TRUE(poller.Wait(0.01).empty());
+}
+
+TEST(Poller, DoesNotReturnRemovedChannels)
+{
+  auto channels = CreateChannels();
+
+  OpcUa::Poller poller;
+  poller.Add(channels.first);
+  poller.Remove(*channels.first);
+  channels.second->Send("a", 1);
+  ASSERT_TRUE(poller.Wait(0.01).empty());
+  ASSERT_EQ(poller.Size(), 0u);
+}
+
+TEST(Poller, WaitsLessThanMillisecond)
+{
+  auto channels = CreateChannels();
+
+  OpcUa::Poller poller;
+  poller.Add(channels.first);
+  // Timeout is rounded up to 1 ms instead of polling without waiting.
+  const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  ASSERT_TRUE(poller.Wait(0.0005).empty());
+  ASSERT_GE(std::chrono::steady_clock::now() - started, std::chrono::microseconds(500));
+}
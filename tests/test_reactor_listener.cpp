@@ -0,0 +1,382 @@
+/// @brief Tests of OpcUa::UaServer::ReactorConnectionListener.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/reactor_listener.h>
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <netinet/in.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+
+  class CountingProcessor : public OpcUa::UaServer::IncomingConnectionProcessor
+  {
+  public:
+    CountingProcessor()
+      : Processed(0)
+    {
+    }
+
+    virtual void Process(std::shared_ptr<OpcUa::IOChannel> clientChannel)
+    {
+      // Answer one byte so client knows connection reached processor.
+      ++Processed;
+      clientChannel->Send("x", 1);
+    }
+
+    virtual void StopProcessing(std::shared_ptr<OpcUa::IOChannel> clientChannel)
+    {
+    }
+
+  public:
+    std::atomic<unsigned> Processed;
+  };
+
+  int Connect(unsigned short port)
+  {
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock < 0 || connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+      throw std::runtime_error("connect failed");
+    }
+    return sock;
+  }
+
+  // Connect to IPv4 loopback from the given local address.
+  int ConnectFrom(unsigned short port, const char* source)
+  {
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    inet_pton(AF_INET, source, &local.sin_addr);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock < 0 || bind(sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0 || connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+      throw std::runtime_error("connect failed");
+    }
+    return sock;
+  }
+
+  // Keeps channels so they stay active.
+  class HoldingProcessor : public CountingProcessor
+  {
+  public:
+    virtual void Process(std::shared_ptr<OpcUa::IOChannel> clientChannel)
+    {
+      CountingProcessor::Process(clientChannel);
+      std::lock_guard<std::mutex> lock(Mutex);
+      Channels.push_back(clientChannel);
+    }
+
+  public:
+    std::mutex Mutex;
+    std::vector<std::shared_ptr<OpcUa::IOChannel>> Channels;
+  };
+
+  // Client gets one byte from processor or reset from listener.
+  bool IsAccepted(int client)
+  {
+    char answer = 0;
+    return recv(client, &answer, 1, MSG_WAITALL) == 1;
+  }
+
+  OpcUa::UaServer::ReactorListenerStatistics WaitForConnections(const OpcUa::UaServer::ReactorConnectionListener& listener, uint64_t count)
+  {
+    OpcUa::UaServer::ReactorListenerStatistics stats = listener.GetStatistics();
+    for (int i = 0; i < 1000 && stats.Accepted + stats.Rejected < count; ++i)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      stats = listener.GetStatistics();
+    }
+    return stats;
+  }
+
+}
+
+TEST(ReactorConnectionListener, PassesBurstOfConnectionsToProcessor)
+{
+  OpcUa::UaServer::ReactorListenerParameters params;
+  params.Host = "127.0.0.1";
+  params.AcceptorThreads = 2;
+  params.WorkerThreads = 2;
+  params.MaxPendingConnections = 256;
+
+  std::shared_ptr<CountingProcessor> processor(new CountingProcessor);
+  OpcUa::UaServer::ReactorConnectionListener listener(params);
+  listener.Start(processor);
+  ASSERT_NE(listener.GetPort(), 0);
+
+  const unsigned count = 200;
+  std::vector<int> clients;
+  for (unsigned i = 0; i < count; ++i)
+  {
+    clients.push_back(Connect(listener.GetPort()));
+  }
+  for (int client : clients)
+  {
+    char answer = 0;
+    ASSERT_EQ(recv(client, &answer, 1, MSG_WAITALL), 1);
+    close(client);
+  }
+  ASSERT_EQ(processor->Processed, count);
+  listener.Stop();
+}
+
+TEST(ReactorConnectionListener, StopsWithFullQueue)
+{
+  OpcUa::UaServer::ReactorListenerParameters params;
+  params.Host = "127.0.0.1";
+  params.MaxPendingConnections = 1;
+
+  // Blocked worker leaves connections in the queue.
+  class BlockingProcessor : public CountingProcessor
+  {
+  public:
+    virtual void Process(std::shared_ptr<OpcUa::IOChannel> clientChannel)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  };
+
+  OpcUa::UaServer::ReactorConnectionListener listener(params);
+  listener.Start(std::shared_ptr<CountingProcessor>(new BlockingProcessor));
+  std::vector<int> clients;
+  for (unsigned i = 0; i < 5; ++i)
+  {
+    clients.push_back(Connect(listener.GetPort()));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  listener.Stop();
+  for (int client : clients)
+  {
+    close(client);
+  }
+}
+
+TEST(ReactorConnectionListener, StopsSessionsBlockedInProcess)
+{
+  OpcUa::UaServer::ReactorListenerParameters params;
+  params.Host = "127.0.0.1";
+  params.WorkerThreads = 1;
+
+  // Serves a session like a real processor: reads requests until connection is closed.
+  class SessionProcessor : public CountingProcessor
+  {
+  public:
+    SessionProcessor()
+      : Stopped(0)
+    {
+    }
+
+    virtual void Process(std::shared_ptr<OpcUa::IOChannel> clientChannel)
+    {
+      CountingProcessor::Process(clientChannel);
+      char request = 0;
+      while (true)
+      {
+        clientChannel->Receive(&request, 1);
+      }
+    }
+
+    virtual void StopProcessing(std::shared_ptr<OpcUa::IOChannel> clientChannel)
+    {
+      ++Stopped;
+    }
+
+  public:
+    std::atomic<unsigned> Stopped;
+  };
+
+  std::shared_ptr<SessionProcessor> processor(new SessionProcessor);
+  OpcUa::UaServer::ReactorConnectionListener listener(params);
+  listener.Start(processor);
+
+  // Sessions run at once even with a single worker configured.
+  std::vector<int> clients;
+  for (unsigned i = 0; i < 3; ++i)
+  {
+    clients.push_back(Connect(listener.GetPort()));
+  }
+  for (int client : clients)
+  {
+    ASSERT_TRUE(IsAccepted(client));
+  }
+
+  listener.Stop();
+  ASSERT_EQ(processor->Stopped, 3u);
+  ASSERT_EQ(listener.GetStatistics().Active, 0u);
+  for (int client : clients)
+  {
+    close(client);
+  }
+}
+
+TEST(ReactorConnectionListener, RejectsConnectionsOverMaxChannels)
+{
+  OpcUa::UaServer::ReactorListenerParameters params;
+  params.Host = "127.0.0.1";
+  params.MaxChannels = 2;
+
+  std::shared_ptr<HoldingProcessor> processor(new HoldingProcessor);
+  OpcUa::UaServer::ReactorConnectionListener listener(params);
+  listener.Start(processor);
+
+  std::vector<int> clients;
+  for (unsigned i = 0; i < 4; ++i)
+  {
+    clients.push_back(Connect(listener.GetPort()));
+  }
+  const OpcUa::UaServer::ReactorListenerStatistics stats = WaitForConnections(listener, clients.size());
+  ASSERT_EQ(stats.Accepted, 2u);
+  ASSERT_EQ(stats.Rejected, 2u);
+  ASSERT_EQ(stats.Active, 2u);
+
+  ASSERT_TRUE(IsAccepted(clients[0]));
+  ASSERT_TRUE(IsAccepted(clients[1]));
+  ASSERT_FALSE(IsAccepted(clients[2]));
+  ASSERT_FALSE(IsAccepted(clients[3]));
+
+  {
+    std::lock_guard<std::mutex> lock(processor->Mutex);
+    processor->Channels.clear();
+  }
+  ASSERT_EQ(listener.GetStatistics().Active, 0u);
+  const int client = Connect(listener.GetPort());
+  ASSERT_TRUE(IsAccepted(client));
+
+  listener.Stop();
+  for (int client : clients)
+  {
+    close(client);
+  }
+  close(client);
+}
+
+TEST(ReactorConnectionListener, LimitsConnectionRateOfSource)
+{
+  OpcUa::UaServer::ReactorListenerParameters params;
+  params.Host = "127.0.0.1";
+  params.MaxConnectionsPerSecond = 3;
+
+  std::shared_ptr<CountingProcessor> processor(new CountingProcessor);
+  OpcUa::UaServer::ReactorConnectionListener listener(params);
+  listener.Start(processor);
+
+  std::vector<int> clients;
+  for (unsigned i = 0; i < 10; ++i)
+  {
+    clients.push_back(Connect(listener.GetPort()));
+  }
+  const OpcUa::UaServer::ReactorListenerStatistics stats = WaitForConnections(listener, clients.size());
+  ASSERT_GE(stats.Accepted, 3u);
+  ASSERT_LT(stats.Accepted, 10u);
+  ASSERT_EQ(stats.Accepted + stats.Rejected, 10u);
+
+  listener.Stop();
+  for (int client : clients)
+  {
+    close(client);
+  }
+}
+
+TEST(ReactorConnectionListener, LimitsIPv4SourcesOfDualStackSocketSeparately)
+{
+  OpcUa::UaServer::ReactorListenerParameters params;
+  params.Host = "::";
+  params.MaxConnectionsPerSecond = 3;
+
+  std::shared_ptr<CountingProcessor> processor(new CountingProcessor);
+  OpcUa::UaServer::ReactorConnectionListener listener(params);
+  listener.Start(processor);
+
+  // Both sources come as IPv4 mapped addresses, the first one exhausts only its own bucket.
+  std::vector<int> clients;
+  for (unsigned i = 0; i < 6; ++i)
+  {
+    clients.push_back(ConnectFrom(listener.GetPort(), "127.0.0.1"));
+  }
+  WaitForConnections(listener, clients.size());
+  for (unsigned i = 0; i < 3; ++i)
+  {
+    clients.push_back(ConnectFrom(listener.GetPort(), "127.0.0.2"));
+  }
+  for (std::size_t i = 6; i < clients.size(); ++i)
+  {
+    ASSERT_TRUE(IsAccepted(clients[i]));
+  }
+  const OpcUa::UaServer::ReactorListenerStatistics stats = WaitForConnections(listener, clients.size());
+  ASSERT_LT(stats.Accepted, clients.size());
+
+  listener.Stop();
+  for (int client : clients)
+  {
+    close(client);
+  }
+}
+
+TEST(ReactorConnectionListener, QueuesSessionsOverMaxWorkerThreads)
+{
+  OpcUa::UaServer::ReactorListenerParameters params;
+  params.Host = "127.0.0.1";
+  params.MaxWorkerThreads = 2;
+
+  // Session lasts until client closes connection.
+  class SessionProcessor : public CountingProcessor
+  {
+  public:
+    virtual void Process(std::shared_ptr<OpcUa::IOChannel> clientChannel)
+    {
+      CountingProcessor::Process(clientChannel);
+      char request = 0;
+      clientChannel->Receive(&request, 1);
+    }
+  };
+
+  std::shared_ptr<SessionProcessor> processor(new SessionProcessor);
+  OpcUa::UaServer::ReactorConnectionListener listener(params);
+  listener.Start(processor);
+
+  std::vector<int> clients;
+  for (unsigned i = 0; i < 4; ++i)
+  {
+    clients.push_back(Connect(listener.GetPort()));
+  }
+  ASSERT_TRUE(IsAccepted(clients[0]));
+  ASSERT_TRUE(IsAccepted(clients[1]));
+  const OpcUa::UaServer::ReactorListenerStatistics stats = WaitForConnections(listener, clients.size());
+  ASSERT_EQ(stats.Accepted, 4u);
+  ASSERT_EQ(stats.Pending, 2u);
+
+  // The end of a session frees a worker for the next connection.
+  close(clients[0]);
+  ASSERT_TRUE(IsAccepted(clients[2]));
+  ASSERT_EQ(processor->Processed, 3u);
+
+  listener.Stop();
+  for (std::size_t i = 1; i < clients.size(); ++i)
+  {
+    close(clients[i]);
+  }
+}
@@ -0,0 +1,271 @@
+/// @brief Tests of OpcUa::SamplingEngine.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include "mock_server.h"
+
+#include <opc/ua/sampling_engine.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+using namespace testing;
+using namespace OpcCoreTests;
+
+namespace
+{
+
+  class MockSink : public OpcUa::SamplingSink
+  {
+  public:
+    DEFINE_CLASS_POINTERS(MockSink);
+
+  public:
+    MOCK_METHOD1(OnDataChange, void(std::vector<OpcUa::SampledChange>& changes));
+  };
+
+  OpcUa::AttributeValueID MakeAttribute(uint32_t node)
+  {
+    OpcUa::AttributeValueID attribute;
+    attribute.Node = OpcUa::NumericNodeID(node, 1);
+    attribute.Attribute = OpcUa::AttributeID::VALUE;
+    return attribute;
+  }
+
+  // Every node has value equal to its numeric id plus offset.
+  std::function<std::vector<OpcUa::DataValue>(const OpcUa::ReadParameters&)> ReadValues(const int32_t& offset)
+  {
+    return [&offset](const OpcUa::ReadParameters& params)
+    {
+      std::vector<OpcUa::DataValue> values;
+      for (const OpcUa::AttributeValueID& attribute : params.AttributesToRead)
+      {
+        values.push_back(OpcUa::DataValue(static_cast<int32_t>(attribute.Node.GetIntegerIdentifier()) + offset));
+      }
+      return values;
+    };
+  }
+
+  std::vector<OpcUa::IntegerID> Handles(const std::vector<OpcUa::SampledChange>& changes)
+  {
+    std::vector<OpcUa::IntegerID> handles;
+    for (const OpcUa::SampledChange& change : changes)
+    {
+      handles.push_back(change.Item.ClientHandle);
+    }
+    std::sort(handles.begin(), handles.end());
+    return handles;
+  }
+
+  // Long enough to never fire during a test, buckets are sampled explicitly.
+  const std::chrono::milliseconds Never(std::chrono::hours(1));
+
+}
+
+class SamplingEngineTest : public Test
+{
+protected:
+  virtual void SetUp()
+  {
+    Server.reset(new MockServer);
+    Sink.reset(new StrictMock<MockSink>);
+    Offset = 0;
+  }
+
+  void ExpectReads()
+  {
+    EXPECT_CALL(*Server->AttributesMock, Read(_))
+      .WillRepeatedly(Invoke([this](const OpcUa::ReadParameters& params)
+      {
+        Reads.push_back(params);
+        return ReadValues(Offset)(params);
+      }));
+  }
+
+  void ExpectChanges()
+  {
+    EXPECT_CALL(*Sink, OnDataChange(_))
+      .WillRepeatedly(Invoke([this](std::vector<OpcUa::SampledChange>& changes)
+      {
+        Changes.push_back(changes);
+      }));
+  }
+
+protected:
+  Common::TimerWheel Timers;
+  MockServer::SharedPtr Server;
+  std::shared_ptr<StrictMock<MockSink>> Sink;
+  int32_t Offset;
+  std::vector<OpcUa::ReadParameters> Reads;
+  std::vector<std::vector<OpcUa::SampledChange>> Changes;
+};
+
+TEST_F(SamplingEngineTest, ReadsBucketWithOneRequest)
+{
+  OpcUa::SamplingEngine engine(Server, Timers, Sink);
+  ExpectReads();
+  ExpectChanges();
+
+  engine.Add(1, 10, MakeAttribute(1), Never);
+  engine.Add(1, 20, MakeAttribute(2), Never);
+  engine.Add(2, 30, MakeAttribute(3), Never);
+  engine.Add(2, 40, MakeAttribute(4), Never * 2);
+  ASSERT_EQ(engine.Size(), 4u);
+
+  engine.Sample(Never);
+  ASSERT_EQ(Reads.size(), 1u);
+  ASSERT_EQ(Reads[0].AttributesToRead.size(), 3u);
+  // The first sample is always reported.
+  ASSERT_EQ(Changes.size(), 1u);
+  ASSERT_EQ(Handles(Changes[0]), std::vector<OpcUa::IntegerID>({10, 20, 30}));
+  ASSERT_EQ(Changes[0][2].SubscriptionID, 2u);
+  ASSERT_EQ(engine.GetStatistics().Samples, 1u);
+  ASSERT_EQ(engine.GetStatistics().Changes, 3u);
+}
+
+TEST_F(SamplingEngineTest, ReportsOnlyChangedValues)
+{
+  OpcUa::SamplingEngine engine(Server, Timers, Sink);
+  ExpectReads();
+  ExpectChanges();
+
+  OpcUa::DeadbandFilter filter;
+  filter.Type = OpcUa::DeadbandType::Absolute;
+  filter.Value = 1.5;
+  engine.Add(1, 10, MakeAttribute(1), Never);
+  engine.Add(1, 20, MakeAttribute(2), Never, filter);
+  engine.Sample(Never);
+
+  // Values are the same, sink is not called.
+  engine.Sample(Never);
+  ASSERT_EQ(Changes.size(), 1u);
+
+  // Change inside deadband is reported only for item without filter.
+  Offset = 1;
+  engine.Sample(Never);
+  ASSERT_EQ(Changes.size(), 2u);
+  ASSERT_EQ(Handles(Changes[1]), std::vector<OpcUa::IntegerID>({10}));
+
+  Offset = 2;
+  engine.Sample(Never);
+  ASSERT_EQ(Handles(Changes[2]), std::vector<OpcUa::IntegerID>({10, 20}));
+  ASSERT_EQ(engine.GetStatistics().Samples, 4u);
+}
+
+TEST_F(SamplingEngineTest, KeepsItemsDenseAfterRemove)
+{
+  OpcUa::SamplingEngine engine(Server, Timers, Sink);
+  ExpectReads();
+  ExpectChanges();
+
+  const OpcUa::SampledItemID first = engine.Add(1, 10, MakeAttribute(1), Never);
+  engine.Add(1, 20, MakeAttribute(2), Never);
+  engine.Add(1, 30, MakeAttribute(3), Never);
+  engine.Sample(Never);
+
+  ASSERT_TRUE(engine.Remove(first));
+  ASSERT_FALSE(engine.Remove(first));
+  Offset = 1;
+  engine.Sample(Never);
+
+  ASSERT_EQ(Reads[1].AttributesToRead.size(), 2u);
+  ASSERT_EQ(Handles(Changes[1]), std::vector<OpcUa::IntegerID>({20, 30}));
+  for (const OpcUa::SampledChange& change : Changes[1])
+  {
+    ASSERT_EQ(change.Item.Value.Value, OpcUa::Variant(static_cast<int32_t>(change.Item.ClientHandle / 10 + 1)));
+  }
+}
+
+TEST_F(SamplingEngineTest, RemovesEmptyBucket)
+{
+  OpcUa::SamplingEngine engine(Server, Timers, Sink);
+
+  const OpcUa::SampledItemID id = engine.Add(1, 10, MakeAttribute(1), Never);
+  ASSERT_EQ(Timers.Size(), 1u);
+  ASSERT_TRUE(engine.Remove(id));
+  ASSERT_EQ(Timers.Size(), 0u);
+  ASSERT_EQ(engine.Size(), 0u);
+
+  // Nothing is read for removed bucket.
+  engine.Sample(Never);
+}
+
+TEST_F(SamplingEngineTest, ChangesItemsWhileBucketIsSampled)
+{
+  OpcUa::SamplingEngine engine(Server, Timers, Sink);
+  ExpectChanges();
+
+  const OpcUa::SampledItemID first = engine.Add(1, 10, MakeAttribute(1), Never);
+  engine.Add(1, 20, MakeAttribute(2), Never);
+
+  // Server and sink are called without engine lock, so they can change items of the bucket.
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .WillOnce(Invoke([&](const OpcUa::ReadParameters& params)
+    {
+      engine.Remove(first);
+      engine.Add(1, 30, MakeAttribute(3), Never);
+      return ReadValues(Offset)(params);
+    }))
+    .WillRepeatedly(Invoke(ReadValues(Offset)));
+
+  engine.Sample(Never);
+  // Sampling reported items which were in the bucket when it started.
+  ASSERT_EQ(Handles(Changes[0]), std::vector<OpcUa::IntegerID>({10, 20}));
+
+  // Detector follows changes: the new item is reported as first sample, the old one is not changed.
+  engine.Sample(Never);
+  ASSERT_EQ(Changes.size(), 2u);
+  ASSERT_EQ(Handles(Changes[1]), std::vector<OpcUa::IntegerID>({30}));
+
+  Offset = 1;
+  engine.Sample(Never);
+  ASSERT_EQ(Handles(Changes[2]), std::vector<OpcUa::IntegerID>({20, 30}));
+}
+
+TEST_F(SamplingEngineTest, SkipsTicksWhileBucketIsSampled)
+{
+  std::mutex mutex;
+  std::condition_variable released;
+  bool release = false;
+  std::atomic<unsigned> reads(0);
+  EXPECT_CALL(*Server->AttributesMock, Read(_))
+    .WillRepeatedly(Invoke([&](const OpcUa::ReadParameters& params)
+    {
+      ++reads;
+      std::unique_lock<std::mutex> lock(mutex);
+      released.wait(lock, [&]() { return release; });
+      return ReadValues(Offset)(params);
+    }));
+  EXPECT_CALL(*Sink, OnDataChange(_)).Times(AtLeast(1));
+
+  Common::ThreadPool::SharedPtr pool(new Common::ThreadPool(4));
+  Common::TimerWheel timers(pool);
+  {
+    OpcUa::SamplingEngine engine(Server, timers, Sink);
+    engine.Add(1, 10, MakeAttribute(1), std::chrono::milliseconds(5));
+
+    // Ticks coming while the first read is blocked are skipped.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(reads, 1u);
+    EXPECT_GT(engine.GetStatistics().Overruns, 0u);
+
+    // Engine can be used while the bucket is sampled.
+    EXPECT_EQ(engine.Size(), 1u);
+    engine.Add(1, 20, MakeAttribute(2), std::chrono::milliseconds(5));
+    EXPECT_EQ(engine.Size(), 2u);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      release = true;
+    }
+    released.notify_all();
+  }
+}
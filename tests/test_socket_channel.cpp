@@ -0,0 +1,267 @@
+/// @brief Tests of OpcUa::SocketChannel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/socket_channel.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+  class SocketChannelTest : public ::testing::Test
+  {
+  protected:
+    virtual void SetUp()
+    {
+      int fds[2] = {-1, -1};
+      ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+      Client.reset(new OpcUa::SocketChannel(fds[0]));
+      Server.reset(new OpcUa::SocketChannel(fds[1]));
+    }
+
+  protected:
+    // Declared first to outlive channels which use it.
+    Common::TimerWheel Timers;
+    std::unique_ptr<OpcUa::SocketChannel> Client;
+    std::unique_ptr<OpcUa::SocketChannel> Server;
+  };
+
+  iovec Buffer(const char* data, std::size_t size)
+  {
+    iovec buffer;
+    buffer.iov_base = const_cast<char*>(data);
+    buffer.iov_len = size;
+    return buffer;
+  }
+
+}
+
+TEST_F(SocketChannelTest, WaitForDataReturnsZeroOnTimeout)
+{
+  ASSERT_EQ(Server->WaitForData(0.01), 0);
+  Client->Send("a", 1);
+  ASSERT_EQ(Server->WaitForData(0.01), 1);
+}
+
+TEST_F(SocketChannelTest, WaitForDataWaitsLessThanMillisecond)
+{
+  // Timeout is rounded up to 1 ms instead of polling without waiting.
+  const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  ASSERT_EQ(Server->WaitForData(0.0005), 0);
+  ASSERT_GE(std::chrono::steady_clock::now() - started, std::chrono::microseconds(500));
+}
+
+TEST_F(SocketChannelTest, SendVJoinsBuffers)
+{
+  const iovec buffers[] = {Buffer("head", 4), Buffer("", 0), Buffer("body", 4)};
+  Client->SendV(buffers, 3);
+
+  char data[8] = {0};
+  ASSERT_EQ(Server->Receive(data, sizeof(data)), sizeof(data));
+  ASSERT_EQ(std::string(data, sizeof(data)), "headbody");
+}
+
+TEST_F(SocketChannelTest, ReceiveVFillsAllBuffers)
+{
+  Client->Send("headbody", 8);
+
+  char head[4] = {0};
+  char body[4] = {0};
+  const iovec buffers[] = {Buffer(head, sizeof(head)), Buffer(body, sizeof(body))};
+  ASSERT_EQ(Server->ReceiveV(buffers, 2), 8u);
+  ASSERT_EQ(std::string(head, sizeof(head)), "head");
+  ASSERT_EQ(std::string(body, sizeof(body)), "body");
+}
+
+TEST_F(SocketChannelTest, SendVContinuesShortWrites)
+{
+  // Much more than socket buffer, so sendmsg returns short writes.
+  const std::string first(1024 * 1024, 'a');
+  const std::string second(1024 * 1024, 'b');
+  std::string received(first.size() + second.size(), 0);
+
+  std::thread reader([&]()
+  {
+    Server->Receive(&received[0], received.size());
+  });
+  const iovec buffers[] = {Buffer(first.data(), first.size()), Buffer(second.data(), second.size())};
+  Client->SendV(buffers, 2);
+  reader.join();
+
+  ASSERT_EQ(received, first + second);
+}
+
+TEST_F(SocketChannelTest, BatchedMessagesAreSentOnFlush)
+{
+  Client->EnableWriteBatching(16);
+  Client->Send("ab", 2);
+  Client->Send("cd", 2);
+  ASSERT_EQ(Server->WaitForData(0.01), 0);
+
+  Client->Flush();
+  char data[4] = {0};
+  ASSERT_EQ(Server->ReceiveSome(data, sizeof(data)), 4u);
+  ASSERT_EQ(std::string(data, sizeof(data)), "abcd");
+}
+
+TEST_F(SocketChannelTest, BatchedMessagesAreSentWhenBufferIsFull)
+{
+  Client->EnableWriteBatching(4);
+  Client->Send("abc", 3);
+  ASSERT_EQ(Server->WaitForData(0.01), 0);
+  Client->Send("def", 3);
+
+  char data[6] = {0};
+  ASSERT_EQ(Server->Receive(data, sizeof(data)), sizeof(data));
+  ASSERT_EQ(std::string(data, sizeof(data)), "abcdef");
+}
+
+TEST_F(SocketChannelTest, BatchedMessagesAreSentBeforeReceiving)
+{
+  Client->EnableWriteBatching(16);
+  Client->Send("ping", 4);
+
+  std::thread server([this]()
+  {
+    char data[4] = {0};
+    Server->Receive(data, sizeof(data));
+    Server->Send("pong", 4);
+  });
+  char data[4] = {0};
+  Client->Receive(data, sizeof(data));
+  server.join();
+  ASSERT_EQ(std::string(data, sizeof(data)), "pong");
+}
+
+TEST_F(SocketChannelTest, SendFileSendsPartOfFile)
+{
+  FILE* file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+  const std::string content = "header" + std::string(100000, 'x') + "trailer";
+  ASSERT_EQ(fwrite(content.data(), 1, content.size(), file), content.size());
+  fflush(file);
+
+  std::string received(content.size() - 6, 0);
+  std::thread reader([&]()
+  {
+    Server->Receive(&received[0], received.size());
+  });
+  Client->SendFile(fileno(file), 6, content.size() - 6);
+  reader.join();
+  fclose(file);
+
+  ASSERT_EQ(received, content.substr(6));
+}
+
+TEST_F(SocketChannelTest, SendMappedSendsWholeMemory)
+{
+  std::string content(300000, 0);
+  for (std::size_t i = 0; i < content.size(); ++i)
+  {
+    content[i] = static_cast<char>(i % 251);
+  }
+
+  std::string received(content.size(), 0);
+  std::thread reader([&]()
+  {
+    Server->Receive(&received[0], received.size());
+  });
+  Client->SendMapped(content.data(), content.size());
+  reader.join();
+
+  ASSERT_EQ(received, content);
+}
+
+TEST_F(SocketChannelTest, BatchedMessagesAreSentByTimerWhenIdle)
+{
+  Client->EnableWriteBatching(16, 0.02, Timers);
+  Client->Send("ab", 2);
+  ASSERT_EQ(Server->WaitForData(0.005), 0);
+
+  // Nothing else is sent, timer flushes the buffer.
+  ASSERT_EQ(Server->WaitForData(1), 1);
+  char data[2] = {0};
+  ASSERT_EQ(Server->ReceiveSome(data, sizeof(data)), 2u);
+  ASSERT_EQ(std::string(data, sizeof(data)), "ab");
+}
+
+TEST_F(SocketChannelTest, BatchedMessagesAreSentFromSeveralThreads)
+{
+  Client->EnableWriteBatching(64, 0.001, Timers);
+  const std::size_t threadsCount = 4;
+  const std::size_t messages = 1000;
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < threadsCount; ++i)
+  {
+    threads.push_back(std::thread([this, i, messages]()
+    {
+      const char message[4] = {static_cast<char>('a' + i), static_cast<char>('a' + i), static_cast<char>('a' + i), static_cast<char>('a' + i)};
+      for (std::size_t j = 0; j < messages; ++j)
+      {
+        Client->Send(message, sizeof(message));
+      }
+    }));
+  }
+
+  // All messages fit into the socket buffer.
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  // Messages are not interleaved and none is lost.
+  std::vector<std::size_t> counts(threadsCount);
+  for (std::size_t j = 0; j < threadsCount * messages; ++j)
+  {
+    char data[4] = {0};
+    Server->Receive(data, sizeof(data));
+    ASSERT_EQ(std::string(data, sizeof(data)), std::string(4, data[0]));
+    ++counts[data[0] - 'a'];
+  }
+  ASSERT_EQ(counts, std::vector<std::size_t>(threadsCount, messages));
+}
+
+TEST_F(SocketChannelTest, ReceiveDoesNotWaitForBlockedSend)
+{
+  // Peer does not read, so sending stops on the full socket buffer.
+  const std::string message(8 * 1024 * 1024, 'a');
+  std::thread writer([this, &message]()
+  {
+    Client->Send(message.data(), message.size());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // Peer starts reading only later, a receive waiting for the writer would wait for it.
+  std::thread reader([this, &message]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    std::vector<char> received(message.size());
+    Server->Receive(&received[0], received.size());
+  });
+
+  Server->Send("b", 1);
+  const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  char data = 0;
+  const std::size_t received = Client->ReceiveSome(&data, 1);
+  const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - started;
+  writer.join();
+  reader.join();
+
+  ASSERT_EQ(received, 1u);
+  ASSERT_EQ(data, 'b');
+  ASSERT_LT(elapsed, std::chrono::milliseconds(250));
+}
@@ -0,0 +1,207 @@
+/// @brief Tests of OpcUa::UringChannel.
+/// @license GNU LGPL
+///
+/// Distributed under the GNU LGPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/lgpl.html)
+///
+
+#include <opc/ua/uring_channel.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+  std::pair<std::shared_ptr<OpcUa::IOChannel>, std::shared_ptr<OpcUa::IOChannel>> CreateChannels(OpcUa::Uring::SharedPtr ring)
+  {
+    int fds[2] = {-1, -1};
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+      throw std::runtime_error("socketpair failed");
+    }
+    return std::make_pair(OpcUa::CreateSocketChannel(fds[0], ring), OpcUa::CreateSocketChannel(fds[1], ring));
+  }
+
+}
+
+TEST(UringChannel, SendsAndReceives)
+{
+  // Falls back to SocketChannel if kernel has no io_uring.
+  auto channels = CreateChannels(OpcUa::Uring::TryCreate(8));
+  const std::string message(100000, 'x');
+  std::string received(message.size(), 0);
+
+  std::thread reader([&]()
+  {
+    channels.second->Receive(&received[0], received.size());
+  });
+  channels.first->Send(message.data(), message.size());
+  reader.join();
+
+  ASSERT_EQ(received, message);
+  ASSERT_EQ(channels.second->WaitForData(0.01), 0);
+}
+
+TEST(UringChannel, ManyChannelsShareRing)
+{
+  OpcUa::Uring::SharedPtr ring = OpcUa::Uring::TryCreate(4);
+  std::vector<std::pair<std::shared_ptr<OpcUa::IOChannel>, std::shared_ptr<OpcUa::IOChannel>>> channels;
+  for (int i = 0; i < 16; ++i)
+  {
+    channels.push_back(CreateChannels(ring));
+  }
+
+  std::vector<std::thread> readers;
+  std::vector<int> values(channels.size(), -1);
+  for (std::size_t i = 0; i < channels.size(); ++i)
+  {
+    readers.push_back(std::thread([&channels, &values, i]()
+    {
+      int value = 0;
+      channels[i].second->Receive(reinterpret_cast<char*>(&value), sizeof(value));
+      values[i] = value;
+    }));
+  }
+  for (std::size_t i = 0; i < channels.size(); ++i)
+  {
+    const int value = i;
+    channels[i].first->Send(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  for (std::thread& reader : readers)
+  {
+    reader.join();
+  }
+
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    ASSERT_EQ(values[i], static_cast<int>(i));
+  }
+}
+
+TEST(UringChannel, WaitsForNonBlockingSocket)
+{
+  OpcUa::Uring::SharedPtr ring = OpcUa::Uring::TryCreate(8);
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+  std::shared_ptr<OpcUa::IOChannel> writer = OpcUa::CreateSocketChannel(fds[0], ring);
+  std::shared_ptr<OpcUa::IOChannel> reader = OpcUa::CreateSocketChannel(fds[1], ring);
+
+  std::thread sender([&writer]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    writer->Send("abcd", 4);
+  });
+  char data[4] = {0};
+  reader->Receive(data, sizeof(data));
+  sender.join();
+  ASSERT_EQ(std::string(data, sizeof(data)), "abcd");
+}
+
+TEST(Uring, SubmitsQueuedOperationsTogether)
+{
+  OpcUa::Uring::SharedPtr ring = OpcUa::Uring::TryCreate(64);
+  if (!ring)
+  {
+    return;
+  }
+
+  const int count = 16;
+  std::vector<std::pair<int, int>> sockets;
+  for (int i = 0; i < count; ++i)
+  {
+    int fds[2] = {-1, -1};
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    sockets.push_back(std::make_pair(fds[0], fds[1]));
+  }
+
+  std::vector<int> values(count, -1);
+  std::atomic<int> completed(0);
+  for (int i = 0; i < count; ++i)
+  {
+    ring->QueueReceive(sockets[i].second, reinterpret_cast<char*>(&values[i]), sizeof(int), MSG_WAITALL, [&completed](int result)
+    {
+      ASSERT_EQ(result, static_cast<int>(sizeof(int)));
+      ++completed;
+    });
+  }
+  ASSERT_EQ(ring->Submit(), static_cast<unsigned>(count));
+  ASSERT_EQ(ring->Submit(), 0u);
+
+  for (int i = 0; i < count; ++i)
+  {
+    ASSERT_EQ(send(sockets[i].first, &i, sizeof(i), 0), static_cast<ssize_t>(sizeof(i)));
+  }
+  while (completed != count)
+  {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < count; ++i)
+  {
+    ASSERT_EQ(values[i], i);
+    close(sockets[i].first);
+    close(sockets[i].second);
+  }
+}
+
+TEST(Uring, CancelsOperationsInFlightOnDestruction)
+{
+  OpcUa::Uring::SharedPtr ring = OpcUa::Uring::TryCreate(8);
+  if (!ring)
+  {
+    return;
+  }
+
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  char data = 0;
+  int result = 0;
+  ring->QueueReceive(fds[1], &data, 1, 0, [&result](int value)
+  {
+    result = value;
+  });
+  ring->Submit();
+  ring.reset();
+  ASSERT_EQ(result, -ECANCELED);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(Uring, StopsWithFullSubmissionRing)
+{
+  OpcUa::Uring::SharedPtr ring = OpcUa::Uring::TryCreate(4);
+  if (!ring)
+  {
+    return;
+  }
+
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  // Every entry is queued and not submitted, so the stop request needs a slot freed first.
+  std::vector<char> data(4);
+  std::vector<int> results(data.size(), 0);
+  for (std::size_t i = 0; i < data.size(); ++i)
+  {
+    ring->QueueReceive(fds[1], &data[i], 1, 0, [&results, i](int value)
+    {
+      results[i] = value;
+    });
+  }
+  ring.reset();
+  for (int result : results)
+  {
+    ASSERT_EQ(result, -ECANCELED);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}